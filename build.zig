@@ -22,6 +22,7 @@ pub fn build(b: *std.build.Builder) !void {
         "source/m3_api_uvwasi.c",
         "source/m3_api_wasi.c",
         "source/m3_bind.c",
+        "source/m3_cache.c",
         "source/m3_code.c",
         "source/m3_compile.c",
         "source/m3_core.c",
@@ -31,6 +32,7 @@ pub fn build(b: *std.build.Builder) !void {
         "source/m3_info.c",
         "source/m3_module.c",
         "source/m3_parse.c",
+        "source/m3_snapshot.c",
         "platforms/app/main.c",
     }, &.{
         "-Dd_m3HasWASI",
@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+
+# Wasm3 - high performance WebAssembly interpreter written in C.
+# Copyright © 2026 Wasm3 contributors.
+# All rights reserved.
+
+"""
+Extracts the JIT stencils from the m3_jit_stencils.c object file (x86-64 ELF, -mcmodel=large)
+
+Every .text.op_NAME section becomes a stencil: its machine code, and the holes that m3_jit.c patches
+when it copies the stencil. A hole is either the continuation (_jit_continue: the native code of the
+following operation), the address of an external symbol, or the address of read-only data, which is
+collected into a single blob. A trailing continuation jump is dropped, so that the next stencil is
+reached by falling through. Operations that reference anything else are left to the interpreter.
+
+Writes two headers: the stencil data for m3_jit.c, and the list of operations for m3_compile.c
+"""
+
+import argparse
+import re
+import struct
+import subprocess
+import sys
+
+SHT_SYMTAB  = 2
+SHT_RELA    = 4
+SHN_UNDEF   = 0
+STT_SECTION = 3
+STT_FUNC    = 2
+
+R_X86_64_64 = 1
+
+CONTINUE    = "_jit_continue"
+NO_STENCIL  = "_jit_no_stencil"
+
+
+class Elf:
+    def __init__(self, data):
+        if data[:4] != b"\x7fELF" or data[4] != 2 or data[5] != 1 or struct.unpack_from("<H", data, 18)[0] != 62:
+            raise SystemExit("jit_stencils: expected an x86-64 ELF object")
+
+        self.data = data
+        shoff, = struct.unpack_from("<Q", data, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 0x3a)
+
+        self.sections = []
+        for i in range(shnum):
+            name, type, flags, addr, offset, size, link, info, align, entsize = struct.unpack_from("<IIQQQQIIQQ", data, shoff + i * shentsize)
+            self.sections.append(dict(name=name, type=type, flags=flags, offset=offset, size=size, link=link, info=info, align=max(align, 1), entsize=entsize))
+
+        strtab = self.sections[shstrndx]
+        for s in self.sections:
+            s["name"] = self.string(strtab, s["name"])
+
+        self.symbols = []
+        for s in self.sections:
+            if s["type"] == SHT_SYMTAB:
+                names = self.sections[s["link"]]
+                for i in range(s["size"] // 24):
+                    name, info, other, shndx, value, size = struct.unpack_from("<IBBHQQ", data, s["offset"] + i * 24)
+                    self.symbols.append(dict(name=self.string(names, name), type=info & 0xf, shndx=shndx, value=value))
+
+    def string(self, section, offset):
+        start = section["offset"] + offset
+        return self.data[start:self.data.index(b"\0", start)].decode()
+
+    def bytes(self, section):
+        return self.data[section["offset"]:section["offset"] + section["size"]]
+
+    def relocations(self, index):
+        for s in self.sections:
+            if s["type"] == SHT_RELA and s["info"] == index:
+                for i in range(s["size"] // 24):
+                    offset, info, addend = struct.unpack_from("<QQq", self.data, s["offset"] + i * 24)
+                    yield offset, info & 0xffffffff, self.symbols[info >> 32], addend
+
+
+def BranchTargets(objdump, path):
+    # direct jump targets, per section. a continuation jump that's also a branch target can't be rewritten
+    out = subprocess.run([objdump, "-d", "--no-show-raw-insn", path], check=True, capture_output=True, text=True).stdout
+    targets = {}
+    section = None
+    for line in out.splitlines():
+        m = re.match(r"Disassembly of section (\S+):", line)
+        if m:
+            section = targets.setdefault(m.group(1), set())
+            continue
+        m = re.match(r"\s*[0-9a-f]+:\s+(j\w+|call\w*|loop\w*)\s+([0-9a-f]+) <", line)
+        if m and section is not None:
+            section.add(int(m.group(2), 16))
+    return targets
+
+
+def ContinuationJump(code, offset):
+    # movabs $_jit_continue, %reg; jmp *%reg -- returns the length of the pair, starting from the movabs
+    start = offset - 2
+    if start < 0 or code[start] not in (0x48, 0x49) or not (0xb8 <= code[start + 1] <= 0xbf):
+        return 0
+    reg = (code[start + 1] - 0xb8) | (8 if code[start] == 0x49 else 0)
+    jmp = offset + 8
+    if reg < 8 and code[jmp:jmp + 2] == bytes([0xff, 0xe0 + reg]):
+        return 12
+    if reg >= 8 and code[jmp:jmp + 3] == bytes([0x41, 0xff, 0xe0 + reg - 8]):
+        return 13
+    return 0
+
+
+def Main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--objdump", default="objdump")
+    parser.add_argument("object")
+    parser.add_argument("stencils")
+    parser.add_argument("operations")
+    args = parser.parse_args()
+
+    with open(args.object, "rb") as f:
+        elf = Elf(f.read())
+
+    targets = BranchTargets(args.objdump, args.object)
+
+    symbols = []        # external symbols, by first use
+    blob = bytearray()  # read-only data referenced by the stencils
+    blobOffsets = {}    # section index -> blob offset
+    stencils = []
+    skipped = []
+
+    def Symbol(name):
+        if name not in symbols:
+            symbols.append(name)
+        return symbols.index(name)
+
+    def Data(index):
+        if index not in blobOffsets:
+            section = elf.sections[index]
+            blob.extend(b"\0" * (-len(blob) % section["align"]))
+            blobOffsets[index] = len(blob)
+            blob.extend(elf.bytes(section))
+        return blobOffsets[index]
+
+    for index, section in enumerate(elf.sections):
+        if not section["name"].startswith(".text.op_"):
+            continue
+
+        name = section["name"][len(".text.op_"):]
+        code = bytearray(elf.bytes(section))
+        holes = []
+        problem = None
+
+        for offset, type, symbol, addend in sorted(elf.relocations(index), key=lambda r: r[0]):
+            if type != R_X86_64_64:
+                problem = "relocation type %d" % type
+            elif symbol["name"] == NO_STENCIL:
+                problem = "rewrites itself"
+            elif symbol["name"] == CONTINUE:
+                length = ContinuationJump(code, offset)
+                start = offset - 2
+                # the jmp of the pair mustn't be a branch target on its own; its register would be loaded elsewhere
+                if length and (start + 10) not in targets.get(section["name"], ()):
+                    if start + length == len(code):
+                        del code[start:]
+                    else:
+                        holes.append((start, "c_jitHole_jumpNext", 0, 0))
+                else:
+                    holes.append((offset, "c_jitHole_next", 0, 0))
+            elif symbol["shndx"] == SHN_UNDEF:
+                holes.append((offset, "c_jitHole_symbol", Symbol(symbol["name"]), addend))
+            else:
+                target = elf.sections[symbol["shndx"]]
+                if target["flags"] & 0x4:   # SHF_EXECINSTR: a helper the compiler didn't inline
+                    problem = "references %s" % (symbol["name"] or target["name"])
+                else:
+                    base = symbol["value"] if symbol["type"] != STT_SECTION else 0
+                    holes.append((offset, "c_jitHole_data", 0, Data(symbol["shndx"]) + base + addend))
+            if problem:
+                break
+
+        if any(hole[0] >= len(code) for hole in holes):
+            problem = "hole in the dropped continuation"
+
+        if problem:
+            skipped.append((name, problem))
+        else:
+            stencils.append((name, bytes(code), holes))
+
+    with open(args.stencils, "w") as f:
+        f.write("// generated by extra/jit_stencils.py from %s; do not edit\n\n" % args.object.split("/")[-1])
+
+        f.write("static const u8 c_jitCode [] =\n{")
+        offsets = []
+        total = 0
+        for name, code, holes in stencils:
+            offsets.append(total)
+            total += len(code)
+            f.write("\n    // %s\n   " % name)
+            for i, b in enumerate(code):
+                if i and i % 24 == 0:
+                    f.write("\n   ")
+                f.write(" 0x%02x," % b)
+        f.write("\n};\n\n")
+
+        f.write("static const u8 c_jitData [] __attribute__ ((aligned (64))) =\n{")
+        for i, b in enumerate(blob or b"\0"):
+            if i % 24 == 0:
+                f.write("\n   ")
+            f.write(" 0x%02x," % b)
+        f.write("\n};\n\n")
+
+        f.write("static const M3JitHole c_jitHoles [] =\n{\n")
+        numHoles = 0
+        firstHoles = []
+        for name, code, holes in stencils:
+            firstHoles.append(numHoles)
+            for offset, kind, symbol, addend in holes:
+                f.write("    { %5d, %-20s %3d, %8d },    // %s\n" % (offset, kind + ",", symbol, addend, name))
+                numHoles += 1
+        if not numHoles:
+            f.write("    { 0 }\n")
+        f.write("};\n\n")
+
+        f.write("static const M3JitStencil c_jitStencils [] =\n{\n")
+        for (name, code, holes), offset, firstHole in zip(stencils, offsets, firstHoles):
+            f.write("    { %7d, %5d, %5d, %3d },    // %s\n" % (offset, len(code), firstHole, len(holes), name))
+        f.write("};\n\n")
+
+        f.write("static const void * const c_jitSymbols [] =\n{\n")
+        for name in symbols:
+            f.write("    (const void *) & %s,\n" % name)
+        if not symbols:
+            f.write("    NULL\n")
+        f.write("};\n\n")
+
+        f.write("// left to the interpreter:\n")
+        for name, problem in skipped:
+            f.write("//   %-40s %s\n" % (name, problem))
+
+    with open(args.operations, "w") as f:
+        f.write("// generated by extra/jit_stencils.py from %s; do not edit\n\n" % args.object.split("/")[-1])
+        for name, code, holes in stencils:
+            f.write("d_m3JitStencil (%s)\n" % name)
+
+    print("jit_stencils: %d stencils (%d bytes), %d operations left to the interpreter" % (len(stencils), total, len(skipped)))
+
+
+if __name__ == "__main__":
+    Main()
@@ -0,0 +1,1560 @@
+//
+//  Wasm3 - high performance WebAssembly interpreter written in C.
+//
+//  Copyright © 2026 Wasm3 contributors.
+//  All rights reserved.
+//
+
+//  wasm3-aot: translates a module into C, ahead of time.
+//
+//  The module is parsed by the runtime itself; each function body is then walked once, with the operand stack of the
+//  Wasm code kept in C locals: a value at stack depth N of type i32/i64/f32/f64 lives in i_N/j_N/f_N/d_N. Blocks become
+//  labels & gotos. The generated file builds against source/m3_aot.h & provides m3aot_LinkModule (), which puts the
+//  translated functions in place of the interpreted ones (m3_LinkNativeFunction). A function that uses anything the
+//  translator doesn't handle (reference types, tables ops, SIMD, ...) is left out & stays interpreted.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "wasm3.h"
+#include "m3_env.h"
+#include "m3_compile.h"
+#include "m3_exception.h"
+
+#define MAX_BLOCKS      1024
+#define MAX_STACK       (d_m3MaxFunctionStackHeight)
+#define MAX_LOCALS      50000
+
+#define FATAL(msg, ...) { fprintf(stderr, "Error: [Fatal] " msg "\n", ##__VA_ARGS__); goto _onfatal; }
+
+
+//---------------------------------------------------------------------------------------------------------------------------------
+
+typedef struct Buffer
+{
+    char *      data;
+    size_t      size;
+    size_t      capacity;
+}
+Buffer;
+
+static
+void  Append  (Buffer * o, const char * i_format, va_list i_args)
+{
+    va_list args;
+    va_copy (args, i_args);
+    int length = vsnprintf (NULL, 0, i_format, args);
+    va_end (args);
+
+    if (o->size + length + 1 > o->capacity)
+    {
+        o->capacity = (o->size + length + 1) * 2;
+        o->data = realloc (o->data, o->capacity);
+        if (not o->data) {
+            fprintf (stderr, "Error: [Fatal] out of memory\n");
+            exit (1);
+        }
+    }
+
+    vsnprintf (o->data + o->size, length + 1, i_format, i_args);
+    o->size += length;
+}
+
+static
+void  Print  (Buffer * o, const char * i_format, ...)
+{
+    va_list args;
+    va_start (args, i_format);
+    Append (o, i_format, args);
+    va_end (args);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------------------
+
+typedef struct Block
+{
+    u8              opcode;         // block, loop or if; 0 for the function body
+    u32             label;
+    u32             height;         // of the stack below the params
+    u16             numParams;
+    u16             numResults;
+    const u8 *      params;
+    const u8 *      results;
+    bool            branchedTo;
+    bool            hasElse;
+    bool            dead;           // opened in unreachable code; nothing is emitted for it
+}
+Block;
+
+typedef struct Translation
+{
+    IM3Module       module;
+    IM3Function     function;
+    const bool *    translated;     // by function index
+
+    bytes_t         wasm;
+    bytes_t         wasmEnd;
+
+    Buffer          code;
+
+    u8 *            locals;         // the types of the args, then the locals
+    u32             numLocals;
+
+    u8              stack           [MAX_STACK];
+    u32             height;
+    u32             maxHeight       [c_m3Type_f64 + 1];
+
+    Block           blocks          [MAX_BLOCKS];
+    u32             numBlocks;
+    u32             numLabels;
+
+    bool            unreachable;
+    bool            usesTrap;
+    bool            usesTailCall;   // to itself: the body is jumped back to
+    u32             opcode;         // the last one read, for the error message
+}
+Translation;
+
+typedef Translation *   ITranslation;
+
+
+static const u8     c_valueTypes []     = { c_m3Type_none, c_m3Type_i32, c_m3Type_i64, c_m3Type_f32, c_m3Type_f64 };
+static const char   c_varPrefix []      = { '?', 'i', 'j', 'f', 'd' };
+static const char * c_cTypes []         = { "void", "u32", "u64", "f32", "f64" };
+static const char   c_signatureTypes [] = { 'v', 'i', 'I', 'f', 'F' };
+
+
+static
+const char *  Var  (ITranslation o, u32 i_index, u8 i_type)
+{
+    static char names [8][16];
+    static u32 next = 0;
+
+    char * name = names [next++ % 8];
+    snprintf (name, sizeof (names [0]), "%c_%u", c_varPrefix [i_type], i_index);
+
+    return name;
+}
+
+static
+const char *  StackVar  (ITranslation o, u32 i_index)
+{
+    return Var (o, i_index, o->stack [i_index]);
+}
+
+static
+void  Line  (ITranslation o, const char * i_format, ...)
+{
+    Print (& o->code, "%*s", 4 * (o->numBlocks ? o->numBlocks : 1), "");
+
+    va_list args;
+    va_start (args, i_format);
+    Append (& o->code, i_format, args);
+    va_end (args);
+
+    Print (& o->code, "\n");
+}
+
+static
+void  Label  (ITranslation o, char i_kind, u32 i_label)
+{
+    Print (& o->code, "%*s%c%u:;\n", 4 * (o->numBlocks - 1), "", i_kind, i_label);
+}
+
+static
+M3Result  Push  (ITranslation o, u8 i_type)
+{
+    if (o->height >= MAX_STACK)
+        return m3Err_functionStackOverflow;
+
+    o->stack [o->height++] = i_type;
+    o->maxHeight [i_type] = M3_MAX (o->maxHeight [i_type], o->height);
+
+    return m3Err_none;
+}
+
+static
+M3Result  Pop  (ITranslation o, u32 * o_index)
+{
+    if (o->height <= o->blocks [o->numBlocks - 1].height)
+        return m3Err_functionStackUnderrun;
+
+    * o_index = --o->height;
+
+    return m3Err_none;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------------------
+
+static
+M3Result  ReadBlockType  (ITranslation o, Block * o_block)
+{
+    M3Result result;
+
+    i64 type;
+_   (ReadLEB_i64 (& type, & o->wasm, o->wasmEnd));
+
+    if (type < 0)
+    {
+        u8 valueType;
+_       (NormalizeType (& valueType, (i8) type));
+
+        if (valueType)
+        {
+            o_block->results = & c_valueTypes [valueType];
+            o_block->numResults = 1;
+        }
+    }
+    else
+    {
+        _throwif (m3Err_wasmMalformed, type >= o->module->numFuncTypes);
+
+        IM3FuncType ftype = o->module->funcTypes [type];
+
+        o_block->params = ftype->types + ftype->numRets;
+        o_block->numParams = ftype->numArgs;
+        o_block->results = ftype->types;
+        o_block->numResults = ftype->numRets;
+    }
+
+    _catch: return result;
+}
+
+
+static
+M3Result  Branch  (ITranslation o, u32 i_depth)
+{
+    M3Result result = m3Err_none;
+
+    Block * target;
+    bool isLoop;
+    u32 arity;
+    const u8 * types;
+
+    _throwif ("invalid branch depth", i_depth >= o->numBlocks);
+
+    target = & o->blocks [o->numBlocks - 1 - i_depth];
+
+    isLoop = (target->opcode == c_waOp_loop);
+    arity = isLoop ? target->numParams : target->numResults;
+    types = isLoop ? target->params : target->results;
+
+    _throwif (m3Err_functionStackUnderrun, o->height < target->height + arity);
+
+    // from the bottom up, a value never lands where one that's still to be moved is
+    for (u32 i = 0; i < arity; ++i)
+    {
+        u32 source = o->height - arity + i;
+        u32 destination = target->height + i;
+
+        if (source != destination)
+            Line (o, "%s = %s;", Var (o, destination, types [i]), Var (o, source, types [i]));
+    }
+
+    Line (o, "goto L%u;", target->label);
+    target->branchedTo = true;
+
+    _catch: return result;
+}
+
+
+static
+M3Result  TranslateCall  (ITranslation o, u32 i_functionIndex)
+{
+    M3Result result = m3Err_none;
+
+    IM3FuncType ftype;
+    u32 base;
+
+    _throwif (m3Err_functionLookupFailed, i_functionIndex >= o->module->numFunctions);
+
+    ftype = o->module->functions [i_functionIndex].funcType;
+    _throwif (m3Err_functionStackUnderrun, o->height < o->blocks [o->numBlocks - 1].height + ftype->numArgs);
+
+    base = o->height - ftype->numArgs;
+    o->usesTrap = true;
+
+    if (o->translated [i_functionIndex])
+    {
+        Buffer call = { 0 };
+
+        if (ftype->numRets)
+            Print (& call, "%s = ", Var (o, base, ftype->types [0]));
+
+        Print (& call, "f_%u (c", i_functionIndex);
+
+        for (u32 i = 1; i < ftype->numRets; ++i)
+        {
+            Print (& call, ", & %s", Var (o, base + i, ftype->types [i]));
+            o->maxHeight [ftype->types [i]] = M3_MAX (o->maxHeight [ftype->types [i]], base + i + 1);
+        }
+
+        for (u32 i = 0; i < ftype->numArgs; ++i)
+            Print (& call, ", %s", StackVar (o, base + i));
+
+        Line (o, "d_m3AotCall (%s));", call.data);
+        free (call.data);
+    }
+    else
+    {
+        Line (o, "d_m3AotCheckStack (%u);", ftype->numRets + ftype->numArgs);
+
+        for (u32 i = 0; i < ftype->numArgs; ++i)
+            Line (o, "* (%s *) (c->stack + %u) = %s;", c_cTypes [o->stack [base + i]], ftype->numRets + i, StackVar (o, base + i));
+
+        Line (o, "d_m3AotCallFunction (c->module->functions + %u);", i_functionIndex);
+    }
+
+    o->height = base;
+
+    for (u32 i = 0; i < ftype->numRets; ++i)
+    {
+_       (Push (o, ftype->types [i]));
+
+        if (not o->translated [i_functionIndex])
+            Line (o, "%s = * (%s *) (c->stack + %u);", StackVar (o, base + i), c_cTypes [ftype->types [i]], i);
+    }
+
+    _catch: return result;
+}
+
+
+// a tail call to the function itself sets the args anew, the locals back to zero, & jumps to the top of the body, so that it
+// runs in constant stack. one to another function would be an ordinary nested C call: that function stays interpreted
+static
+M3Result  TranslateTailCall  (ITranslation o, u32 i_functionIndex)
+{
+    M3Result result = m3Err_none;
+
+    IM3FuncType ftype = o->function->funcType;
+    u32 base;
+
+    _throwif ("only tail calls of a function to itself are translated", o->module->functions + i_functionIndex != o->function);
+    _throwif (m3Err_functionStackUnderrun, o->height < o->blocks [o->numBlocks - 1].height + ftype->numArgs);
+
+    base = o->height - ftype->numArgs;
+
+    // the args are on the stack, not in locals: none is overwritten before it's read
+    for (u32 i = 0; i < ftype->numArgs; ++i)
+        Line (o, "l%u = %s;", i, StackVar (o, base + i));
+
+    for (u32 i = ftype->numArgs; i < o->numLocals; ++i)
+        Line (o, "l%u = 0;", i);
+
+    Line (o, "goto _tail;");
+
+    o->height = base;
+    o->usesTailCall = true;
+
+    _catch: return result;
+}
+
+
+static
+M3Result  TranslateCallIndirect  (ITranslation o, u32 i_typeIndex)
+{
+    M3Result result;
+
+    IM3FuncType ftype;
+    u32 tableIndex = 0, base;
+
+    _throwif (m3Err_wasmMalformed, i_typeIndex >= o->module->numFuncTypes);
+    ftype = o->module->funcTypes [i_typeIndex];
+
+_   (Pop (o, & tableIndex));
+
+    _throwif (m3Err_functionStackUnderrun, o->height < o->blocks [o->numBlocks - 1].height + ftype->numArgs);
+    base = o->height - ftype->numArgs;
+
+    Line (o, "{");
+    Line (o, "    IM3Function function;");
+    Line (o, "    d_m3AotGetTableFunction (function, %s, c->module->funcTypes [%u]);", StackVar (o, tableIndex), i_typeIndex);
+    Line (o, "    d_m3AotCheckStack (%u);", ftype->numRets + ftype->numArgs);
+
+    for (u32 i = 0; i < ftype->numArgs; ++i)
+        Line (o, "    * (%s *) (c->stack + %u) = %s;", c_cTypes [o->stack [base + i]], ftype->numRets + i, StackVar (o, base + i));
+
+    Line (o, "    d_m3AotCallFunction (function);");
+    Line (o, "}");
+
+    o->height = base;
+
+    for (u32 i = 0; i < ftype->numRets; ++i)
+    {
+_       (Push (o, ftype->types [i]));
+        Line (o, "%s = * (%s *) (c->stack + %u);", StackVar (o, base + i), c_cTypes [ftype->types [i]], i);
+    }
+
+    _catch: return result;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// the numeric operations. $r is the result, $a & $b the operands; a format that starts with '!' is a statement, otherwise
+// it's an expression that's assigned to the result
+
+typedef struct Operation
+{
+    u8              numArgs;
+    u8              argType;
+    u8              resultType;
+    const char *    format;
+}
+Operation;
+
+#define I32     c_m3Type_i32
+#define I64     c_m3Type_i64
+#define F32     c_m3Type_f32
+#define F64     c_m3Type_f64
+
+static const Operation c_operations [] =
+{
+    [0x45] = { 1, I32, I32, "$a == 0" },
+    [0x46] = { 2, I32, I32, "$a == $b" },
+    [0x47] = { 2, I32, I32, "$a != $b" },
+    [0x48] = { 2, I32, I32, "(i32) $a < (i32) $b" },
+    [0x49] = { 2, I32, I32, "$a < $b" },
+    [0x4a] = { 2, I32, I32, "(i32) $a > (i32) $b" },
+    [0x4b] = { 2, I32, I32, "$a > $b" },
+    [0x4c] = { 2, I32, I32, "(i32) $a <= (i32) $b" },
+    [0x4d] = { 2, I32, I32, "$a <= $b" },
+    [0x4e] = { 2, I32, I32, "(i32) $a >= (i32) $b" },
+    [0x4f] = { 2, I32, I32, "$a >= $b" },
+
+    [0x50] = { 1, I64, I32, "$a == 0" },
+    [0x51] = { 2, I64, I32, "$a == $b" },
+    [0x52] = { 2, I64, I32, "$a != $b" },
+    [0x53] = { 2, I64, I32, "(i64) $a < (i64) $b" },
+    [0x54] = { 2, I64, I32, "$a < $b" },
+    [0x55] = { 2, I64, I32, "(i64) $a > (i64) $b" },
+    [0x56] = { 2, I64, I32, "$a > $b" },
+    [0x57] = { 2, I64, I32, "(i64) $a <= (i64) $b" },
+    [0x58] = { 2, I64, I32, "$a <= $b" },
+    [0x59] = { 2, I64, I32, "(i64) $a >= (i64) $b" },
+    [0x5a] = { 2, I64, I32, "$a >= $b" },
+
+    [0x5b] = { 2, F32, I32, "$a == $b" },
+    [0x5c] = { 2, F32, I32, "$a != $b" },
+    [0x5d] = { 2, F32, I32, "$a < $b" },
+    [0x5e] = { 2, F32, I32, "$a > $b" },
+    [0x5f] = { 2, F32, I32, "$a <= $b" },
+    [0x60] = { 2, F32, I32, "$a >= $b" },
+
+    [0x61] = { 2, F64, I32, "$a == $b" },
+    [0x62] = { 2, F64, I32, "$a != $b" },
+    [0x63] = { 2, F64, I32, "$a < $b" },
+    [0x64] = { 2, F64, I32, "$a > $b" },
+    [0x65] = { 2, F64, I32, "$a <= $b" },
+    [0x66] = { 2, F64, I32, "$a >= $b" },
+
+    [0x67] = { 1, I32, I32, "AotClz32 ($a)" },
+    [0x68] = { 1, I32, I32, "AotCtz32 ($a)" },
+    [0x69] = { 1, I32, I32, "__builtin_popcount ($a)" },
+    [0x6a] = { 2, I32, I32, "$a + $b" },
+    [0x6b] = { 2, I32, I32, "$a - $b" },
+    [0x6c] = { 2, I32, I32, "$a * $b" },
+    [0x6d] = { 2, I32, I32, "!OP_DIV_S ($r, (i32) $a, (i32) $b, INT32_MIN)" },
+    [0x6e] = { 2, I32, I32, "!OP_DIV_U ($r, $a, $b)" },
+    [0x6f] = { 2, I32, I32, "!OP_REM_S ($r, (i32) $a, (i32) $b, INT32_MIN)" },
+    [0x70] = { 2, I32, I32, "!OP_REM_U ($r, $a, $b)" },
+    [0x71] = { 2, I32, I32, "$a & $b" },
+    [0x72] = { 2, I32, I32, "$a | $b" },
+    [0x73] = { 2, I32, I32, "$a ^ $b" },
+    [0x74] = { 2, I32, I32, "$a << ($b & 31)" },
+    [0x75] = { 2, I32, I32, "(u32) ((i32) $a >> ($b & 31))" },
+    [0x76] = { 2, I32, I32, "$a >> ($b & 31)" },
+    [0x77] = { 2, I32, I32, "rotl32 ($a, $b)" },
+    [0x78] = { 2, I32, I32, "rotr32 ($a, $b)" },
+
+    [0x79] = { 1, I64, I64, "AotClz64 ($a)" },
+    [0x7a] = { 1, I64, I64, "AotCtz64 ($a)" },
+    [0x7b] = { 1, I64, I64, "__builtin_popcountll ($a)" },
+    [0x7c] = { 2, I64, I64, "$a + $b" },
+    [0x7d] = { 2, I64, I64, "$a - $b" },
+    [0x7e] = { 2, I64, I64, "$a * $b" },
+    [0x7f] = { 2, I64, I64, "!OP_DIV_S ($r, (i64) $a, (i64) $b, INT64_MIN)" },
+    [0x80] = { 2, I64, I64, "!OP_DIV_U ($r, $a, $b)" },
+    [0x81] = { 2, I64, I64, "!OP_REM_S ($r, (i64) $a, (i64) $b, INT64_MIN)" },
+    [0x82] = { 2, I64, I64, "!OP_REM_U ($r, $a, $b)" },
+    [0x83] = { 2, I64, I64, "$a & $b" },
+    [0x84] = { 2, I64, I64, "$a | $b" },
+    [0x85] = { 2, I64, I64, "$a ^ $b" },
+    [0x86] = { 2, I64, I64, "$a << ($b & 63)" },
+    [0x87] = { 2, I64, I64, "(u64) ((i64) $a >> ($b & 63))" },
+    [0x88] = { 2, I64, I64, "$a >> ($b & 63)" },
+    [0x89] = { 2, I64, I64, "rotl64 ($a, $b)" },
+    [0x8a] = { 2, I64, I64, "rotr64 ($a, $b)" },
+
+    [0x8b] = { 1, F32, F32, "fabsf ($a)" },
+    [0x8c] = { 1, F32, F32, "-$a" },
+    [0x8d] = { 1, F32, F32, "ceilf ($a)" },
+    [0x8e] = { 1, F32, F32, "floorf ($a)" },
+    [0x8f] = { 1, F32, F32, "truncf ($a)" },
+    [0x90] = { 1, F32, F32, "rintf ($a)" },
+    [0x91] = { 1, F32, F32, "sqrtf ($a)" },
+    [0x92] = { 2, F32, F32, "$a + $b" },
+    [0x93] = { 2, F32, F32, "$a - $b" },
+    [0x94] = { 2, F32, F32, "$a * $b" },
+    [0x95] = { 2, F32, F32, "$a / $b" },
+    [0x96] = { 2, F32, F32, "min_f32 ($a, $b)" },
+    [0x97] = { 2, F32, F32, "max_f32 ($a, $b)" },
+    [0x98] = { 2, F32, F32, "copysignf ($a, $b)" },
+
+    [0x99] = { 1, F64, F64, "fabs ($a)" },
+    [0x9a] = { 1, F64, F64, "-$a" },
+    [0x9b] = { 1, F64, F64, "ceil ($a)" },
+    [0x9c] = { 1, F64, F64, "floor ($a)" },
+    [0x9d] = { 1, F64, F64, "trunc ($a)" },
+    [0x9e] = { 1, F64, F64, "rint ($a)" },
+    [0x9f] = { 1, F64, F64, "sqrt ($a)" },
+    [0xa0] = { 2, F64, F64, "$a + $b" },
+    [0xa1] = { 2, F64, F64, "$a - $b" },
+    [0xa2] = { 2, F64, F64, "$a * $b" },
+    [0xa3] = { 2, F64, F64, "$a / $b" },
+    [0xa4] = { 2, F64, F64, "min_f64 ($a, $b)" },
+    [0xa5] = { 2, F64, F64, "max_f64 ($a, $b)" },
+    [0xa6] = { 2, F64, F64, "copysign ($a, $b)" },
+
+    [0xa7] = { 1, I64, I32, "(u32) $a" },
+    [0xa8] = { 1, F32, I32, "!OP_I32_TRUNC_F32 ($r, $a)" },
+    [0xa9] = { 1, F32, I32, "!OP_U32_TRUNC_F32 ($r, $a)" },
+    [0xaa] = { 1, F64, I32, "!OP_I32_TRUNC_F64 ($r, $a)" },
+    [0xab] = { 1, F64, I32, "!OP_U32_TRUNC_F64 ($r, $a)" },
+    [0xac] = { 1, I32, I64, "(u64) (i64) (i32) $a" },
+    [0xad] = { 1, I32, I64, "(u64) $a" },
+    [0xae] = { 1, F32, I64, "!OP_I64_TRUNC_F32 ($r, $a)" },
+    [0xaf] = { 1, F32, I64, "!OP_U64_TRUNC_F32 ($r, $a)" },
+    [0xb0] = { 1, F64, I64, "!OP_I64_TRUNC_F64 ($r, $a)" },
+    [0xb1] = { 1, F64, I64, "!OP_U64_TRUNC_F64 ($r, $a)" },
+    [0xb2] = { 1, I32, F32, "(f32) (i32) $a" },
+    [0xb3] = { 1, I32, F32, "(f32) $a" },
+    [0xb4] = { 1, I64, F32, "(f32) (i64) $a" },
+    [0xb5] = { 1, I64, F32, "(f32) $a" },
+    [0xb6] = { 1, F64, F32, "(f32) $a" },
+    [0xb7] = { 1, I32, F64, "(f64) (i32) $a" },
+    [0xb8] = { 1, I32, F64, "(f64) $a" },
+    [0xb9] = { 1, I64, F64, "(f64) (i64) $a" },
+    [0xba] = { 1, I64, F64, "(f64) $a" },
+    [0xbb] = { 1, F32, F64, "(f64) $a" },
+    [0xbc] = { 1, F32, I32, "AotF32ToBits ($a)" },
+    [0xbd] = { 1, F64, I64, "AotF64ToBits ($a)" },
+    [0xbe] = { 1, I32, F32, "AotBitsToF32 ($a)" },
+    [0xbf] = { 1, I64, F64, "AotBitsToF64 ($a)" },
+
+    [0xc0] = { 1, I32, I32, "(u32) (i32) (i8) $a" },
+    [0xc1] = { 1, I32, I32, "(u32) (i32) (i16) $a" },
+    [0xc2] = { 1, I64, I64, "(u64) (i64) (i8) $a" },
+    [0xc3] = { 1, I64, I64, "(u64) (i64) (i16) $a" },
+    [0xc4] = { 1, I64, I64, "(u64) (i64) (i32) $a" },
+};
+
+static const Operation c_saturatingOperations [] =
+{
+    [0x00] = { 1, F32, I32, "!OP_I32_TRUNC_SAT_F32 ($r, $a)" },
+    [0x01] = { 1, F32, I32, "!OP_U32_TRUNC_SAT_F32 ($r, $a)" },
+    [0x02] = { 1, F64, I32, "!OP_I32_TRUNC_SAT_F64 ($r, $a)" },
+    [0x03] = { 1, F64, I32, "!OP_U32_TRUNC_SAT_F64 ($r, $a)" },
+    [0x04] = { 1, F32, I64, "!OP_I64_TRUNC_SAT_F32 ($r, $a)" },
+    [0x05] = { 1, F32, I64, "!OP_U64_TRUNC_SAT_F32 ($r, $a)" },
+    [0x06] = { 1, F64, I64, "!OP_I64_TRUNC_SAT_F64 ($r, $a)" },
+    [0x07] = { 1, F64, I64, "!OP_U64_TRUNC_SAT_F64 ($r, $a)" },
+};
+
+typedef struct MemoryOperation
+{
+    u8              valueType;
+    const char *    destType;       // for a load; the type of the memory for a store
+    const char *    srcType;
+}
+MemoryOperation;
+
+static const MemoryOperation c_memoryOperations [] =
+{
+    [0x28 - 0x28] = { I32, "i32", "i32" },
+    [0x29 - 0x28] = { I64, "i64", "i64" },
+    [0x2a - 0x28] = { F32, "f32", "f32" },
+    [0x2b - 0x28] = { F64, "f64", "f64" },
+    [0x2c - 0x28] = { I32, "i32", "i8"  },
+    [0x2d - 0x28] = { I32, "u32", "u8"  },
+    [0x2e - 0x28] = { I32, "i32", "i16" },
+    [0x2f - 0x28] = { I32, "u32", "u16" },
+    [0x30 - 0x28] = { I64, "i64", "i8"  },
+    [0x31 - 0x28] = { I64, "u64", "u8"  },
+    [0x32 - 0x28] = { I64, "i64", "i16" },
+    [0x33 - 0x28] = { I64, "u64", "u16" },
+    [0x34 - 0x28] = { I64, "i64", "i32" },
+    [0x35 - 0x28] = { I64, "u64", "u32" },
+    [0x36 - 0x28] = { I32, "u32" },
+    [0x37 - 0x28] = { I64, "u64" },
+    [0x38 - 0x28] = { F32, "f32" },
+    [0x39 - 0x28] = { F64, "f64" },
+    [0x3a - 0x28] = { I32, "u8"  },
+    [0x3b - 0x28] = { I32, "u16" },
+    [0x3c - 0x28] = { I64, "u8"  },
+    [0x3d - 0x28] = { I64, "u16" },
+    [0x3e - 0x28] = { I64, "u32" },
+};
+
+
+static
+M3Result  TranslateOperation  (ITranslation o, const Operation * i_operation)
+{
+    M3Result result = m3Err_none;
+
+    u32 a = 0, b = 0;
+    Buffer line = { 0 };
+    const char * format = i_operation->format;
+    bool isStatement;
+
+    _throwif ("unsupported opcode", not format);
+
+    if (i_operation->numArgs == 2)
+_       (Pop (o, & b));
+_   (Pop (o, & a));
+
+    _throwif (m3Err_typeMismatch, o->stack [a] != i_operation->argType or (i_operation->numArgs == 2 and o->stack [b] != i_operation->argType));
+
+    isStatement = (format [0] == '!');
+
+    if (isStatement)
+    {
+        ++format;
+        o->usesTrap = true;
+    }
+    else Print (& line, "%s = ", Var (o, a, i_operation->resultType));
+
+    for (const char * f = format; * f; ++f)
+    {
+        if (f [0] == '$' and f [1] == 'a')
+            Print (& line, "%s", Var (o, a, i_operation->argType));
+        else if (f [0] == '$' and f [1] == 'b')
+            Print (& line, "%s", Var (o, b, i_operation->argType));
+        else if (f [0] == '$' and f [1] == 'r')
+            Print (& line, "%s", Var (o, a, i_operation->resultType));
+        else
+        {
+            Print (& line, "%c", * f);
+            continue;
+        }
+        ++f;
+    }
+
+    Line (o, isStatement ? "%s" : "%s;", line.data);
+    free (line.data);
+
+_   (Push (o, i_operation->resultType));
+
+    _catch: return result;
+}
+
+
+static
+M3Result  TranslateMemoryOperation  (ITranslation o, u8 i_opcode)
+{
+    M3Result result;
+
+    const MemoryOperation * operation = & c_memoryOperations [i_opcode - 0x28];
+
+    u32 alignment, offset;
+_   (ReadLEB_u32 (& alignment, & o->wasm, o->wasmEnd));
+_   (ReadLEB_u32 (& offset, & o->wasm, o->wasmEnd));
+
+    if (o->unreachable)
+        return m3Err_none;
+
+    o->usesTrap = true;
+
+    if (operation->srcType)
+    {
+        u32 address = 0;
+_       (Pop (o, & address));
+        _throwif (m3Err_typeMismatch, o->stack [address] != c_m3Type_i32);
+
+        Line (o, "d_m3AotLoad (%s, %s, %s, %s, %uu);", Var (o, address, operation->valueType), operation->destType, operation->srcType,
+                                                    StackVar (o, address), offset);
+_       (Push (o, operation->valueType));
+    }
+    else
+    {
+        u32 value = 0, address = 0;
+_       (Pop (o, & value));
+_       (Pop (o, & address));
+        _throwif (m3Err_typeMismatch, o->stack [value] != operation->valueType or o->stack [address] != c_m3Type_i32);
+
+        Line (o, "d_m3AotStore (%s, %s, %s, %uu);", operation->destType, StackVar (o, value), StackVar (o, address), offset);
+    }
+
+    _catch: return result;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------------------
+
+static
+M3Result  OpenBlock  (ITranslation o, u8 i_opcode)
+{
+    M3Result result = m3Err_none;
+
+    Block block = { i_opcode };
+    u32 condition = 0;
+
+    _throwif ("blocks nested too deeply", o->numBlocks >= MAX_BLOCKS);
+
+_   (ReadBlockType (o, & block));
+
+    if (o->unreachable)
+    {
+        block.dead = true;
+        o->blocks [o->numBlocks++] = block;
+        return m3Err_none;
+    }
+
+    if (i_opcode == c_waOp_if)
+_       (Pop (o, & condition));
+
+    _throwif (m3Err_functionStackUnderrun, o->height < o->blocks [o->numBlocks - 1].height + block.numParams);
+
+    block.height = o->height - block.numParams;
+    block.label = ++o->numLabels;
+
+    if (i_opcode == c_waOp_if)
+        Line (o, "if (not %s) { goto E%u; }", StackVar (o, condition), block.label);
+
+    o->blocks [o->numBlocks++] = block;
+
+    if (i_opcode == c_waOp_loop)
+        Label (o, 'L', block.label);
+
+    _catch: return result;
+}
+
+
+static
+M3Result  TranslateElse  (ITranslation o)
+{
+    M3Result result = m3Err_none;
+
+    Block * block = & o->blocks [o->numBlocks - 1];
+    _throwif ("else without if", block->opcode != c_waOp_if or block->hasElse);
+
+    block->hasElse = true;
+
+    if (block->dead)
+        return m3Err_none;
+
+    if (not o->unreachable)
+    {
+        Line (o, "goto L%u;", block->label);
+        block->branchedTo = true;
+    }
+
+    Label (o, 'E', block->label);
+
+    o->height = block->height;
+    for (u32 i = 0; i < block->numParams; ++i)
+_       (Push (o, block->params [i]));
+
+    o->unreachable = false;
+
+    _catch: return result;
+}
+
+
+static
+void  EmitReturn  (ITranslation o)
+{
+    IM3FuncType ftype = o->function->funcType;
+
+    for (u32 i = 1; i < ftype->numRets; ++i)
+        Line (o, "* r%u = %s;", i, Var (o, i, ftype->types [i]));
+
+    if (ftype->numRets)
+        Line (o, "return %s;", Var (o, 0, ftype->types [0]));
+    else
+        Line (o, "return;");
+}
+
+
+static
+M3Result  CloseBlock  (ITranslation o)
+{
+    M3Result result = m3Err_none;
+
+    Block block = o->blocks [o->numBlocks - 1];
+
+    if (block.dead)
+    {
+        o->numBlocks--;
+        return m3Err_none;
+    }
+
+    bool reachable = (not o->unreachable) or block.branchedTo;
+
+    _throwif ("block results don't match the stack", not o->unreachable and o->height != block.height + block.numResults);
+
+    if (block.opcode == c_waOp_if and not block.hasElse)
+    {
+        Label (o, 'E', block.label);
+        reachable = true;
+    }
+
+    if (block.opcode != c_waOp_loop and block.branchedTo)
+        Label (o, 'L', block.label);
+
+    o->height = block.height;
+    for (u32 i = 0; i < block.numResults; ++i)
+_       (Push (o, block.results [i]));
+
+    if (o->numBlocks == 1 and reachable)
+        EmitReturn (o);
+
+    o->numBlocks--;
+    o->unreachable = not reachable;
+
+    _catch: return result;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------------------
+
+static
+M3Result  TranslateBody  (ITranslation o)
+{
+    M3Result result = m3Err_none;
+
+    while (o->numBlocks)
+    {
+        u8 opcode;
+_       (Read_u8 (& opcode, & o->wasm, o->wasmEnd));
+        o->opcode = opcode;
+
+        switch (opcode)
+        {
+            case 0x00:  // unreachable
+                if (not o->unreachable)
+                {
+                    Line (o, "newTrap (m3Err_trapUnreachable);");
+                    o->usesTrap = true;
+                    o->unreachable = true;
+                }
+                break;
+
+            case 0x01:  // nop
+                break;
+
+            case c_waOp_block:
+            case c_waOp_loop:
+            case c_waOp_if:
+_               (OpenBlock (o, opcode));
+                break;
+
+            case c_waOp_else:
+_               (TranslateElse (o));
+                break;
+
+            case c_waOp_end:
+_               (CloseBlock (o));
+                break;
+
+            case c_waOp_branch:
+            case c_waOp_branchIf:
+            {
+                u32 depth;
+_               (ReadLEB_u32 (& depth, & o->wasm, o->wasmEnd));
+
+                if (o->unreachable)
+                    break;
+
+                if (opcode == c_waOp_branchIf)
+                {
+                    u32 condition = 0;
+_                   (Pop (o, & condition));
+                    Line (o, "if (%s) {", StackVar (o, condition));
+                    o->numBlocks++;     // indents
+_                   (Branch (o, depth + 1));
+                    o->numBlocks--;
+                    Line (o, "}");
+                }
+                else
+                {
+_                   (Branch (o, depth));
+                    o->unreachable = true;
+                }
+                break;
+            }
+
+            case c_waOp_branchTable:
+            {
+                u32 numTargets;
+_               (ReadLEB_u32 (& numTargets, & o->wasm, o->wasmEnd));
+
+                u32 index = 0;
+                if (not o->unreachable)
+                {
+_                   (Pop (o, & index));
+                    Line (o, "switch (%s) {", StackVar (o, index));
+                }
+
+                for (u32 i = 0; i <= numTargets; ++i)
+                {
+                    u32 depth;
+_                   (ReadLEB_u32 (& depth, & o->wasm, o->wasmEnd));
+
+                    if (o->unreachable)
+                        continue;
+
+                    if (i < numTargets)
+                        Line (o, "case %u:", i);
+                    else
+                        Line (o, "default:");
+
+                    o->numBlocks++;
+_                   (Branch (o, depth + 1));
+                    o->numBlocks--;
+                }
+
+                if (not o->unreachable)
+                {
+                    Line (o, "}");
+                    o->unreachable = true;
+                }
+                break;
+            }
+
+            case 0x0f:  // return
+                if (not o->unreachable)
+                {
+_                   (Branch (o, o->numBlocks - 1));
+                    o->unreachable = true;
+                }
+                break;
+
+            case c_waOp_call:
+            case c_waOp_returnCall:
+            {
+                u32 functionIndex;
+_               (ReadLEB_u32 (& functionIndex, & o->wasm, o->wasmEnd));
+
+                if (o->unreachable)
+                    break;
+
+                if (opcode == c_waOp_returnCall)
+                {
+_                   (TranslateTailCall (o, functionIndex));
+                    o->unreachable = true;
+                }
+                else
+_                   (TranslateCall (o, functionIndex));
+                break;
+            }
+
+            case 0x11:  // call_indirect
+            case c_waOp_returnCallIndirect:
+            {
+                u32 typeIndex, tableIndex;
+_               (ReadLEB_u32 (& typeIndex, & o->wasm, o->wasmEnd));
+_               (ReadLEB_u32 (& tableIndex, & o->wasm, o->wasmEnd));
+
+                if (o->unreachable)
+                    break;
+
+                _throwif ("only table 0 is supported", tableIndex != 0);
+                _throwif ("only tail calls of a function to itself are translated", opcode == c_waOp_returnCallIndirect);
+                o->usesTrap = true;
+
+_               (TranslateCallIndirect (o, typeIndex));
+                break;
+            }
+
+            case 0x1a:  // drop
+            {
+                if (o->unreachable)
+                    break;
+
+                u32 value = 0;
+_               (Pop (o, & value));
+                break;
+            }
+
+            case 0x1c:  // select t
+            {
+                u32 numTypes;
+                i8 type;
+_               (ReadLEB_u32 (& numTypes, & o->wasm, o->wasmEnd));
+                _throwif ("select with more than one type", numTypes != 1);
+_               (ReadLEB_i7 (& type, & o->wasm, o->wasmEnd));
+                u8 valueType;
+_               (NormalizeType (& valueType, type));
+            }
+            // fall through
+            case 0x1b:  // select
+            {
+                if (o->unreachable)
+                    break;
+
+                u32 condition = 0, a = 0, b = 0;
+_               (Pop (o, & condition));
+_               (Pop (o, & b));
+_               (Pop (o, & a));
+                _throwif (m3Err_typeMismatch, o->stack [condition] != c_m3Type_i32 or o->stack [a] != o->stack [b]);
+
+                Line (o, "if (not %s) %s = %s;", StackVar (o, condition), StackVar (o, a), StackVar (o, b));
+_               (Push (o, o->stack [a]));
+                break;
+            }
+
+            case c_waOp_getLocal:
+            case c_waOp_setLocal:
+            case c_waOp_teeLocal:
+            {
+                u32 local;
+_               (ReadLEB_u32 (& local, & o->wasm, o->wasmEnd));
+
+                if (o->unreachable)
+                    break;
+
+                _throwif ("local index out of bounds", local >= o->numLocals);
+
+                if (opcode == c_waOp_getLocal)
+                {
+_                   (Push (o, o->locals [local]));
+                    Line (o, "%s = l%u;", StackVar (o, o->height - 1), local);
+                }
+                else
+                {
+                    u32 value = 0;
+_                   (Pop (o, & value));
+                    _throwif (m3Err_typeMismatch, o->stack [value] != o->locals [local]);
+
+                    Line (o, "l%u = %s;", local, StackVar (o, value));
+
+                    if (opcode == c_waOp_teeLocal)
+_                       (Push (o, o->locals [local]));
+                }
+                break;
+            }
+
+            case c_waOp_getGlobal:
+            case 0x24:  // global.set
+            {
+                u32 globalIndex;
+_               (ReadLEB_u32 (& globalIndex, & o->wasm, o->wasmEnd));
+
+                if (o->unreachable)
+                    break;
+
+                _throwif (m3Err_globaIndexOutOfBounds, globalIndex >= o->module->numGlobals);
+
+                u8 type = o->module->globals [globalIndex].type;
+                _throwif (m3Err_invalidTypeId, type < c_m3Type_i32 or type > c_m3Type_f64);
+
+                if (opcode == c_waOp_getGlobal)
+                {
+_                   (Push (o, type));
+                    Line (o, "%s = d_m3AotGlobal (%s, %u);", StackVar (o, o->height - 1), c_cTypes [type], globalIndex);
+                }
+                else
+                {
+                    u32 value = 0;
+_                   (Pop (o, & value));
+                    _throwif (m3Err_typeMismatch, o->stack [value] != type);
+
+                    Line (o, "d_m3AotGlobal (%s, %u) = %s;", c_cTypes [type], globalIndex, StackVar (o, value));
+                }
+                break;
+            }
+
+            case 0x3f:  // memory.size
+            case 0x40:  // memory.grow
+            {
+                u8 memoryIndex;
+_               (Read_u8 (& memoryIndex, & o->wasm, o->wasmEnd));
+
+                if (o->unreachable)
+                    break;
+
+                if (opcode == 0x3f)
+                {
+_                   (Push (o, c_m3Type_i32));
+                    Line (o, "%s = c->runtime->memory.numPages;", StackVar (o, o->height - 1));
+                }
+                else
+                {
+                    u32 pages = 0;
+_                   (Pop (o, & pages));
+                    Line (o, "d_m3AotMemGrow (%s, %s);", StackVar (o, pages), StackVar (o, pages));
+_                   (Push (o, c_m3Type_i32));
+                }
+                break;
+            }
+
+            case c_waOp_i32_const:
+            {
+                i32 value;
+_               (ReadLEB_i32 (& value, & o->wasm, o->wasmEnd));
+
+                if (o->unreachable)
+                    break;
+
+_               (Push (o, c_m3Type_i32));
+                Line (o, "%s = 0x%" PRIx32 "u;", StackVar (o, o->height - 1), (u32) value);
+                break;
+            }
+
+            case c_waOp_i64_const:
+            {
+                i64 value;
+_               (ReadLEB_i64 (& value, & o->wasm, o->wasmEnd));
+
+                if (o->unreachable)
+                    break;
+
+_               (Push (o, c_m3Type_i64));
+                Line (o, "%s = 0x%" PRIx64 "ull;", StackVar (o, o->height - 1), (u64) value);
+                break;
+            }
+
+            case c_waOp_f32_const:
+            {
+                f32 value;
+_               (Read_f32 (& value, & o->wasm, o->wasmEnd));
+
+                if (o->unreachable)
+                    break;
+
+                u32 bits;
+                memcpy (& bits, & value, sizeof (bits));
+
+_               (Push (o, c_m3Type_f32));
+                Line (o, "%s = AotBitsToF32 (0x%08" PRIx32 "u);", StackVar (o, o->height - 1), bits);
+                break;
+            }
+
+            case c_waOp_f64_const:
+            {
+                f64 value;
+_               (Read_f64 (& value, & o->wasm, o->wasmEnd));
+
+                if (o->unreachable)
+                    break;
+
+                u64 bits;
+                memcpy (& bits, & value, sizeof (bits));
+
+_               (Push (o, c_m3Type_f64));
+                Line (o, "%s = AotBitsToF64 (0x%016" PRIx64 "ull);", StackVar (o, o->height - 1), bits);
+                break;
+            }
+
+            case 0xfc:
+            {
+                u32 extended;
+_               (ReadLEB_u32 (& extended, & o->wasm, o->wasmEnd));
+                o->opcode = 0xfc00 | extended;
+
+                if (extended < M3_COUNT_OF (c_saturatingOperations))
+                {
+                    if (not o->unreachable)
+_                       (TranslateOperation (o, & c_saturatingOperations [extended]));
+                }
+                else if (extended == 10 or extended == 11)     // memory.copy, memory.fill
+                {
+                    u8 memoryIndex;
+_                   (Read_u8 (& memoryIndex, & o->wasm, o->wasmEnd));
+                    if (extended == 10)
+_                       (Read_u8 (& memoryIndex, & o->wasm, o->wasmEnd));
+
+                    if (o->unreachable)
+                        break;
+
+                    u32 size = 0, value = 0, destination = 0;
+_                   (Pop (o, & size));
+_                   (Pop (o, & value));
+_                   (Pop (o, & destination));
+
+                    Line (o, "%s (%s, %s, %s);", (extended == 10) ? "d_m3AotMemCopy" : "d_m3AotMemFill",
+                                                 StackVar (o, destination), StackVar (o, value), StackVar (o, size));
+                    o->usesTrap = true;
+                }
+                else _throw ("unsupported opcode");
+                break;
+            }
+
+            default:
+                if (opcode >= 0x28 and opcode <= 0x3e)
+                {
+_                   (TranslateMemoryOperation (o, opcode));
+                }
+                else if (opcode < M3_COUNT_OF (c_operations))
+                {
+                    _throwif ("unsupported opcode", not c_operations [opcode].format);
+
+                    if (not o->unreachable)
+_                       (TranslateOperation (o, & c_operations [opcode]));
+                }
+                else _throw ("unsupported opcode");
+        }
+    }
+
+    _throwif ("function body doesn't end with its last block", o->wasm != o->wasmEnd);
+
+    _catch: return result;
+}
+
+
+static
+void  PrintPrototype  (Buffer * o, u32 i_functionIndex, IM3FuncType i_type)
+{
+    Print (o, "static %s f_%u (M3AotContext * c", c_cTypes [i_type->numRets ? i_type->types [0] : c_m3Type_none], i_functionIndex);
+
+    for (u32 i = 1; i < i_type->numRets; ++i)
+        Print (o, ", %s * r%u", c_cTypes [i_type->types [i]], i);
+
+    for (u32 i = 0; i < i_type->numArgs; ++i)
+        Print (o, ", %s l%u", c_cTypes [i_type->types [i_type->numRets + i]], i);
+
+    Print (o, ")");
+}
+
+
+static
+M3Result  TranslateFunction  (Buffer * o_code, IM3Module i_module, u32 i_functionIndex, const bool * i_translated, u32 * o_opcode)
+{
+    M3Result result = m3Err_none;
+
+    IM3Function function = & i_module->functions [i_functionIndex];
+    IM3FuncType ftype = function->funcType;
+
+    Buffer locals = { 0 };
+    Block body = { 0 };
+    u32 numLocalBlocks;
+
+    ITranslation o = calloc (1, sizeof (Translation));
+    _throwifnull (o);
+
+    o->module = i_module;
+    o->function = function;
+    o->translated = i_translated;
+    o->wasm = function->wasm;
+    o->wasmEnd = function->wasmEnd;
+
+    // the body starts with its size; then the args, then the locals
+_   (ReadLEB_u32 (& numLocalBlocks, & o->wasm, o->wasmEnd));
+_   (ReadLEB_u32 (& numLocalBlocks, & o->wasm, o->wasmEnd));
+
+    o->numLocals = ftype->numArgs;
+    o->locals = malloc (ftype->numArgs + 1);
+    _throwifnull (o->locals);
+    memcpy (o->locals, ftype->types + ftype->numRets, ftype->numArgs);
+
+    for (u32 l = 0; l < numLocalBlocks; ++l)
+    {
+        u32 count;
+        i8 waType;
+        u8 type;
+_       (ReadLEB_u32 (& count, & o->wasm, o->wasmEnd));
+_       (ReadLEB_i7 (& waType, & o->wasm, o->wasmEnd));
+_       (NormalizeType (& type, waType));
+        _throwif (m3Err_invalidTypeId, type == c_m3Type_none);
+        _throwif ("too many locals", count > MAX_LOCALS or o->numLocals + count > MAX_LOCALS);
+
+        o->locals = realloc (o->locals, o->numLocals + count);
+        _throwifnull (o->locals);
+
+        for (u32 i = 0; i < count; ++i)
+        {
+            Print (& locals, "    %s l%u = 0;\n", c_cTypes [type], o->numLocals);
+            o->locals [o->numLocals++] = type;
+        }
+    }
+
+    body.results = ftype->types;
+    body.numResults = ftype->numRets;
+    body.label = 0;
+    o->blocks [o->numBlocks++] = body;
+
+_   (TranslateBody (o));
+
+    PrintPrototype (o_code, i_functionIndex, ftype);
+    Print (o_code, "\n{\n");
+
+    if (o->usesTrap)
+        Print (o_code, "    M3Result _t;\n");
+    Print (o_code, "    u8 * mem; u64 memLength;\n    d_m3AotLoadMemory ();\n");
+
+    if (locals.size)
+        Print (o_code, "%s", locals.data);
+
+    for (u8 type = c_m3Type_i32; type <= c_m3Type_f64; ++type)
+    {
+        if (not o->maxHeight [type])
+            continue;
+
+        Print (o_code, "    %s %s", c_cTypes [type], Var (o, 0, type));
+        for (u32 i = 1; i < o->maxHeight [type]; ++i)
+            Print (o_code, ", %s", Var (o, i, type));
+        Print (o_code, ";\n");
+    }
+
+    if (o->usesTailCall)
+        Print (o_code, "\n_tail:;");
+
+    Print (o_code, "\n%s", o->code.data ? o->code.data : "");
+
+    if (o->usesTrap)
+    {
+        Print (o_code, "\n_trap:\n    c->trap = _t;\n    return%s;\n", ftype->numRets ? " 0" : "");
+    }
+
+    Print (o_code, "}\n\n");
+
+    _catch:
+
+    if (o)
+    {
+        * o_opcode = o->opcode;
+
+        free (o->code.data);
+        free (o->locals);
+        free (o);
+    }
+    free (locals.data);
+
+    return result;
+}
+
+
+static
+void  PrintSignature  (Buffer * o, IM3FuncType i_type)
+{
+    if (i_type->numRets)
+    {
+        for (u32 i = 0; i < i_type->numRets; ++i)
+            Print (o, "%c", c_signatureTypes [i_type->types [i]]);
+    }
+    else Print (o, "v");
+
+    Print (o, "(");
+    for (u32 i = 0; i < i_type->numArgs; ++i)
+        Print (o, "%c", c_signatureTypes [i_type->types [i_type->numRets + i]]);
+    Print (o, ")");
+}
+
+
+static
+void  PrintRawFunction  (Buffer * o, u32 i_functionIndex, IM3FuncType i_type)
+{
+    u32 numRets = i_type->numRets;
+
+    Print (o, "static\nm3ApiRawFunction (r_%u)\n{\n", i_functionIndex);
+    Print (o, "    M3AotContext context;\n");
+    Print (o, "    InitAotContext (& context, runtime, _ctx, _sp, %u);\n\n", numRets + i_type->numArgs);
+
+    for (u32 i = 1; i < numRets; ++i)
+        Print (o, "    %s r%u;\n", c_cTypes [i_type->types [i]], i);
+
+    Print (o, "    ");
+    if (numRets)
+        Print (o, "%s r0 = ", c_cTypes [i_type->types [0]]);
+
+    Print (o, "f_%u (& context", i_functionIndex);
+    for (u32 i = 1; i < numRets; ++i)
+        Print (o, ", & r%u", i);
+    for (u32 i = 0; i < i_type->numArgs; ++i)
+        Print (o, ", * (%s *) (_sp + %u)", c_cTypes [i_type->types [numRets + i]], numRets + i);
+    Print (o, ");\n\n");
+
+    Print (o, "    if (context.trap)\n        return context.trap;\n\n");
+
+    for (u32 i = 0; i < numRets; ++i)
+        Print (o, "    * (%s *) (_sp + %u) = r%u;\n", c_cTypes [i_type->types [i]], i, i);
+
+    Print (o, "    return m3Err_none;\n}\n\n");
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------------------
+
+static
+void  print_usage  ()
+{
+    puts ("Usage:");
+    puts ("  wasm3-aot [options] <file.wasm> <file.c>");
+    puts ("Options:");
+    puts ("  --name <function>     name of the link function    default: m3aot_LinkModule");
+    puts ("  --verbose             list the functions that stay interpreted");
+}
+
+
+#define ARGV_SHIFT()  { i_argc--; i_argv++; }
+#define ARGV_SET(x)   { if (i_argc > 0) { x = i_argv[0]; ARGV_SHIFT(); } }
+
+int  main  (int i_argc, const char * i_argv [])
+{
+    M3Result result = m3Err_none;
+    IM3Environment env = m3_NewEnvironment ();
+    IM3Module module = NULL;
+    u8 * wasm = NULL;
+    bool * translated = NULL;
+    Buffer code = { 0 };
+    Buffer output = { 0 };
+    FILE * f = NULL;
+    long fsize;
+    u32 numTranslated = 0, numDefined = 0;
+
+    const char * argInput = NULL;
+    const char * argOutput = NULL;
+    const char * argName = "m3aot_LinkModule";
+    bool argVerbose = false;
+
+    ARGV_SHIFT ();  // Skip executable name
+
+    while (i_argc > 0)
+    {
+        const char * arg = i_argv [0];
+        if (arg [0] != '-') break;
+
+        ARGV_SHIFT ();
+        if (!strcmp ("--help", arg) or !strcmp ("-h", arg)) {
+            print_usage ();
+            return 0;
+        } else if (!strcmp ("--name", arg)) {
+            ARGV_SET (argName);
+        } else if (!strcmp ("--verbose", arg)) {
+            argVerbose = true;
+        }
+    }
+
+    if (i_argc != 2) {
+        print_usage ();
+        return 1;
+    }
+
+    argInput = i_argv [0];
+    argOutput = i_argv [1];
+
+    f = fopen (argInput, "rb");
+    if (!f) FATAL ("cannot open %s", argInput);
+
+    fseek (f, 0, SEEK_END);
+    fsize = ftell (f);
+    fseek (f, 0, SEEK_SET);
+
+    if (fsize < 8 or fsize > 256*1024*1024) FATAL ("%s: bad file size", argInput);
+
+    wasm = (u8 *) malloc (fsize);
+    if (!wasm or fread (wasm, 1, fsize, f) != (size_t) fsize) FATAL ("cannot read %s", argInput);
+    fclose (f);
+    f = NULL;
+
+    result = m3_ParseModule (env, & module, wasm, fsize);
+    if (result) FATAL ("m3_ParseModule: %s", result);
+
+    // a function is translated if it can be; calls to the others go through the runtime. since whether one can be doesn't
+    // depend on the others, a second pass settles the calls
+    translated = calloc (module->numFunctions + 1, sizeof (bool));
+    if (!translated) FATAL ("out of memory");
+
+    for (u32 i = 0; i < module->numFunctions; ++i)
+        translated [i] = not IsImportedFunction (& module->functions [i]) and module->functions [i].wasm;
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        code.size = 0;
+
+        for (u32 i = 0; i < module->numFunctions; ++i)
+        {
+            if (not translated [i])
+                continue;
+
+            size_t start = code.size;
+            u32 opcode = 0;
+
+            result = TranslateFunction (& code, module, i, translated, & opcode);
+
+            if (result)
+            {
+                if (argVerbose)
+                {
+                    const char * name = m3_GetFunctionName (& module->functions [i]);
+                    fprintf (stderr, "function %u (%s) stays interpreted: %s (opcode 0x%x)\n", i, name ? name : "?", result, opcode);
+                }
+
+                translated [i] = false;
+                code.size = start;
+                result = m3Err_none;
+            }
+        }
+    }
+
+    Print (& output, "// generated by wasm3-aot from %s; do not edit\n\n#include \"m3_aot.h\"\n\n", argInput);
+
+    for (u32 i = 0; i < module->numFunctions; ++i)
+    {
+        if (not IsImportedFunction (& module->functions [i]))
+            ++numDefined;
+
+        if (translated [i])
+        {
+            PrintPrototype (& output, i, module->functions [i].funcType);
+            Print (& output, ";\n");
+            ++numTranslated;
+        }
+    }
+
+    Print (& output, "\n%s", code.data ? code.data : "");
+
+    for (u32 i = 0; i < module->numFunctions; ++i)
+    {
+        if (translated [i])
+            PrintRawFunction (& output, i, module->functions [i].funcType);
+    }
+
+    Print (& output, "M3Result  %s  (IM3Module io_module)\n{\n_try {\n", argName);
+    Print (& output, "    _throwif (\"the module doesn't match its native code\", io_module->numFunctions != %u or io_module->numFuncImports != %u);\n\n",
+                     module->numFunctions, module->numFuncImports);
+
+    for (u32 i = 0; i < module->numFunctions; ++i)
+    {
+        if (not translated [i])
+            continue;
+
+        Print (& output, "_   (m3_LinkNativeFunction (io_module, %u, \"", i);
+        PrintSignature (& output, module->functions [i].funcType);
+        Print (& output, "\", r_%u));\n", i);
+    }
+
+    Print (& output, "} _catch:\n    return result;\n}\n");
+
+    f = fopen (argOutput, "wb");
+    if (!f or fwrite (output.data, 1, output.size, f) != output.size) FATAL ("cannot write %s", argOutput);
+    fclose (f);
+    f = NULL;
+
+    printf ("wasm3-aot: %u of %u functions translated\n", numTranslated, numDefined);
+
+    free (code.data);
+    free (output.data);
+    free (translated);
+    m3_FreeModule (module);
+    m3_FreeEnvironment (env);
+    free (wasm);
+
+    return 0;
+
+_onfatal:
+    if (f) fclose (f);
+    free (code.data);
+    free (output.data);
+    free (translated);
+    m3_FreeModule (module);
+    m3_FreeEnvironment (env);
+    free (wasm);
+
+    return 1;
+}
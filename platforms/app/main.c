@@ -9,6 +9,12 @@
 #include <stdlib.h>
 #include <time.h>
 #include <ctype.h>
+#include <signal.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define HAS_ALARM
+#endif
 
 #include "wasm3.h"
 #include "m3_api_libc.h"
@@ -25,10 +31,15 @@
 // TODO: remove
 #include "m3_env.h"
 
+#if defined(d_m3HasAotLoader)
+#include <dlfcn.h>
+#endif
+
 /*
  * NOTE: Gas metering/limit only applies to pre-instrumented modules.
  * You can generate a metered version from any wasm file automatically, using
  *   https://github.com/ewasm/wasm-metering
+ * Any module can be metered by the runtime itself instead, see --gas.
  */
 #define GAS_LIMIT       500000000
 #define GAS_FACTOR      10000LL
@@ -44,6 +55,22 @@ static IM3Runtime runtime;
 static u8* wasm_bins[MAX_MODULES];
 static int wasm_bins_qty = 0;
 
+static bool jit_enabled = false;
+static uint64_t runtime_gas = 0;    // built-in metering, when nonzero
+static const char* cache_dir = NULL; // compiled code is kept there, see m3_CompileModuleCached
+static unsigned compile_threads = 1;
+static bool compile_background = false;
+static bool stream_load = false;    // parse & compile the file as it's read, see m3_ParseModuleStreaming
+
+static void on_interrupt (int sig)
+{
+    // once only: should the runtime not get to notice it (blocked in a host call, say), the next one ends the process
+    signal (sig, SIG_DFL);
+    if (runtime) {
+        m3_Interrupt (runtime);
+    }
+}
+
 #if defined(GAS_LIMIT)
 
 static int64_t initial_gas = GAS_FACTOR * GAS_LIMIT;
@@ -169,6 +196,42 @@ on_error:
     return result;
 }
 
+M3Result repl_load_stream  (const char* fn)
+{
+    M3Result result = m3Err_none;
+    IM3ModuleStream stream = NULL;
+    IM3Module module = NULL;
+
+    FILE* f = fopen (fn, "rb");
+    if (!f) {
+        return "cannot open file";
+    }
+
+    result = m3_ParseModuleStreaming (env, &stream, runtime);
+    if (!result) {
+        // the module keeps what it needs of the bytes: one buffer does for all of the file
+        u8 chunk[64*1024];
+        size_t len;
+        while (!result && (len = fread (chunk, 1, sizeof(chunk), f)) > 0) {
+            result = m3_PushModuleBytes (stream, chunk, (u32) len);
+        }
+        if (!result && ferror (f)) {
+            result = "cannot read file";
+        }
+
+        // loaded into the runtime once finished
+        M3Result finished = m3_FinishModuleStream (stream, &module);
+        if (!result) result = finished;
+    }
+    fclose (f);
+
+    if (result) return result;
+
+    m3_SetModuleName(module, modname_from_fn(fn));
+
+    return link_all (module);
+}
+
 M3Result repl_load_hex  (u32 fsize)
 {
     M3Result result = m3Err_none;
@@ -218,6 +281,9 @@ M3Result repl_load_hex  (u32 fsize)
 
 void print_gas_used()
 {
+    if (runtime_gas) {
+        fprintf(stderr, "Gas used: %" PRIu64 "\n", runtime_gas - m3_GetGas(runtime));
+    }
 #if defined(GAS_LIMIT)
     if (is_gas_metered) {
         fprintf(stderr, "Gas used: %0.4f\n", (double)(initial_gas - current_gas) / GAS_FACTOR);
@@ -434,9 +500,33 @@ M3Result repl_global_set  (const char* name, const char* value)
 
 M3Result repl_compile  ()
 {
+    if (cache_dir) {
+        return m3_CompileModuleCached(runtime->modules, cache_dir);
+    }
     return m3_CompileModule(runtime->modules);
 }
 
+#if defined(d_m3HasAotLoader)
+// links the code that wasm3-aot translated the last module into
+M3Result repl_load_aot  (const char* fn)
+{
+    void* lib = dlopen(fn, RTLD_NOW | RTLD_LOCAL);
+    if (!lib) {
+        fprintf(stderr, "%s\n", dlerror());
+        return "cannot load native code";
+    }
+
+    M3Result (*link)(IM3Module) = (M3Result (*)(IM3Module)) dlsym(lib, "m3aot_LinkModule");
+    if (!link) {
+        dlclose(lib);
+        return "m3aot_LinkModule not found";
+    }
+
+    // the library stays loaded for as long as the process runs
+    return link(runtime->modules);
+}
+#endif
+
 M3Result repl_dump  ()
 {
     uint32_t len;
@@ -475,7 +565,20 @@ M3Result repl_init  (unsigned stack)
     if (runtime == NULL) {
         return "m3_NewRuntime failed";
     }
-    return m3Err_none;
+    M3Result result = m3_EnableJit (runtime, jit_enabled);
+    if (result) return result;
+
+    result = m3_SetCompileThreads (runtime, compile_threads);
+    if (result) return result;
+
+    result = m3_EnableBackgroundCompile (runtime, compile_background);
+    if (result) return result;
+
+    if (runtime_gas) {
+        m3_SetGas (runtime, runtime_gas);
+        result = m3_EnableGasMetering (runtime, true);
+    }
+    return result;
 }
 
 static
@@ -542,6 +645,7 @@ void print_version() {
             wasm3_arch ? wasm3_arch : M3_ARCH);
 
     printf("Build: " __DATE__ " " __TIME__ ", " M3_COMPILER_VER "\n");
+    printf("Tail calls: %s\n", d_m3ReuseTailCallFrames ? "constant stack" : "nested");
 }
 
 void print_usage() {
@@ -552,8 +656,22 @@ void print_usage() {
     puts("  --func <function>     function to run       default: _start");
     puts("  --stack-size <size>   stack size in bytes   default: 64KB");
     puts("  --compile             disable lazy compilation");
+    puts("  --cache-dir <dir>     keep the compiled code in dir, implies --compile");
+    puts("  --compile-threads <n> compile on n threads, 0 for one per core; implies --compile");
+    puts("  --compile-background  compile what the exports call on a thread, as it loads");
+    puts("  --stream              parse & compile the file as it is read");
+    puts("  --jit                 translate functions to native code");
+#if defined(d_m3HasAotLoader)
+    puts("  --aot <file.so>       link native code built by wasm3-aot");
+#endif
+    puts("  --snapshot <file>     once the function returns, write the state of the runtime to file");
+    puts("  --restore <file>      start from the state in file, instead of running the start function");
     puts("  --dump-on-trap        dump wasm memory");
     puts("  --gas-limit           set gas limit");
+    puts("  --gas <units>         meter instructions, trap once they've cost this much");
+#if defined(HAS_ALARM)
+    puts("  --timeout <seconds>   interrupt the execution after this long");
+#endif
 }
 
 #define ARGV_SHIFT()  { i_argc--; i_argv++; }
@@ -570,7 +688,11 @@ int  main  (int i_argc, const char* i_argv[])
     bool argCompile = false;
     const char* argFile = NULL;
     const char* argFunc = "_start";
+    const char* argAot = NULL;
+    const char* argSnapshot = NULL;
+    const char* argRestore = NULL;
     unsigned argStackSize = 64*1024;
+    unsigned argTimeout = 0;
 
 //    m3_PrintM3Info ();
 
@@ -590,10 +712,30 @@ int  main  (int i_argc, const char* i_argv[])
             return 0;
         } else if (!strcmp("--repl", arg)) {
             argRepl = true;
+        } else if (!strcmp("--snapshot", arg)) {
+            ARGV_SET(argSnapshot);
+        } else if (!strcmp("--restore", arg)) {
+            ARGV_SET(argRestore);
         } else if (!strcmp("--dump-on-trap", arg)) {
             argDumpOnTrap = true;
         } else if (!strcmp("--compile", arg)) {
             argCompile = true;
+        } else if (!strcmp("--cache-dir", arg)) {
+            ARGV_SET(cache_dir);
+            argCompile = true;
+        } else if (!strcmp("--compile-threads", arg)) {
+            const char* tmp = "0";
+            ARGV_SET(tmp);
+            compile_threads = atol(tmp);
+            argCompile = true;
+        } else if (!strcmp("--compile-background", arg)) {
+            compile_background = true;
+        } else if (!strcmp("--stream", arg)) {
+            stream_load = true;
+        } else if (!strcmp("--jit", arg)) {
+            jit_enabled = true;
+        } else if (!strcmp("--aot", arg)) {
+            ARGV_SET(argAot);
         } else if (!strcmp("--stack-size", arg)) {
             const char* tmp = "65536";
             ARGV_SET(tmp);
@@ -602,6 +744,14 @@ int  main  (int i_argc, const char* i_argv[])
             const char* tmp = "0";
             ARGV_SET(tmp);
             initial_gas = current_gas = GAS_FACTOR * atol(tmp);
+        } else if (!strcmp("--gas", arg)) {
+            const char* tmp = "0";
+            ARGV_SET(tmp);
+            runtime_gas = strtoull(tmp, NULL, 10);
+        } else if (!strcmp("--timeout", arg)) {
+            const char* tmp = "0";
+            ARGV_SET(tmp);
+            argTimeout = atol(tmp);
         } else if (!strcmp("--dir", arg)) {
             const char* argDir;
             ARGV_SET(argDir);
@@ -623,14 +773,38 @@ int  main  (int i_argc, const char* i_argv[])
     result = repl_init(argStackSize);
     if (result) FATAL("repl_init: %s", result);
 
+    signal(SIGINT, on_interrupt);
+#if defined(HAS_ALARM)
+    if (argTimeout) {
+        signal(SIGALRM, on_interrupt);
+        alarm(argTimeout);
+    }
+#else
+    if (argTimeout) FATAL("--timeout is not supported on this platform");
+#endif
+
     if (argFile) {
-        result = repl_load(argFile);
+        result = stream_load ? repl_load_stream(argFile) : repl_load(argFile);
         if (result) FATAL("repl_load: %s", result);
 
+        if (argAot) {
+#if defined(d_m3HasAotLoader)
+            result = repl_load_aot(argAot);
+            if (result) FATAL("repl_load_aot: %s", result);
+#else
+            FATAL("--aot is not supported in this build");
+#endif
+        }
+
         if (argCompile) {
             repl_compile();
         }
 
+        if (argRestore) {
+            result = m3_RestoreRuntime(runtime, argRestore);
+            if (result) FATAL("m3_RestoreRuntime: %s", result);
+        }
+
         if (argFunc and not argRepl) {
             if (!strcmp(argFunc, "_start")) {
                 // When passing args to WASI, include wasm filename as argv[0]
@@ -647,6 +821,11 @@ int  main  (int i_argc, const char* i_argv[])
                 goto _onfatal;
             }
         }
+
+        if (argSnapshot) {
+            result = m3_SnapshotRuntime(runtime, argSnapshot);
+            if (result) FATAL("m3_SnapshotRuntime: %s", result);
+        }
     }
 
     while (argRepl)
@@ -680,6 +859,14 @@ int  main  (int i_argc, const char* i_argv[])
             result = repl_global_set(argv[1], argv[2]);
         } else if (!strcmp(":dump", argv[0])) {
             result = repl_dump();
+        } else if (!strcmp(":snapshot", argv[0])) {         // :snapshot <filename>
+            result = m3_SnapshotRuntime(runtime, argv[1]);
+        } else if (!strcmp(":restore", argv[0])) {          // :restore <filename>
+            result = m3_RestoreRuntime(runtime, argv[1]);
+        } else if (!strcmp(":checkpoint", argv[0])) {
+            result = m3_CheckpointRuntime(runtime);
+        } else if (!strcmp(":reset", argv[0])) {
+            result = m3_ResetRuntime(runtime);
         } else if (!strcmp(":compile", argv[0])) {
             result = repl_compile();
         } else if (!strcmp(":invoke", argv[0])) {
@@ -0,0 +1,199 @@
+//
+//  m3_aot.h
+//
+//  Copyright © 2026 Wasm3 contributors.
+//  All rights reserved.
+//
+
+#ifndef m3_aot_h
+#define m3_aot_h
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// what the C that platforms/aot translates a module into is built against. that code reaches into M3Runtime & M3Module, so it
+// has to be compiled with the same configuration (d_m3* flags) as the runtime that links it in. each translated function becomes
+// a C function; a raw function wraps it, which m3_LinkNativeFunction puts in place of the function's interpreted body
+//---------------------------------------------------------------------------------------------------------------------------------
+
+#include "m3_env.h"
+#include "m3_exception.h"
+#include "m3_math_utils.h"
+
+// Wasm floating point doesn't fuse multiplies & adds. GCC only keeps them apart in ISO C mode (-std=c99) or with -ffp-contract=off
+#if defined(__clang__)
+#   pragma STDC FP_CONTRACT OFF
+#endif
+
+// a variable per stack slot & local is declared, whether or not the function ends up using it
+#if defined(__clang__)
+#   pragma clang diagnostic ignored "-Wunknown-warning-option"
+#endif
+#if defined(__GNUC__)
+#   pragma GCC diagnostic ignored "-Wunused-variable"
+#   pragma GCC diagnostic ignored "-Wunused-but-set-variable"
+#endif
+
+d_m3BeginExternC
+
+# ifndef d_m3AotMaxCallDepth
+#   define d_m3AotMaxCallDepth                  4096    // calls between translated functions use the native stack only
+# endif
+
+typedef struct M3AotContext
+{
+    IM3Runtime              runtime;
+    IM3Module               module;
+
+    u64 *                   stack;          // where the ret & arg slots of calls back into the runtime go
+    u32                     callDepth;      // remaining
+
+    M3Result                trap;
+}
+M3AotContext;
+
+
+static inline
+void  InitAotContext  (M3AotContext * o, IM3Runtime i_runtime, IM3ImportContext i_context, u64 * i_sp, u32 i_numRetAndArgSlots)
+{
+    o->runtime = i_runtime;
+    o->module = i_context->function->module;
+    o->stack = i_sp + M3_MAX (i_numRetAndArgSlots, 1);      // a slot at the least, so that recursing through the runtime
+    o->callDepth = d_m3AotMaxCallDepth;                     // is bounded by its stack
+    o->trap = m3Err_none;
+}
+
+
+// the translated functions keep the linear memory in locals; they're reloaded after anything that could have grown it
+#define d_m3AotLoadMemory()                                                                             \
+{                                                                                                       \
+    M3MemoryHeader * header = c->runtime->memory.mallocated;                                            \
+    mem = header ? m3MemData (header) : NULL;                                                           \
+    memLength = header ? header->length : 0;                                                            \
+}
+
+// a global, in its slot of the runtime's globals
+#define d_m3AotGlobal(TYPE, INDEX)          (* (TYPE *) (c->runtime->globals + c->module->globalsIndex + (INDEX)))
+
+// a trap leaves through the _trap label of the function, which records it in the context
+#define newTrap(ERROR)                      { _t = (ERROR); goto _trap; }
+
+#if d_m3SkipMemoryBoundsCheck || d_m3UseGuardPages
+#  define m3MemCheck(x) true
+#else
+#  define m3MemCheck(x) M3_LIKELY(x)
+#endif
+
+#define d_m3AotLoad(RES, DEST_TYPE, SRC_TYPE, ADDRESS, OFFSET)                                          \
+{                                                                                                       \
+    u64 operand = (u64) (ADDRESS) + (OFFSET);                                                           \
+    if (m3MemCheck (operand + sizeof (SRC_TYPE) <= memLength))                                          \
+    {                                                                                                   \
+        SRC_TYPE value;                                                                                 \
+        memcpy (& value, mem + operand, sizeof (value));                                                \
+        M3_BSWAP_##SRC_TYPE (value);                                                                    \
+        RES = (DEST_TYPE) value;                                                                        \
+    }                                                                                                   \
+    else newTrap (m3Err_trapOutOfBoundsMemoryAccess);                                                   \
+}
+
+#define d_m3AotStore(DEST_TYPE, VALUE, ADDRESS, OFFSET)                                                 \
+{                                                                                                       \
+    u64 operand = (u64) (ADDRESS) + (OFFSET);                                                           \
+    if (m3MemCheck (operand + sizeof (DEST_TYPE) <= memLength))                                         \
+    {                                                                                                   \
+        DEST_TYPE value = (DEST_TYPE) (VALUE);                                                          \
+        M3_BSWAP_##DEST_TYPE (value);                                                                   \
+        memcpy (mem + operand, & value, sizeof (value));                                                \
+    }                                                                                                   \
+    else newTrap (m3Err_trapOutOfBoundsMemoryAccess);                                                   \
+}
+
+#define d_m3AotMemCopy(DESTINATION, SOURCE, SIZE)                                                       \
+{                                                                                                       \
+    u64 destination = (DESTINATION), source = (SOURCE), size = (SIZE);                                  \
+    if (M3_LIKELY (destination + size <= memLength and source + size <= memLength))                     \
+        memmove (mem + destination, mem + source, size);                                                \
+    else newTrap (m3Err_trapOutOfBoundsMemoryAccess);                                                   \
+}
+
+#define d_m3AotMemFill(DESTINATION, BYTE, SIZE)                                                         \
+{                                                                                                       \
+    u64 destination = (DESTINATION), size = (SIZE);                                                     \
+    if (M3_LIKELY (destination + size <= memLength))                                                    \
+        memset (mem + destination, (u8) (BYTE), size);                                                 \
+    else newTrap (m3Err_trapOutOfBoundsMemoryAccess);                                                   \
+}
+
+#define d_m3AotMemGrow(RES, NUM_PAGES)                                                                  \
+{                                                                                                       \
+    RES = AotMemoryGrow (c->runtime, NUM_PAGES);                                                        \
+    d_m3AotLoadMemory ();                                                                               \
+}
+
+// a call between translated functions
+#define d_m3AotCall(CALL)                                                                               \
+{                                                                                                       \
+    if (M3_UNLIKELY (not c->callDepth))                                                                 \
+        newTrap (m3Err_trapStackOverflow);                                                              \
+    --c->callDepth;                                                                                     \
+    CALL;                                                                                               \
+    ++c->callDepth;                                                                                     \
+    if (M3_UNLIKELY (c->trap))                                                                          \
+        newTrap (c->trap);                                                                              \
+    d_m3AotLoadMemory ();                                                                               \
+}
+
+// any other call goes through the runtime, with the slots at c->stack
+#define d_m3AotCheckStack(NUM_SLOTS)                                                                    \
+    if (M3_UNLIKELY ((void *) (c->stack + (NUM_SLOTS)) >= c->runtime->memory.mallocated->maxStack))     \
+        newTrap (m3Err_trapStackOverflow);
+
+#define d_m3AotCallFunction(FUNCTION)                                                                   \
+{                                                                                                       \
+    M3Result r = Runtime_CallFunction (c->runtime, (FUNCTION), c->stack);                               \
+    if (M3_UNLIKELY (r))                                                                                \
+        newTrap (r);                                                                                    \
+    d_m3AotLoadMemory ();                                                                               \
+}
+
+#define d_m3AotGetTableFunction(FUNCTION, TABLE_INDEX, TYPE)                                            \
+{                                                                                                       \
+    u32 tableIndex = (TABLE_INDEX);                                                                     \
+    if (M3_UNLIKELY (tableIndex >= c->module->table0Size))                                              \
+        newTrap (m3Err_trapTableIndexOutOfRange);                                                       \
+    FUNCTION = c->module->table0 [tableIndex];                                                          \
+    if (M3_UNLIKELY (not FUNCTION))                                                                     \
+        newTrap (m3Err_trapTableElementIsNull);                                                         \
+    if (M3_UNLIKELY (FUNCTION->funcType != (TYPE)))                                                     \
+        newTrap (m3Err_trapIndirectCallTypeMismatch);                                                   \
+}
+
+
+static inline
+u32  AotMemoryGrow  (IM3Runtime io_runtime, u32 i_numPages)
+{
+    IM3Memory memory = & io_runtime->memory;
+    u32 numPages = memory->numPages;
+
+    if (i_numPages)
+    {
+        if (i_numPages > memory->maxPages - numPages or ResizeMemory (io_runtime, numPages + i_numPages))
+            numPages = (u32) -1;
+    }
+
+    return numPages;
+}
+
+
+static inline f32  AotBitsToF32  (u32 i_bits)      { f32 value; memcpy (& value, & i_bits, sizeof (value)); return value; }
+static inline f64  AotBitsToF64  (u64 i_bits)      { f64 value; memcpy (& value, & i_bits, sizeof (value)); return value; }
+static inline u32  AotF32ToBits  (f32 i_value)     { u32 bits; memcpy (& bits, & i_value, sizeof (bits)); return bits; }
+static inline u64  AotF64ToBits  (f64 i_value)     { u64 bits; memcpy (& bits, & i_value, sizeof (bits)); return bits; }
+
+static inline u32  AotClz32  (u32 i_value)         { return i_value ? (u32) __builtin_clz (i_value) : 32; }
+static inline u32  AotCtz32  (u32 i_value)         { return i_value ? (u32) __builtin_ctz (i_value) : 32; }
+static inline u64  AotClz64  (u64 i_value)         { return i_value ? (u64) __builtin_clzll (i_value) : 64; }
+static inline u64  AotCtz64  (u64 i_value)         { return i_value ? (u64) __builtin_ctzll (i_value) : 64; }
+
+d_m3EndExternC
+
+#endif // m3_aot_h
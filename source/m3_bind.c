@@ -173,3 +173,24 @@ M3Result  m3_LinkRawFunction  (IM3Module            io_module,
     return FindAndLinkFunction (io_module, i_moduleName, i_functionName, i_signature, (voidptr_t)i_function, NULL);
 }
 
+M3Result  m3_LinkNativeFunction  (IM3Module            io_module,
+                                  uint32_t             i_functionIndex,
+                                  const char * const   i_signature,
+                                  M3RawCall            i_function)
+{
+_try {
+    _throwif (m3Err_moduleNotLinked, !io_module->runtime);
+    _throwif (m3Err_functionLookupFailed, i_functionIndex >= io_module->numFunctions);
+
+    IM3Function f = & io_module->functions [i_functionIndex];
+
+    _throwif ("imported functions can't have native code", IsImportedFunction (f));
+
+_   (ValidateSignature (f, i_signature));
+
+    // calls that were compiled before keep going to the interpreted body
+_   (CompileRawFunction (io_module, f, (voidptr_t) i_function, NULL));
+    f->hasNativeCode = true;
+} _catch:
+    return result;
+}
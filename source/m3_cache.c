@@ -0,0 +1,997 @@
+//
+//  m3_cache.c
+//
+//  Copyright © 2026 Wasm3 contributors.
+//  All rights reserved.
+//
+
+#if defined(__linux__)
+#define _GNU_SOURCE         // dl_iterate_phdr
+#endif
+
+#include "m3_env.h"
+#include "m3_compile.h"
+#include "m3_exception.h"
+#include "m3_info.h"
+
+#if d_m3EnableCodeCache
+
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//---------------------------------------------------------------------------------------------------------------------
+// a cache file is named after the module's content, the build of wasm3 & the flags the code depends on. it holds,
+// after the header, each part starting at a multiple of 8 bytes:
+//   M3CachedPage           [numPages]
+//   code_t                 [numLines]          the words of the pages, one page after another, as they were compiled
+//   M3CachedFunction       [numFunctions]
+//   u8                     [numConstantBytes]
+//   M3CachedRelocation     [numRelocations]    those of the first page, then of the second...
+//   M3CachedMapping        [numMappings]       with d_m3RecordBacktraces
+// the words that aren't relocated are taken as they are: slot offsets, constants & the like
+//---------------------------------------------------------------------------------------------------------------------
+
+static const char           c_codeCacheMagic []         = "wasm3mc";
+
+enum
+{
+    c_codeCacheVersion      = 1,
+
+    c_codeCache_gasMetering = 1 << 0,
+};
+
+enum
+{
+    c_reloc_operation,      // value: the offset from the anchor operation
+    c_reloc_pc,             // page & value: the line
+    c_reloc_entry,          // value: a function whose code isn't in the cache (an import, say); its compiled pc
+    c_reloc_function,       // value: a function of the module
+    c_reloc_funcType,       // value: the index in the types of the module
+    c_reloc_module
+};
+
+typedef struct M3CodeCacheHeader
+{
+    char                    magic [8];
+    u32                     version;
+    u32                     flags;
+    u64                     buildId;
+    u64                     moduleHash;
+    u64                     moduleSize;
+
+    u32                     numModuleFunctions;
+    u32                     numPages;
+    u32                     numLines;
+    u32                     numFunctions;
+    u32                     numConstantBytes;
+    u32                     numRelocations;
+    u32                     numMappings;
+    u32                     unused;
+}
+M3CodeCacheHeader;
+
+typedef struct M3CachedPage
+{
+    u32                     numLines;
+    u32                     numRelocations;
+}
+M3CachedPage;
+
+typedef struct M3CachedFunction
+{
+    u32                     index;
+    u32                     page;
+    u32                     line;
+    u32                     constants;      // offset
+
+    u16                     maxStackSlots;
+    u16                     numRetSlots;
+    u16                     numRetAndArgSlots;
+    u16                     numLocals;
+    u16                     numLocalBytes;
+    u16                     zeroedLocalsOffset;
+    u16                     numZeroedLocalBytes;
+    u16                     numConstantBytes;
+}
+M3CachedFunction;
+
+typedef struct M3CachedRelocation
+{
+    u32                     line;           // of the word, in its page
+    u16                     kind;
+    u16                     page;           // of a pc
+    i32                     value;
+}
+M3CachedRelocation;
+
+typedef struct M3CachedMapping
+{
+    u32                     page;
+    u32                     line;
+    u32                     moduleOffset;
+    u32                     unused;
+}
+M3CachedMapping;
+
+
+static inline
+size_t  Align8  (size_t i_size)
+{
+    return (i_size + 7) & ~(size_t) 7;
+}
+
+
+static
+u64  HashBytes  (u64 io_hash, const void * i_bytes, size_t i_size)
+{
+    // FNV-1a
+    const u8 * bytes = (const u8 *) i_bytes;
+
+    for (size_t i = 0; i < i_size; ++i)
+    {
+        io_hash ^= bytes [i];
+        io_hash *= 0x100000001b3ull;
+    }
+
+    return io_hash;
+}
+
+static const u64            c_hashSeed                  = 0xcbf29ce484222325ull;
+
+
+//---------------------------------------------------------------------------------------------------------------------
+
+void  CodeCache_RecordPage  (IM3CodeRecording io_recording, IM3CodePage i_page)
+{
+    for (u32 i = 0; i < io_recording->numPages; ++i)
+    {
+        if (io_recording->pages [i].page == i_page)
+            return;
+    }
+
+    if (io_recording->numPages == io_recording->maxPages)
+    {
+        u32 maxPages = io_recording->maxPages * 2 + 8;
+        M3RecordedPage * pages = m3_ReallocArray (M3RecordedPage, io_recording->pages, maxPages, io_recording->maxPages);
+
+        if (not pages)
+        {
+            io_recording->failed = true;
+            return;
+        }
+
+        io_recording->pages = pages;
+        io_recording->maxPages = maxPages;
+    }
+
+    M3RecordedPage * recorded = & io_recording->pages [io_recording->numPages++];
+    recorded->page = i_page;
+    recorded->start = i_page->info.lineIndex;
+}
+
+
+void  CodeCache_RecordWord  (IM3CodeRecording io_recording, pc_t i_pc, bool i_isOperation)
+{
+    if (io_recording->numWords == io_recording->maxWords)
+    {
+        u32 maxWords = io_recording->maxWords * 2 + 1024;
+        uintptr_t * words = m3_ReallocArray (uintptr_t, io_recording->words, maxWords, io_recording->maxWords);
+
+        if (not words)
+        {
+            io_recording->failed = true;
+            return;
+        }
+
+        io_recording->words = words;
+        io_recording->maxWords = maxWords;
+    }
+
+    io_recording->words [io_recording->numWords++] = (uintptr_t) i_pc | (i_isOperation ? 1 : 0);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// the build of wasm3 is identified by the GNU build ID of the object its operations are in. without one, nothing is cached
+
+typedef struct M3BuildIdSearch
+{
+    uintptr_t               address;
+    u64                     id;
+    bool                    found;
+}
+M3BuildIdSearch;
+
+
+static
+int  FindBuildId  (struct dl_phdr_info * i_info, size_t i_size, void * io_search)
+{
+    M3BuildIdSearch * search = (M3BuildIdSearch *) io_search;
+
+    bool contains = false;
+
+    for (u32 i = 0; i < i_info->dlpi_phnum; ++i)
+    {
+        const ElfW(Phdr) * segment = & i_info->dlpi_phdr [i];
+
+        if (segment->p_type == PT_LOAD)
+        {
+            uintptr_t start = i_info->dlpi_addr + segment->p_vaddr;
+
+            if (search->address >= start and search->address < start + segment->p_memsz)
+                contains = true;
+        }
+    }
+
+    if (not contains)
+        return 0;
+
+    for (u32 i = 0; i < i_info->dlpi_phnum; ++i)
+    {
+        const ElfW(Phdr) * segment = & i_info->dlpi_phdr [i];
+
+        if (segment->p_type != PT_NOTE)
+            continue;
+
+        const u8 * note = (const u8 *) (i_info->dlpi_addr + segment->p_vaddr);
+        const u8 * end = note + segment->p_memsz;
+
+        while (note + sizeof (ElfW(Nhdr)) <= end)
+        {
+            const ElfW(Nhdr) * header = (const ElfW(Nhdr) *) note;
+            const u8 * name = note + sizeof (ElfW(Nhdr));
+            const u8 * desc = name + ((header->n_namesz + 3) & ~3u);
+
+            if (desc + header->n_descsz > end)
+                break;
+
+            if (header->n_type == NT_GNU_BUILD_ID and header->n_namesz == 4 and memcmp (name, "GNU", 4) == 0)
+            {
+                search->id = HashBytes (c_hashSeed, desc, header->n_descsz);
+                search->found = true;
+                break;
+            }
+
+            note = desc + ((header->n_descsz + 3) & ~3u);
+        }
+    }
+
+    return 1;
+}
+
+
+static
+bool  GetBuildId  (u64 * o_id)
+{
+    static M3BuildIdSearch s_search;
+    static bool s_searched = false;
+
+    if (not s_searched)
+    {
+        s_search.address = (uintptr_t) GetAnchorOperationCode ();
+        dl_iterate_phdr (FindBuildId, & s_search);
+        s_searched = true;
+    }
+
+    * o_id = s_search.id;
+
+    return s_search.found;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+
+static
+int  CompareRecordedPages  (const void * i_a, const void * i_b)
+{
+    uintptr_t a = (uintptr_t) ((const M3RecordedPage *) i_a)->page;
+    uintptr_t b = (uintptr_t) ((const M3RecordedPage *) i_b)->page;
+
+    return (a > b) - (a < b);
+}
+
+
+// the page & line of a pc in the recorded code; i_inclusive takes the end of a page's code too
+static
+bool  LocateRecordedPC  (IM3CodeRecording i_recording, uintptr_t i_pc, bool i_inclusive, u32 * o_page, u32 * o_line)
+{
+    // the pages are sorted by address
+    u32 low = 0, high = i_recording->numPages;
+
+    while (low < high)
+    {
+        u32 middle = (low + high) / 2;
+        M3RecordedPage * recorded = & i_recording->pages [middle];
+
+        uintptr_t start = (uintptr_t) (GetPageStartPC (recorded->page) + recorded->start);
+        uintptr_t end = (uintptr_t) GetPagePC (recorded->page);
+
+        if (i_pc < start)
+            high = middle;
+        else if (i_pc > end or (i_pc == end and not i_inclusive))
+            low = middle + 1;
+        else
+        {
+            if ((i_pc - start) % sizeof (code_t))
+                return false;
+
+            * o_page = middle;
+            * o_line = (u32) ((i_pc - start) / sizeof (code_t));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+static
+M3Result  ClassifyPointer  (M3CachedRelocation * o_relocation, IM3Module i_module, IM3CodeRecording i_recording, uintptr_t i_value)
+{
+    M3Result result = m3Err_none;
+
+    u32 page, line;
+
+    if (LocateRecordedPC (i_recording, i_value, true, & page, & line))
+    {
+        _throwif ("the code can't be relocated", page > UINT16_MAX);
+
+        o_relocation->kind = c_reloc_pc;
+        o_relocation->page = page;
+        o_relocation->value = line;
+    }
+    else if (i_value == (uintptr_t) i_module)
+    {
+        o_relocation->kind = c_reloc_module;
+    }
+    else
+    {
+        uintptr_t functions = (uintptr_t) i_module->functions;
+        uintptr_t functionsEnd = (uintptr_t) (i_module->functions + i_module->numFunctions);
+
+        if (i_value >= functions and i_value < functionsEnd)
+        {
+            _throwif ("the code can't be relocated", (i_value - functions) % sizeof (M3Function));
+
+            o_relocation->kind = c_reloc_function;
+            o_relocation->value = (i32) ((i_value - functions) / sizeof (M3Function));
+            return result;
+        }
+
+        for (u32 i = 0; i < i_module->numFuncTypes; ++i)
+        {
+            if (i_value == (uintptr_t) i_module->funcTypes [i])
+            {
+                o_relocation->kind = c_reloc_funcType;
+                o_relocation->value = i;
+                return result;
+            }
+        }
+
+        // calls to the functions that were compiled before (or linked): imports mostly, so there are few of them
+        for (u32 i = 0; i < i_module->numFunctions; ++i)
+        {
+            if (i_value == (uintptr_t) i_module->functions [i].compiled)
+            {
+                o_relocation->kind = c_reloc_entry;
+                o_relocation->value = i;
+                return result;
+            }
+        }
+
+        _throw ("the code can't be relocated");
+    }
+
+    _catch: return result;
+}
+
+
+static
+M3Result  WriteCacheFile  (const char * i_path, const void * i_parts [], const size_t i_sizes [], u32 i_numParts)
+{
+    M3Result result = m3Err_none;
+
+    static const u8 c_padding [8] = { 0 };
+
+    FILE * file = NULL;
+    bool written = true;
+
+    // written aside, then moved into place, so that a file in the cache is always complete
+    char tempPath [4096];
+    _throwif ("cache path too long", snprintf (tempPath, sizeof (tempPath), "%s.%d.tmp", i_path, (int) getpid ()) >= (int) sizeof (tempPath));
+
+    file = fopen (tempPath, "wb");
+    _throwif ("can't write the code cache", not file);
+
+    for (u32 i = 0; i < i_numParts; ++i)
+    {
+        if (i_sizes [i])
+            written = written and fwrite (i_parts [i], i_sizes [i], 1, file) == 1;
+
+        size_t padding = Align8 (i_sizes [i]) - i_sizes [i];
+        if (padding)
+            written = written and fwrite (c_padding, padding, 1, file) == 1;
+    }
+
+    written = (fclose (file) == 0) and written;
+    written = written and rename (tempPath, i_path) == 0;
+
+    if (not written)
+    {
+        unlink (tempPath);
+        _throw ("can't write the code cache");
+    }
+
+    _catch: return result;
+}
+
+
+static
+M3Result  SaveCompiledCode  (IM3Module i_module, IM3CodeRecording io_recording, const char * i_path, M3CodeCacheHeader * io_header)
+{
+    M3Result result = m3Err_none;
+
+    M3CachedPage * pages = NULL;
+    code_t * words = NULL;
+    M3CachedFunction * functions = NULL;
+    u8 * constants = NULL;
+    M3CachedRelocation * relocations = NULL;
+    M3CachedRelocation * emitted = NULL;
+    u32 * emittedPages = NULL;
+    M3CachedMapping * mappings = NULL;
+
+    u32 numLines = 0, numFunctions = 0, numConstantBytes = 0, numRelocations = 0, numMappings = 0;
+    u32 numPages = io_recording->numPages;
+    u32 maxMappings = 0;
+
+    uintptr_t anchor = (uintptr_t) GetAnchorOperationCode ();
+
+    qsort (io_recording->pages, io_recording->numPages, sizeof (M3RecordedPage), CompareRecordedPages);
+
+    _throwif ("no code to cache", not numPages);
+
+    pages = m3_AllocArray (M3CachedPage, numPages);
+    _throwifnull (pages);
+
+    for (u32 p = 0; p < numPages; ++p)
+    {
+        M3RecordedPage * recorded = & io_recording->pages [p];
+
+        pages [p].numLines = recorded->page->info.lineIndex - recorded->start;
+        numLines += pages [p].numLines;
+    }
+
+    words = m3_AllocArray (code_t, numLines);
+    _throwifnull (words);
+
+    for (u32 p = 0, copied = 0; p < numPages; ++p)
+    {
+        M3RecordedPage * recorded = & io_recording->pages [p];
+
+        memcpy (words + copied, GetPageStartPC (recorded->page) + recorded->start, pages [p].numLines * sizeof (code_t));
+        copied += pages [p].numLines;
+    }
+
+    // the functions compiled into the pages
+    functions = m3_AllocArray (M3CachedFunction, i_module->numFunctions);
+    _throwifnull (functions);
+
+    for (u32 i = 0; i < i_module->numFunctions; ++i)
+    {
+        IM3Function function = & i_module->functions [i];
+
+        u32 page, line;
+        if (function->wasm and function->compiled and LocateRecordedPC (io_recording, (uintptr_t) function->compiled, false, & page, & line))
+        {
+            M3CachedFunction * cached = & functions [numFunctions++];
+
+            cached->index = i;
+            cached->page = page;
+            cached->line = line;
+            cached->constants = numConstantBytes;
+
+            cached->maxStackSlots = function->maxStackSlots;
+            cached->numRetSlots = function->numRetSlots;
+            cached->numRetAndArgSlots = function->numRetAndArgSlots;
+            cached->numLocals = function->numLocals;
+            cached->numLocalBytes = function->numLocalBytes;
+            cached->zeroedLocalsOffset = function->zeroedLocalsOffset;
+            cached->numZeroedLocalBytes = function->numZeroedLocalBytes;
+            cached->numConstantBytes = function->numConstantBytes;
+
+            numConstantBytes += function->numConstantBytes;
+        }
+    }
+
+    _throwif ("no code to cache", not numFunctions);
+
+    constants = (u8 *) m3_Malloc ("Cached Constants", numConstantBytes + 1);
+    _throwifnull (constants);
+
+    for (u32 i = 0; i < numFunctions; ++i)
+    {
+        IM3Function function = & i_module->functions [functions [i].index];
+
+        if (function->numConstantBytes)
+            memcpy (constants + functions [i].constants, function->constants, function->numConstantBytes);
+    }
+
+    // the words are classified in the order they were emitted, then grouped by page
+    relocations = m3_AllocArray (M3CachedRelocation, io_recording->numWords + 1);
+    _throwifnull (relocations);
+    emitted = m3_AllocArray (M3CachedRelocation, io_recording->numWords + 1);
+    _throwifnull (emitted);
+    emittedPages = m3_AllocArray (u32, io_recording->numWords + 1);
+    _throwifnull (emittedPages);
+
+    for (u32 i = 0; i < io_recording->numWords; ++i)
+    {
+        uintptr_t word = io_recording->words [i];
+        bool isOperation = word & 1;
+        word &= ~(uintptr_t) 1;
+
+        M3CachedRelocation * relocation = & emitted [numRelocations];
+        M3_INIT (* relocation);
+
+        u32 page;
+        _throwif ("the code can't be relocated", not LocateRecordedPC (io_recording, word, false, & page, & relocation->line));
+
+        uintptr_t value = * (uintptr_t *) word;
+
+        if (isOperation)
+        {
+            i64 offset = (i64) (value - anchor);
+            _throwif ("the code can't be relocated", offset != (i32) offset);
+
+            relocation->kind = c_reloc_operation;
+            relocation->value = (i32) offset;
+        }
+        else if (value)
+        {
+_           (ClassifyPointer (relocation, i_module, io_recording, value));
+        }
+        else continue;  // a null pointer stays null
+
+        emittedPages [numRelocations++] = page;
+        pages [page].numRelocations++;
+    }
+
+    for (u32 p = 0, first = 0; p < numPages; ++p)
+    {
+        u32 numPageRelocations = pages [p].numRelocations;
+        pages [p].numRelocations = first;       // for now, the first of the page's
+        first += numPageRelocations;
+    }
+
+    for (u32 i = 0; i < numRelocations; ++i)
+        relocations [pages [emittedPages [i]].numRelocations++] = emitted [i];
+
+    for (u32 p = numPages; p-- > 0;)
+        pages [p].numRelocations -= (p ? pages [p - 1].numRelocations : 0);
+
+# if d_m3RecordBacktraces
+    for (u32 p = 0; p < numPages; ++p)
+        maxMappings += io_recording->pages [p].page->info.mapping->size;
+
+    mappings = m3_AllocArray (M3CachedMapping, maxMappings + 1);
+    _throwifnull (mappings);
+
+    for (u32 p = 0; p < numPages; ++p)
+    {
+        M3RecordedPage * recorded = & io_recording->pages [p];
+        M3CodeMappingPage * mapping = recorded->page->info.mapping;
+
+        for (u32 i = 0; i < mapping->size; ++i)
+        {
+            u32 entryLine = mapping->entries [i].pcOffset;
+
+            if (entryLine >= recorded->start and entryLine < recorded->page->info.lineIndex)
+            {
+                M3CachedMapping * cached = & mappings [numMappings++];
+                M3_INIT (* cached);
+
+                cached->page = p;
+                cached->line = entryLine - recorded->start;
+                cached->moduleOffset = mapping->entries [i].moduleOffset;
+            }
+        }
+    }
+# endif
+
+    io_header->numPages = numPages;
+    io_header->numLines = numLines;
+    io_header->numFunctions = numFunctions;
+    io_header->numConstantBytes = numConstantBytes;
+    io_header->numRelocations = numRelocations;
+    io_header->numMappings = numMappings;
+
+    {
+        const void * parts [] = { io_header, pages, words, functions, constants, relocations, mappings };
+        const size_t sizes [] = { sizeof (M3CodeCacheHeader),
+                                  numPages * sizeof (M3CachedPage),
+                                  numLines * sizeof (code_t),
+                                  numFunctions * sizeof (M3CachedFunction),
+                                  numConstantBytes,
+                                  numRelocations * sizeof (M3CachedRelocation),
+                                  numMappings * sizeof (M3CachedMapping) };
+
+_       (WriteCacheFile (i_path, parts, sizes, 7));
+    }
+                                                                        m3log (runtime, "cached code: %s; pages: %d; functions: %d; relocations: %d",
+                                                                               i_path, numPages, numFunctions, numRelocations);
+    _catch:
+
+    m3_Free (pages);
+    m3_Free (words);
+    m3_Free (functions);
+    m3_Free (constants);
+    m3_Free (relocations);
+    m3_Free (emitted);
+    m3_Free (emittedPages);
+    m3_Free (mappings);
+
+    return result;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+
+typedef struct M3CodeCacheFile
+{
+    const M3CodeCacheHeader *   header;
+    const M3CachedPage *        pages;
+    const code_t *              words;
+    const M3CachedFunction *    functions;
+    const u8 *                  constants;
+    const M3CachedRelocation *  relocations;
+    const M3CachedMapping *     mappings;
+}
+M3CodeCacheFile;
+
+
+static
+M3Result  ReadCacheFile  (M3CodeCacheFile * o_file, const u8 * i_bytes, size_t i_size, const M3CodeCacheHeader * i_expected)
+{
+    M3Result result = m3Err_none;
+
+    const M3CodeCacheHeader * header = (const M3CodeCacheHeader *) i_bytes;
+    size_t offset = sizeof (M3CodeCacheHeader);
+    u64 numLines = 0, numRelocations = 0;
+
+    _throwif ("stale code cache", i_size < sizeof (M3CodeCacheHeader)
+                                   or memcmp (header->magic, i_expected->magic, sizeof (header->magic))
+                                   or header->version != i_expected->version
+                                   or header->flags != i_expected->flags
+                                   or header->buildId != i_expected->buildId
+                                   or header->moduleHash != i_expected->moduleHash
+                                   or header->moduleSize != i_expected->moduleSize
+                                   or header->numModuleFunctions != i_expected->numModuleFunctions);
+
+    o_file->header = header;
+
+    o_file->pages = (const M3CachedPage *) (i_bytes + offset);
+    offset += Align8 ((size_t) header->numPages * sizeof (M3CachedPage));
+    o_file->words = (const code_t *) (i_bytes + offset);
+    offset += Align8 ((size_t) header->numLines * sizeof (code_t));
+    o_file->functions = (const M3CachedFunction *) (i_bytes + offset);
+    offset += Align8 ((size_t) header->numFunctions * sizeof (M3CachedFunction));
+    o_file->constants = i_bytes + offset;
+    offset += Align8 ((size_t) header->numConstantBytes);
+    o_file->relocations = (const M3CachedRelocation *) (i_bytes + offset);
+    offset += Align8 ((size_t) header->numRelocations * sizeof (M3CachedRelocation));
+    o_file->mappings = (const M3CachedMapping *) (i_bytes + offset);
+    offset += Align8 ((size_t) header->numMappings * sizeof (M3CachedMapping));
+
+    _throwif ("corrupt code cache", offset != i_size);
+
+    for (u32 p = 0; p < header->numPages; ++p)
+    {
+        numLines += o_file->pages [p].numLines;
+        numRelocations += o_file->pages [p].numRelocations;
+    }
+
+    _throwif ("corrupt code cache", numLines != header->numLines or numRelocations != header->numRelocations);
+
+    _catch: return result;
+}
+
+
+static
+M3Result  RelocateCompiledCode  (IM3Module io_module, const M3CodeCacheFile * i_file)
+{
+    M3Result result = m3Err_none;
+
+    IM3Runtime runtime = io_module->runtime;
+
+    const M3CodeCacheHeader * header = i_file->header;
+    const M3CachedPage * cachedPages = i_file->pages;
+    const code_t * pageWords = i_file->words;
+    const M3CachedFunction * functions = i_file->functions;
+    const M3CachedRelocation * relocation = i_file->relocations;
+
+    IM3CodePage * pages = NULL;
+    u32 * pageStarts = NULL;
+    u32 numAcquired = 0;
+    u32 numCallStubs = io_module->callStubs.numStubs;
+
+    uintptr_t anchor = (uintptr_t) GetAnchorOperationCode ();
+    code_t stubOperation = GetCallStubOperationCode ();
+
+    for (u32 i = 0; i < header->numFunctions; ++i)
+    {
+        const M3CachedFunction * cached = & functions [i];
+
+        _throwif ("corrupt code cache", cached->index >= io_module->numFunctions
+                                         or cached->page >= header->numPages
+                                         or cached->line >= cachedPages [cached->page].numLines
+                                         or (u64) cached->constants + cached->numConstantBytes > header->numConstantBytes);
+
+        IM3Function function = & io_module->functions [cached->index];
+        _throwif ("functions already compiled", not function->wasm or function->compiled);
+    }
+
+    // the code goes at the end of pages of the runtime, each in one piece
+    pages = m3_AllocArray (IM3CodePage, header->numPages + 1);
+    _throwifnull (pages);
+    pageStarts = m3_AllocArray (u32, header->numPages + 1);
+    _throwifnull (pageStarts);
+
+    for (u32 p = 0; p < header->numPages; ++p)
+    {
+        u32 pageLines = cachedPages [p].numLines;
+
+        IM3CodePage page = AcquireCodePageWithCapacity (runtime, pageLines);
+        _throwif (m3Err_mallocFailedCodePage, not page);
+
+        pages [numAcquired] = page;
+        pageStarts [numAcquired++] = page->info.lineIndex;
+
+        memcpy ((code_t *) GetPagePC (page), pageWords, pageLines * sizeof (code_t));
+        page->info.lineIndex += pageLines;
+
+        pageWords += pageLines;
+    }
+
+    for (u32 p = 0; p < header->numPages; ++p)
+    {
+        code_t * base = (code_t *) GetPageStartPC (pages [p]) + pageStarts [p];
+        const M3CachedRelocation * pageRelocations = relocation;
+
+        for (u32 i = 0; i < cachedPages [p].numRelocations; ++i, ++relocation)
+        {
+            _throwif ("corrupt code cache", relocation->line >= cachedPages [p].numLines);
+
+            u32 index = (u32) relocation->value;
+            uintptr_t value = 0;
+
+            switch (relocation->kind)
+            {
+                case c_reloc_operation:
+                    value = anchor + (uintptr_t) (intptr_t) relocation->value;
+                    break;
+
+                case c_reloc_pc:
+                    _throwif ("corrupt code cache", relocation->page >= header->numPages or index > cachedPages [relocation->page].numLines);
+                    value = (uintptr_t) (GetPageStartPC (pages [relocation->page]) + pageStarts [relocation->page] + index);
+                    break;
+
+                case c_reloc_entry:
+                    _throwif ("corrupt code cache", index >= io_module->numFunctions);
+                    value = (uintptr_t) io_module->functions [index].compiled;
+                    _throwif ("a function the code calls isn't compiled or linked", not value);
+                    break;
+
+                case c_reloc_function:
+                    _throwif ("corrupt code cache", index >= io_module->numFunctions);
+                    value = (uintptr_t) & io_module->functions [index];
+                    break;
+
+                case c_reloc_funcType:
+                    _throwif ("corrupt code cache", index >= io_module->numFuncTypes);
+                    value = (uintptr_t) io_module->funcTypes [index];
+                    break;
+
+                case c_reloc_module:
+                    value = (uintptr_t) io_module;
+                    break;
+
+                default:
+                    _throw ("corrupt code cache");
+            }
+
+            base [relocation->line] = (code_t) value;
+        }
+
+        // the calls left to op_Compile are listed, as if compiled here; see ShareCompiledCode
+        for (const M3CachedRelocation * stub = pageRelocations; stub < relocation; ++stub)
+        {
+            if (stub->kind == c_reloc_operation and base [stub->line] == stubOperation)
+            {
+                _throwif ("corrupt code cache", stub->line + 1 >= cachedPages [p].numLines);
+_               (Module_AddCallStub (io_module, (pc_t) (base + stub->line), (IM3Function) base [stub->line + 1]));
+            }
+        }
+    }
+
+# if d_m3RecordBacktraces
+    for (u32 i = 0; i < header->numMappings; ++i)
+    {
+        const M3CachedMapping * cached = & i_file->mappings [i];
+        _throwif ("corrupt code cache", cached->page >= header->numPages or cached->line >= cachedPages [cached->page].numLines);
+
+        M3CodeMappingPage * mapping = pages [cached->page]->info.mapping;
+        _throwif ("corrupt code cache", mapping->size >= mapping->capacity);
+
+        M3CodeMapEntry * entry = & mapping->entries [mapping->size++];
+        entry->pcOffset = pageStarts [cached->page] + cached->line;
+        entry->moduleOffset = cached->moduleOffset;
+    }
+# endif
+
+    for (u32 i = 0; i < header->numFunctions; ++i)
+    {
+        const M3CachedFunction * cached = & functions [i];
+        IM3Function function = & io_module->functions [cached->index];
+
+        if (cached->numConstantBytes)
+        {
+            function->constants = m3_CopyMem (i_file->constants + cached->constants, cached->numConstantBytes);
+            _throwifnull (function->constants);
+        }
+
+        function->maxStackSlots = cached->maxStackSlots;
+        function->numRetSlots = cached->numRetSlots;
+        function->numRetAndArgSlots = cached->numRetAndArgSlots;
+        function->numLocals = cached->numLocals;
+        function->numLocalBytes = cached->numLocalBytes;
+        function->zeroedLocalsOffset = cached->zeroedLocalsOffset;
+        function->numZeroedLocalBytes = cached->numZeroedLocalBytes;
+        function->numConstantBytes = cached->numConstantBytes;
+
+        SetCompiledCode (function, GetPageStartPC (pages [cached->page]) + pageStarts [cached->page] + cached->line);
+    }
+                                                                        m3log (runtime, "loaded cached code; pages: %d; functions: %d",
+                                                                               header->numPages, header->numFunctions);
+    _catch:
+
+    if (result)
+        io_module->callStubs.numStubs = numCallStubs;       // they were in the lines given back
+
+    for (u32 p = 0; p < numAcquired; ++p)
+    {
+        if (result)
+        {
+            // the lines are given back. no function points at them
+            pages [p]->info.lineIndex = pageStarts [p];
+# if d_m3RecordBacktraces
+            M3CodeMappingPage * mapping = pages [p]->info.mapping;
+            while (mapping->size and mapping->entries [mapping->size - 1].pcOffset >= pageStarts [p])
+                mapping->size--;
+# endif
+        }
+
+        ReleaseCodePage (runtime, pages [p]);
+    }
+
+    m3_Free (pages);
+    m3_Free (pageStarts);
+
+    return result;
+}
+
+
+static
+M3Result  LoadCompiledCode  (IM3Module io_module, const char * i_path, const M3CodeCacheHeader * i_expected)
+{
+    M3Result result = m3Err_none;
+
+    struct stat info;
+    void * bytes = MAP_FAILED;
+    M3CodeCacheFile file;
+
+    int fd = open (i_path, O_RDONLY | O_CLOEXEC);
+    _throwif ("no cached code", fd < 0);
+
+    if (fstat (fd, & info) == 0 and info.st_size > 0)
+        bytes = mmap (NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close (fd);
+    _throwif ("no cached code", bytes == MAP_FAILED);
+
+    result = ReadCacheFile (& file, (const u8 *) bytes, (size_t) info.st_size, i_expected);
+
+    if (not result)
+        result = RelocateCompiledCode (io_module, & file);
+
+    munmap (bytes, (size_t) info.st_size);
+
+    _catch: return result;
+}
+
+
+static
+bool  GetCachePath  (char * o_path, size_t i_size, M3CodeCacheHeader * o_header, IM3Module i_module, const char * i_cacheDir)
+{
+    IM3Runtime runtime = i_module->runtime;
+
+# if d_m3EnableJit
+    // the JIT translates from lists of operations that aren't cached
+    if (runtime->jit.enabled)
+        return false;
+# endif
+# if d_m3EnableParallelCompile
+    // some functions may be compiled already, some not yet: there's no telling what would be recorded
+    if (runtime->background)
+        return false;
+# endif
+
+    M3_INIT (* o_header);
+
+    if (not i_cacheDir or not i_module->wasmStart or not GetBuildId (& o_header->buildId))
+        return false;
+
+    memcpy (o_header->magic, c_codeCacheMagic, sizeof (o_header->magic));
+    o_header->version = c_codeCacheVersion;
+# if d_m3EnableGasMetering
+    if (runtime->meterGas)
+        o_header->flags |= c_codeCache_gasMetering;
+# endif
+    o_header->moduleSize = (u64) (i_module->wasmEnd - i_module->wasmStart);
+    o_header->moduleHash = HashBytes (c_hashSeed, i_module->wasmStart, o_header->moduleSize);
+    o_header->numModuleFunctions = i_module->numFunctions;
+
+    int length = snprintf (o_path, i_size, "%s/%016" PRIx64 "-%016" PRIx64 "-%" PRIx32 ".m3code", i_cacheDir,
+                           o_header->moduleHash, o_header->buildId, o_header->flags);
+
+    return length > 0 and (size_t) length < i_size;
+}
+
+
+M3Result  m3_CompileModuleCached  (IM3Module io_module, const char * i_cacheDir)
+{
+    M3Result result = m3Err_none;
+
+    IM3Runtime runtime = io_module->runtime;
+    if (not runtime)
+        return m3Err_moduleNotLinked;
+
+    char path [4096];
+    M3CodeCacheHeader header;
+
+    if (GetCachePath (path, sizeof (path), & header, io_module, i_cacheDir))
+    {
+        // whatever the cache didn't have is compiled as usual
+        if (not LoadCompiledCode (io_module, path, & header))
+            return m3_CompileModule (io_module);
+
+        M3CodeRecording recording;
+        M3_INIT (recording);
+
+        runtime->codeRecording = & recording;
+        result = m3_CompileModule (io_module);
+        runtime->codeRecording = NULL;
+
+        // the cache is only an optimization; if it can't be written, so be it
+        if (not result and not recording.failed)
+            SaveCompiledCode (io_module, & recording, path, & header);
+
+        m3_Free (recording.pages);
+        m3_Free (recording.words);
+    }
+    else result = m3_CompileModule (io_module);
+
+    return result;
+}
+
+#else // d_m3EnableCodeCache
+
+M3Result  m3_CompileModuleCached  (IM3Module io_module, const char * i_cacheDir)
+{
+    return m3_CompileModule (io_module);
+}
+
+#endif // d_m3EnableCodeCache
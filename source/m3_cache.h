@@ -0,0 +1,59 @@
+//
+//  m3_cache.h
+//
+//  Copyright © 2026 Wasm3 contributors.
+//  All rights reserved.
+//
+
+#ifndef m3_cache_h
+#define m3_cache_h
+
+#include "m3_code.h"
+
+d_m3BeginExternC
+
+#if d_m3EnableCodeCache
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// a cache of compiled code. while m3_CompileModuleCached compiles a module, the pages it takes & the words of the metacode that
+// hold an operation or a pointer are recorded. the pages are then written out, along with how to relocate each of those words:
+// operations relative to one of them, pcs as a page & line, functions & types as their index in the module. loading copies the
+// pages into the runtime & relocates them in a single pass
+//---------------------------------------------------------------------------------------------------------------------------------
+
+typedef struct M3RecordedPage
+{
+    IM3CodePage             page;
+    u32                     start;          // the line the module's code starts at
+}
+M3RecordedPage;
+
+typedef struct M3CodeRecording
+{
+    M3RecordedPage *        pages;
+    u32                     numPages;
+    u32                     maxPages;
+
+    uintptr_t *             words;          // the address of each op & pointer emitted; the low bit is set for the ops
+    u32                     numWords;
+    u32                     maxWords;
+
+    bool                    failed;         // ran out of memory; nothing is written then
+}
+M3CodeRecording;
+
+typedef M3CodeRecording *   IM3CodeRecording;
+
+
+void        CodeCache_RecordPage        (IM3CodeRecording io_recording, IM3CodePage i_page);
+void        CodeCache_RecordWord        (IM3CodeRecording io_recording, pc_t i_pc, bool i_isOperation);
+
+// the operations are relocated relative to this one; it's in m3_compile.c, which owns the op_ functions
+code_t      GetAnchorOperationCode      (void);
+code_t      GetCallStubOperationCode    (void);
+
+#endif // d_m3EnableCodeCache
+
+d_m3EndExternC
+
+#endif // m3_cache_h
@@ -5,12 +5,93 @@
 //  Copyright © 2019 Steven Massey. All rights reserved.
 //
 
+#if defined(__linux__)
+#define _DEFAULT_SOURCE     // MAP_ANONYMOUS, MADV_HUGEPAGE
+#endif
+
 #include <limits.h>
 #include "m3_code.h"
 #include "m3_env.h"
 
+#if d_m3UseHugePages
+#   include <sys/mman.h>
+#endif
+
 //---------------------------------------------------------------------------------------------------------------------------------
 
+#if d_m3UseHugePages
+
+static const size_t         c_m3HugePageSize            = 2 * 1024 * 1024;
+
+
+static
+M3CodeArena *  NewCodeArena  (size_t i_minSize)
+{
+    size_t size = (i_minSize + sizeof (M3CodeArena) + c_m3HugePageSize - 1) & ~(c_m3HugePageSize - 1);
+
+    // over-reserved, then trimmed to a huge page boundary on both ends
+    u8 * reserved = (u8 *) mmap (NULL, size + c_m3HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED)
+        return NULL;
+
+    u8 * start = (u8 *) (((uintptr_t) reserved + c_m3HugePageSize - 1) & ~(uintptr_t) (c_m3HugePageSize - 1));
+
+    if (start > reserved)
+        munmap (reserved, start - reserved);
+    if (reserved + c_m3HugePageSize > start)
+        munmap (start + size, reserved + c_m3HugePageSize - start);
+
+    madvise (start, size, MADV_HUGEPAGE);
+
+    M3CodeArena * arena = (M3CodeArena *) start;
+    arena->size = size;
+    arena->free = start + ((sizeof (M3CodeArena) + 63) & ~63);
+    arena->end = start + size;
+
+    return arena;
+}
+
+
+static
+void *  AllocateFromCodeArena  (IM3Environment io_environment, size_t i_size)
+{
+    M3CodeArena * arena = io_environment->codeArenas;
+
+    // what's left of the last one is given up on, once a page doesn't fit
+    if (not arena or (size_t) (arena->end - arena->free) < i_size)
+    {
+        arena = NewCodeArena (i_size);
+        if (not arena)
+            return NULL;
+
+        arena->next = io_environment->codeArenas;
+        io_environment->codeArenas = arena;
+    }
+
+    void * page = arena->free;
+    arena->free += i_size;
+
+    return page;
+}
+
+
+void  FreeCodeArenas  (M3CodeArena ** io_list)
+{
+    M3CodeArena * arena = * io_list;
+
+    while (arena)
+    {
+        M3CodeArena * next = arena->next;
+        munmap (arena, arena->size);
+        arena = next;
+    }
+
+    * io_list = NULL;
+}
+
+#endif // d_m3UseHugePages
+
+
 
 IM3CodePage  NewCodePage  (IM3Runtime i_runtime, u32 i_minNumLines)
 {
@@ -33,7 +114,12 @@ IM3CodePage  NewCodePage  (IM3Runtime i_runtime, u32 i_minNumLines)
         return NULL;
     }
 
+#if d_m3UseHugePages
+    // zero-filled, as m3_Malloc's are
+    page = (IM3CodePage) AllocateFromCodeArena (i_runtime->environment, pageSize);
+#else
     page = (IM3CodePage)m3_Malloc ("M3CodePage", pageSize);
+#endif
 
     if (page)
     {
@@ -51,7 +137,9 @@ IM3CodePage  NewCodePage  (IM3Runtime i_runtime, u32 i_minNumLines)
         }
         else
         {
-            m3_Free (page);
+#if !d_m3UseHugePages
+            m3_Free (page);     // out of an arena, it goes back with the environment
+#endif
             return NULL;
         }
         page->info.mapping->basePC = GetPageStartPC(page);
@@ -76,7 +164,9 @@ void  FreeCodePages  (IM3CodePage * io_list)
 #if d_m3RecordBacktraces
         m3_Free (page->info.mapping);
 #endif // d_m3RecordBacktraces
+#if !d_m3UseHugePages
         m3_Free (page);
+#endif
         page = next;
     }
 
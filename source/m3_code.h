@@ -26,6 +26,20 @@ IM3CodePage             NewCodePage             (IM3Runtime i_runtime, u32 i_min
 
 void                    FreeCodePages           (IM3CodePage * io_list);
 
+# if d_m3UseHugePages
+// the memory the code pages of an environment are carved from; it's only given back with the environment
+typedef struct M3CodeArena
+{
+    struct M3CodeArena *    next;
+    size_t                  size;
+    u8 *                    free;
+    u8 *                    end;
+}
+M3CodeArena;
+
+void                    FreeCodeArenas          (M3CodeArena ** io_list);
+# endif
+
 u32                     NumFreeLines            (IM3CodePage i_page);
 pc_t                    GetPageStartPC          (IM3CodePage i_page);
 pc_t                    GetPagePC               (IM3CodePage i_page);
@@ -38,7 +38,19 @@ M3Result  EnsureCodePageNumLines  (IM3Compilation o, u32 i_numLines)
             m3log (emit, "bridging new code page from: %d %p (free slots: %d) to: %d", o->page->info.sequence, GetPC (o), NumFreeLines (o->page), page->info.sequence);
             d_m3Assert (NumFreeLines (o->page) >= 2);
 
-            EmitWord (o->page, op_Branch);
+# if d_m3EnableJit
+            // the bridge is an operation too; falling through to the new page would leave _pc behind
+            if (o->runtime->jit.enabled)
+                result = Jit_RecordOperation (& o->runtime->jit, GetPC (o));
+# endif
+# if d_m3EnableCodeCache
+            if (o->runtime->codeRecording)
+            {
+                CodeCache_RecordWord (o->runtime->codeRecording, GetPC (o), true);
+                CodeCache_RecordWord (o->runtime->codeRecording, GetPC (o) + 1, false);
+            }
+# endif
+            EmitWord (o->page, GetOperationCode (op_Branch));
             EmitWord (o->page, GetPagePC (page));
 
             ReleaseCodePage (o->runtime, o->page);
@@ -70,9 +82,17 @@ M3Result  EmitOp  (IM3Compilation o, IM3Operation i_operation)
         if (not result)
         {                                                           if (d_m3LogEmit) log_emit (o, i_operation);
 # if d_m3RecordBacktraces
-            EmitMappingEntry (o->page, o->lastOpcodeStart - o->module->wasmStart);
+            EmitMappingEntry (o->page, o->function ? o->function->wasmOffset + (u32) (o->lastOpcodeStart - o->function->wasm) : 0);
 # endif // d_m3RecordBacktraces
-            EmitWord (o->page, i_operation);
+# if d_m3EnableJit
+            if (o->runtime->jit.enabled)
+                result = Jit_RecordOperation (& o->runtime->jit, GetPC (o));
+# endif
+# if d_m3EnableCodeCache
+            if (o->runtime->codeRecording)
+                CodeCache_RecordWord (o->runtime->codeRecording, GetPC (o), true);
+# endif
+            EmitWord (o->page, GetOperationCode (i_operation));
         }
     }
 
@@ -100,7 +120,13 @@ pc_t  EmitPointer  (IM3Compilation o, const void * const i_pointer)
     pc_t ptr = GetPagePC (o->page);
 
     if (o->page)
+    {
+# if d_m3EnableCodeCache
+        if (o->runtime->codeRecording)
+            CodeCache_RecordWord (o->runtime->codeRecording, ptr, false);
+# endif
         EmitWord (o->page, i_pointer);
+    }
 
     return ptr;
 }
@@ -141,6 +167,10 @@ static const IM3Operation c_setGlobalOps [] =    { NULL, op_SetGlobal_i32,
 static const IM3Operation c_setRegisterOps [] =  { NULL, op_SetRegister_i32,           op_SetRegister_i64,
                                                     FPOP(op_SetRegister_f32),     FPOP(op_SetRegister_f64) };
 
+#if d_m3UseSecondRegisters
+static const IM3Operation c_parkRegisterOps [2] = { op_ParkRegister_r0,            FPOP(op_ParkRegister_fp0) };
+#endif
+
 static const IM3Operation c_intSelectOps [2] [4] =      { { op_Select_i32_rss, op_Select_i32_srs, op_Select_i32_ssr, op_Select_i32_sss },
                                                           { op_Select_i64_rss, op_Select_i64_srs, op_Select_i64_ssr, op_Select_i64_sss } };
 #if d_m3HasFloat
@@ -496,6 +526,60 @@ _       (EmitOp (o, c_setSetOps [type]));
     _catch: return result;
 }
 
+#if d_m3UseSecondRegisters
+// a preserve of the register that's about to receive an operation result. the preserved value
+// can't be referenced by the operation itself, so it's a candidate for parking in _r1/_fp1
+static
+M3Result  PreserveResultRegister  (IM3Compilation o, u8 i_registerType)
+{
+    M3Result result = m3Err_none;
+
+    u32 regSelect = IsFpType (i_registerType);
+
+    if (IsRegisterAllocated (o, regSelect))
+    {
+        u16 stackIndex = GetRegisterStackIndex (o, regSelect);
+
+_       (PreserveRegisterIfOccupied (o, i_registerType));
+
+        if (o->page)
+        {
+            o->parkPC           [regSelect] = GetPC (o) - 2;    // SetSlot + slot offset
+            o->parkStackIndex   [regSelect] = stackIndex;
+            o->parkSlot         [regSelect] = o->wasmStack [stackIndex];
+            o->parkOpcodeCount  [regSelect] = o->opcodeCount;
+        }
+    }
+
+    _catch: return result;
+}
+
+static
+bool  ParkRegisterForOperation  (IM3Compilation o, IM3OpInfo i_opInfo)
+{
+    if (i_opInfo->operations [3] and i_opInfo->stackOffset == -1 and IsStackTopInRegister (o) and not IsStackTopMinus1InRegister (o))
+    {
+        u32 regSelect = IsFpType (GetStackTopType (o));
+        u16 stackIndex = GetStackTopIndex (o) - 1;
+
+        // the preserve must have happened during the previous opcode; then nothing else has read the slot yet
+        if (o->parkOpcodeCount [regSelect] and o->parkOpcodeCount [regSelect] + 1 == o->opcodeCount and
+            o->parkStackIndex [regSelect] == stackIndex and
+            o->parkSlot [regSelect] == o->wasmStack [stackIndex])
+        {
+            * (code_t *) o->parkPC [regSelect] = GetOperationCode (c_parkRegisterOps [regSelect]);
+            o->parkOpcodeCount [regSelect] = 0;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+#else
+#   define PreserveResultRegister   PreserveRegisterIfOccupied
+#endif
+
 
 // all values must be in slots before entering loop, if, and else blocks
 // otherwise they'd end up preserve-copied in the block to probably different locations (if/else)
@@ -1146,6 +1230,148 @@ _               (Pop (o));
 
 //-------------------------------------------------------------------------------------------------------------------------
 
+#if d_m3EnableOpFusion
+
+#define d_immediateOpList(TYPE, NAME)   { op_##TYPE##_##NAME##_ri, op_##TYPE##_##NAME##_si }
+#define d_noImmediateOpList             { NULL, NULL }
+
+// indexed by opcode - c_waOp_i32_eq
+static const IM3Operation c_immediateOperations [][2] =
+{
+    d_immediateOpList (i32, Equal),                 d_immediateOpList (i32, NotEqual),                  // 0x46
+    d_immediateOpList (i32, LessThan),              d_immediateOpList (u32, LessThan),
+    d_immediateOpList (i32, GreaterThan),           d_immediateOpList (u32, GreaterThan),
+    d_immediateOpList (i32, LessThanOrEqual),       d_immediateOpList (u32, LessThanOrEqual),
+    d_immediateOpList (i32, GreaterThanOrEqual),    d_immediateOpList (u32, GreaterThanOrEqual),
+
+    d_noImmediateOpList,                                                                                // 0x50 i64.eqz
+    d_immediateOpList (i64, Equal),                 d_immediateOpList (i64, NotEqual),
+    d_immediateOpList (i64, LessThan),              d_immediateOpList (u64, LessThan),
+    d_immediateOpList (i64, GreaterThan),           d_immediateOpList (u64, GreaterThan),
+    d_immediateOpList (i64, LessThanOrEqual),       d_immediateOpList (u64, LessThanOrEqual),
+    d_immediateOpList (i64, GreaterThanOrEqual),    d_immediateOpList (u64, GreaterThanOrEqual),
+
+    d_noImmediateOpList, d_noImmediateOpList, d_noImmediateOpList, d_noImmediateOpList,                 // 0x5b f32 & f64 compares
+    d_noImmediateOpList, d_noImmediateOpList, d_noImmediateOpList, d_noImmediateOpList,
+    d_noImmediateOpList, d_noImmediateOpList, d_noImmediateOpList, d_noImmediateOpList,
+    d_noImmediateOpList, d_noImmediateOpList, d_noImmediateOpList,                                      // 0x67 clz, ctz, popcnt
+
+    d_immediateOpList (i32, Add),                   d_immediateOpList (i32, Subtract),                  // 0x6a
+    d_immediateOpList (i32, Multiply),
+    d_immediateOpList (i32, Divide),                d_immediateOpList (u32, Divide),
+    d_immediateOpList (i32, Remainder),             d_immediateOpList (u32, Remainder),
+    d_immediateOpList (u32, And),                   d_immediateOpList (u32, Or),
+    d_immediateOpList (u32, Xor),                   d_immediateOpList (u32, ShiftLeft),
+    d_immediateOpList (i32, ShiftRight),            d_immediateOpList (u32, ShiftRight),
+    d_immediateOpList (u32, Rotl),                  d_immediateOpList (u32, Rotr),
+
+    d_noImmediateOpList, d_noImmediateOpList, d_noImmediateOpList,                                      // 0x79 clz, ctz, popcnt
+
+    d_immediateOpList (i64, Add),                   d_immediateOpList (i64, Subtract),                  // 0x7c
+    d_immediateOpList (i64, Multiply),
+    d_immediateOpList (i64, Divide),                d_immediateOpList (u64, Divide),
+    d_immediateOpList (i64, Remainder),             d_immediateOpList (u64, Remainder),
+    d_immediateOpList (u64, And),                   d_immediateOpList (u64, Or),
+    d_immediateOpList (u64, Xor),                   d_immediateOpList (u64, ShiftLeft),
+    d_immediateOpList (i64, ShiftRight),            d_immediateOpList (u64, ShiftRight),
+    d_immediateOpList (u64, Rotl),                  d_immediateOpList (u64, Rotr),                      // 0x8a
+};
+
+// a fused operation stands in for several Wasm instructions; the ones it took in after the first are charged
+// as well, so the gas used doesn't depend on d_m3EnableOpFusion. a fused branch ends the run like br_if does
+static inline
+void  ChargeFusedOpcodes  (IM3Compilation o, u32 i_numOpcodes, bool i_isBranch)
+{
+# if d_m3EnableGasMetering
+    if (o->gasRunCost)
+    {
+        * o->gasRunCost += i_numOpcodes;
+
+        if (i_isBranch)
+            o->gasRunCost = NULL;
+    }
+# endif
+}
+
+// T.const c; binop  -->  c becomes an immediate of the operation. it then never takes up a slot in the constant
+// table, which op_Entry copies into the frame on every call. a compare feeding a br_if is left to FuseCompareBranch
+static
+M3Result  FuseConstOperator  (IM3Compilation o, u64 i_value, u8 i_type, bool * o_fused)
+{
+    M3Result result = m3Err_none;
+
+    bytes_t wasm = o->wasm;
+
+    m3opcode_t opcode;
+    bool isCompare;
+    const IM3Operation * ops;
+    IM3Operation op;
+    u8 resultType;
+
+    * o_fused = false;
+
+    if (IsStackPolymorphic (o) or GetNumBlockValuesOnStack (o) < 1 or GetStackTopType (o) != i_type)
+        goto _catch;
+
+    if (wasm >= o->wasmEnd)
+        goto _catch;
+
+    opcode = * wasm++;
+
+    if (i_type == c_m3Type_i32)
+    {
+        isCompare = (opcode >= c_waOp_i32_eq and opcode <= c_waOp_i32_ge_u);
+
+        if (not isCompare and (opcode < c_waOp_i32_add or opcode > c_waOp_i32_rotr))
+            goto _catch;
+    }
+    else
+    {
+        isCompare = (opcode >= c_waOp_i64_eq and opcode <= c_waOp_i64_ge_u);
+
+        if (not isCompare and (opcode < c_waOp_i64_add or opcode > c_waOp_i64_rotr))
+            goto _catch;
+    }
+
+    if (isCompare and wasm < o->wasmEnd and * wasm == c_waOp_branchIf)
+        goto _catch;
+
+    ops = c_immediateOperations [opcode - c_waOp_i32_eq];
+    resultType = GetOpInfo (opcode)->type;
+
+    if (IsStackTopInRegister (o))
+    {
+        op = ops [0];                                               // _ri
+    }
+    else
+    {
+_       (PreserveResultRegister (o, resultType));
+        op = ops [1];                                               // _si
+    }
+                                                                    m3log (compile, d_indent " (fused const %" PRIu64 ")", get_indention_string (o), i_value);
+_   (EmitOp (o, op));
+_   (EmitSlotNumOfStackTopAndPop (o));
+
+    if (o->page)
+    {
+        if (i_type == c_m3Type_i64)
+            EmitWord64 (o->page, i_value);
+        else
+            EmitWord32 (o->page, (u32) i_value);
+    }
+
+_   (PushRegister (o, resultType));
+
+    ChargeFusedOpcodes (o, 1, false);
+
+    o->wasm = wasm;
+    * o_fused = true;
+
+    _catch: return result;
+}
+
+#endif // d_m3EnableOpFusion
+
 static
 M3Result  Compile_Const_i32  (IM3Compilation o, m3opcode_t i_opcode)
 {
@@ -1153,6 +1379,15 @@ M3Result  Compile_Const_i32  (IM3Compilation o, m3opcode_t i_opcode)
 
     i32 value;
 _   (ReadLEB_i32 (& value, & o->wasm, o->wasmEnd));
+
+# if d_m3EnableOpFusion
+    bool fused;
+_   (FuseConstOperator (o, (u32) value, c_m3Type_i32, & fused));
+
+    if (fused)
+        goto _catch;
+# endif
+
 _   (PushConst (o, value, c_m3Type_i32));                       m3log (compile, d_indent " (const i32 = %" PRIi32 ")", get_indention_string (o), value);
     _catch: return result;
 }
@@ -1164,6 +1399,15 @@ M3Result  Compile_Const_i64  (IM3Compilation o, m3opcode_t i_opcode)
 
     i64 value;
 _   (ReadLEB_i64 (& value, & o->wasm, o->wasmEnd));
+
+# if d_m3EnableOpFusion
+    bool fused;
+_   (FuseConstOperator (o, (u64) value, c_m3Type_i64, & fused));
+
+    if (fused)
+        goto _catch;
+# endif
+
 _   (PushConst (o, value, c_m3Type_i64));                       m3log (compile, d_indent " (const i64 = %" PRIi64 ")", get_indention_string (o), value);
     _catch: return result;
 }
@@ -1287,6 +1531,39 @@ _           (EmitOp (o, op_Return));
 }
 
 
+// a local.set in the function's own block dominates all the code that follows it. so, a local that's written
+// there before it's ever read doesn't need to be cleared on entry. any other local read marks it for clearing
+static
+void  MarkLocalRead  (IM3Compilation o, u32 i_localIndex)
+{
+    if (i_localIndex >= GetFunctionNumArgs (o->function) and not o->isLocalAssigned [i_localIndex])
+    {
+        u16 slot = GetSlotForStackIndex (o, i_localIndex);
+        u16 slotEnd = slot + GetTypeNumSlots (GetStackTypeFromBottom (o, i_localIndex));
+
+        if (o->slotZeroedLocalsEnd)
+        {
+            o->slotFirstZeroedLocal = M3_MIN (o->slotFirstZeroedLocal, slot);
+            o->slotZeroedLocalsEnd = M3_MAX (o->slotZeroedLocalsEnd, slotEnd);
+        }
+        else
+        {
+            o->slotFirstZeroedLocal = slot;
+            o->slotZeroedLocalsEnd = slotEnd;
+        }
+
+        // cleared now, so it's as good as assigned
+        o->isLocalAssigned [i_localIndex] = true;
+    }
+}
+
+static
+void  MarkLocalWritten  (IM3Compilation o, u32 i_localIndex)
+{
+    if (o->block.depth == 0)
+        o->isLocalAssigned [i_localIndex] = true;
+}
+
 static
 M3Result  Compile_SetLocal  (IM3Compilation o, m3opcode_t i_opcode)
 {
@@ -1309,12 +1586,75 @@ _           (PreservedCopyTopSlot (o, localSlot, preserveSlot))
 
         if (i_opcode != c_waOp_teeLocal)
 _           (Pop (o));
+
+        MarkLocalWritten (o, localIndex);
     }
     else _throw ("local index out of bounds");
 
     _catch: return result;
 }
 
+#if d_m3EnableOpFusion
+// local.get x; i32.const c; i32.add (or i32.sub); local.set x  -->  in-place update of the local slot
+static
+M3Result  FuseLocalAddConst  (IM3Compilation o, u32 i_localIndex, bool * o_fused)
+{
+    M3Result result = m3Err_none;
+
+    bytes_t wasm = o->wasm;
+    bytes_t end = o->wasmEnd;
+
+    i32 value;
+    u32 setIndex;
+    bool isSub;
+    u16 localSlot, preserveSlot;
+
+    * o_fused = false;
+
+    if (IsStackPolymorphic (o) or GetStackTypeFromBottom (o, i_localIndex) != c_m3Type_i32)
+        goto _catch;
+
+    if (wasm >= end or * wasm++ != c_waOp_i32_const)
+        goto _catch;
+
+    if (ReadLEB_i32 (& value, & wasm, end))
+        goto _catch;
+
+    if (wasm >= end or (* wasm != c_waOp_i32_add and * wasm != c_waOp_i32_sub))
+        goto _catch;
+
+    isSub = (* wasm++ == c_waOp_i32_sub);
+
+    if (wasm >= end or * wasm++ != c_waOp_setLocal)
+        goto _catch;
+
+    if (ReadLEB_u32 (& setIndex, & wasm, end) or setIndex != i_localIndex)
+        goto _catch;
+
+    localSlot = GetSlotForStackIndex (o, i_localIndex);
+
+_   (FindReferencedLocalWithinCurrentBlock (o, & preserveSlot, localSlot));
+
+    if (preserveSlot != localSlot)
+    {
+_       (EmitOp (o, op_CopySlot_32));
+        EmitSlotOffset (o, preserveSlot);
+        EmitSlotOffset (o, localSlot);
+    }
+                                                                    m3log (compile, d_indent " (fused %s %d)", get_indention_string (o), isSub ? "sub" : "add", value);
+_   (EmitOp (o, op_i32_AddToLocal));
+    EmitSlotOffset (o, localSlot);
+    EmitConstant32 (o, isSub ? 0u - (u32) value : (u32) value);
+
+    ChargeFusedOpcodes (o, 3, false);
+
+    o->wasm = wasm;
+    * o_fused = true;
+
+    _catch: return result;
+}
+#endif
+
 static
 M3Result  Compile_GetLocal  (IM3Compilation o, m3opcode_t i_opcode)
 {
@@ -1326,6 +1666,16 @@ _   (ReadLEB_u32 (& localIndex, & o->wasm, o->wasmEnd));
     if (localIndex >= GetFunctionNumArgsAndLocals (o->function))
         _throw ("local index out of bounds");
 
+    MarkLocalRead (o, localIndex);
+
+# if d_m3EnableOpFusion
+    bool fused;
+_   (FuseLocalAddConst (o, localIndex, & fused));
+
+    if (fused)
+        goto _catch;
+# endif
+
     u8 type = GetStackTypeFromBottom (o, localIndex);
     u16 slot = GetSlotForStackIndex (o, localIndex);
 
@@ -1334,6 +1684,17 @@ _   (Push (o, type, slot));
     } _catch: return result;
 }
 
+// a global is addressed by the byte offset of its slot in the runtime's globals, see d_m3Global
+static
+void  EmitGlobalOffset  (IM3Compilation o, M3Global * i_global)
+{
+    IM3Module module = i_global->module;
+    uintptr_t index = module->globalsIndex + (u32) (i_global - module->globals);
+
+    if (o->page)
+        EmitWord (o->page, index * sizeof (u64));
+}
+
 static
 M3Result  Compile_GetGlobal  (IM3Compilation o, M3Global * i_global)
 {
@@ -1341,7 +1702,7 @@ M3Result  Compile_GetGlobal  (IM3Compilation o, M3Global * i_global)
 
     IM3Operation op = Is64BitType (i_global->type) ? op_GetGlobal_s64 : op_GetGlobal_s32;
 _   (EmitOp (o, op));
-    EmitPointer (o, & i_global->i64Value);
+    EmitGlobalOffset (o, i_global);
 _   (PushAllocatedSlotAndEmit (o, i_global->type));
 
     _catch: return result;
@@ -1364,7 +1725,7 @@ M3Result  Compile_SetGlobal  (IM3Compilation o, M3Global * i_global)
         else op = Is64BitType (type) ? op_SetGlobal_s64 : op_SetGlobal_s32;
 
 _      (EmitOp (o, op));
-        EmitPointer (o, & i_global->i64Value);
+        EmitGlobalOffset (o, i_global);
 
         if (IsStackTopInSlot (o))
             EmitSlotOffset (o, GetStackTopSlotNumber (o));
@@ -1607,10 +1968,23 @@ _   (SetStackPolymorphic (o));
 }
 
 static
-M3Result  CompileCallArgsAndReturn  (IM3Compilation o, u16 * o_stackOffset, IM3FuncType i_type, bool i_isIndirect)
+M3Result  CompileCallArgsAndReturn  (IM3Compilation o, u16 * o_stackOffset, IM3FuncType i_type, bool i_isIndirect, bool i_isTailCall)
 {
 _try {
 
+    if (i_isTailCall)
+    {
+        // the callee's results become the results of this function
+        IM3FuncType functionType = o->function->funcType;
+
+        bool typesMatch = (i_type->numRets == functionType->numRets);
+
+        for (u16 i = 0; typesMatch and i < i_type->numRets; ++i)
+            typesMatch = (d_FuncRetType (i_type, i) == d_FuncRetType (functionType, i));
+
+        _throwif (m3Err_typeMismatch, not typesMatch);
+    }
+
     u16 topSlot = GetMaxUsedSlotPlusOne (o);
 
     // force use of at least one stack slot; this is to help ensure
@@ -1638,6 +2012,10 @@ _       (CopyStackTopToSlot (o, argTop -= c_ioSlotCount));
 _       (Pop (o));
     }
 
+    // a tail call doesn't return here
+    if (i_isTailCall)
+        numRets = 0;
+
     u16 i = 0;
     while (numRets--)
     {
@@ -1652,6 +2030,43 @@ _       (Push (o, type, topSlot));
     } _catch: return result;
 }
 
+M3Result  AddCallStub  (IM3CallStubs io_callStubs, pc_t i_pc, IM3Function i_function)
+{
+    M3Result result = m3Err_none;
+
+    if (io_callStubs->numStubs == io_callStubs->maxStubs)
+    {
+        u32 maxStubs = io_callStubs->maxStubs * 2 + 256;
+        M3CallStub * stubs = m3_ReallocArray (M3CallStub, io_callStubs->stubs, maxStubs, io_callStubs->maxStubs);
+        _throwifnull (stubs);
+
+        io_callStubs->stubs = stubs;
+        io_callStubs->maxStubs = maxStubs;
+    }
+
+    io_callStubs->stubs [io_callStubs->numStubs++] = (M3CallStub){ .pc = i_pc, .function = i_function };
+
+    _catch: return result;
+}
+
+
+void  ResolveCallStubs  (IM3CallStubs i_callStubs)
+{
+    for (u32 i = 0; i < i_callStubs->numStubs; ++i)
+    {
+        code_t * stub = (code_t *) i_callStubs->stubs [i].pc;
+        IM3Function function = i_callStubs->stubs [i].function;
+
+        // one that failed to compile stays a stub, to be compiled when called
+        if (function->compiled)
+        {
+            stub [1] = (code_t) function->compiled;
+            stub [0] = GetOperationCode (op_Call);
+        }
+    }
+}
+
+
 static
 M3Result  Compile_Call  (IM3Compilation o, m3opcode_t i_opcode)
 {
@@ -1664,18 +2079,30 @@ _   (ReadLEB_u32 (& functionIndex, & o->wasm, o->wasmEnd));
     if (function)
     {                                                                   m3log (compile, d_indent " (func= [%d] '%s'; args= %d)",
                                                                                 get_indention_string (o), functionIndex, m3_GetFunctionName (function), function->funcType->numArgs);
-        if (function->module)
+        // compiled on another thread, a Wasm function's code isn't known (nor to be looked at) until they're all done. in the
+        // background, neither is an import's
+        bool deferred = o->callStubs and (function->wasm or o->callStubs->deferImports);
+
+        if (deferred or function->module)
         {
             u16 slotTop;
-_           (CompileCallArgsAndReturn (o, & slotTop, function->funcType, false));
+            bool isReturnCall = (i_opcode == c_waOp_returnCall);
+            bool isTailCall = isReturnCall and d_m3ReuseTailCallFrames;
+_           (CompileCallArgsAndReturn (o, & slotTop, function->funcType, false, isTailCall));
 
             IM3Operation op;
             const void * operand;
+            pc_t compiled = deferred ? NULL : GetCompiledCode (function);
 
-            if (function->compiled)
+            if (isTailCall)
+            {
+                op = op_TailCall;
+                operand = function;
+            }
+            else if (compiled)
             {
                 op = op_Call;
-                operand = function->compiled;
+                operand = compiled;
             }
             else
             {
@@ -1684,8 +2111,28 @@ _           (CompileCallArgsAndReturn (o, & slotTop, function->funcType, false))
             }
 
 _           (EmitOp     (o, op));
+
+            if (op == op_Compile and o->page)
+            {
+                pc_t stub = GetPC (o) - 1;
+
+                if (o->callStubs and not IsImportedFunction (function))
+_                   (AddCallStub (o->callStubs, stub, function));
+
+_               (Module_AddCallStub (o->module, stub, function));
+            }
+
             EmitPointer (o, operand);
             EmitSlotOffset  (o, slotTop);
+
+            if (isTailCall)
+            {
+_               (SetStackPolymorphic (o));
+            }
+            else if (isReturnCall)
+            {
+_               (Compile_Return (o, i_opcode));
+            }
         }
         else
         {
@@ -1716,14 +2163,33 @@ _       (PreserveRegisterIfOccupied (o, c_m3Type_i32));
 
     u16 execTop;
     IM3FuncType type = o->module->funcTypes [typeIndex];
-_   (CompileCallArgsAndReturn (o, & execTop, type, true));
+    bool isReturnCall = (i_opcode == c_waOp_returnCallIndirect);
+    bool isTailCall = isReturnCall and d_m3ReuseTailCallFrames;
+_   (CompileCallArgsAndReturn (o, & execTop, type, true, isTailCall));
 
-_   (EmitOp         (o, op_CallIndirect));
+_   (EmitOp         (o, isTailCall ? op_TailCallIndirect : op_CallIndirect));
     EmitSlotOffset  (o, tableIndexSlot);
     EmitPointer     (o, o->module);
     EmitPointer     (o, type);              // TODO: unify all types in M3Environment
     EmitSlotOffset  (o, execTop);
 
+    if (not isTailCall)
+    {
+        // inline cache: key & callee. the key can't match until the site resolves a callee
+        if (o->page)
+            EmitWord64  (o->page, ~0ull);
+        EmitPointer     (o, NULL);
+    }
+
+    if (isTailCall)
+    {
+_       (SetStackPolymorphic (o));
+    }
+    else if (isReturnCall)
+    {
+_       (Compile_Return (o, i_opcode));
+    }
+
 } _catch:
     return result;
 }
@@ -2084,16 +2550,140 @@ _   (SetStackPolymorphic (o));
 }
 
 
+#if d_m3EnableOpFusion
+
+#define d_fusedCmpOpList(TYPE, NAME, KIND)  { op_##TYPE##_##NAME##_##KIND##_rs, op_##TYPE##_##NAME##_##KIND##_sr, op_##TYPE##_##NAME##_##KIND##_ss }
+#define d_fusedEqzOpList(TYPE, KIND)        { op_##TYPE##_EqualToZero_##KIND##_r, op_##TYPE##_EqualToZero_##KIND##_s, NULL }
+
+// indexed by opcode - c_waOp_i32_eqz
+#define d_fusedCompareOpTable(KIND)                                                                         \
+{                                                                                                           \
+    d_fusedEqzOpList (i32, KIND),                                                                           \
+    d_fusedCmpOpList (i32, Equal, KIND),                d_fusedCmpOpList (i32, NotEqual, KIND),             \
+    d_fusedCmpOpList (i32, LessThan, KIND),             d_fusedCmpOpList (u32, LessThan, KIND),             \
+    d_fusedCmpOpList (i32, GreaterThan, KIND),          d_fusedCmpOpList (u32, GreaterThan, KIND),          \
+    d_fusedCmpOpList (i32, LessThanOrEqual, KIND),      d_fusedCmpOpList (u32, LessThanOrEqual, KIND),      \
+    d_fusedCmpOpList (i32, GreaterThanOrEqual, KIND),   d_fusedCmpOpList (u32, GreaterThanOrEqual, KIND),   \
+    d_fusedEqzOpList (i64, KIND),                                                                           \
+    d_fusedCmpOpList (i64, Equal, KIND),                d_fusedCmpOpList (i64, NotEqual, KIND),             \
+    d_fusedCmpOpList (i64, LessThan, KIND),             d_fusedCmpOpList (u64, LessThan, KIND),             \
+    d_fusedCmpOpList (i64, GreaterThan, KIND),          d_fusedCmpOpList (u64, GreaterThan, KIND),          \
+    d_fusedCmpOpList (i64, LessThanOrEqual, KIND),      d_fusedCmpOpList (u64, LessThanOrEqual, KIND),      \
+    d_fusedCmpOpList (i64, GreaterThanOrEqual, KIND),   d_fusedCmpOpList (u64, GreaterThanOrEqual, KIND),   \
+}
+
+static const IM3Operation c_fusedBranchIf [][3]         = d_fusedCompareOpTable (BranchIf);
+static const IM3Operation c_fusedContinueLoopIf [][3]   = d_fusedCompareOpTable (ContinueLoopIf);
+
+// compare + br_if: the compare result is consumed by the branch directly, so it's never pushed.
+// only simple branches are fused: forward branches to blocks without results, and loop continues
+// without params. everything else falls back to the regular compare and Compile_Branch.
+static
+M3Result  FuseCompareBranch  (IM3Compilation o, m3opcode_t i_opcode, bool * o_fused)
+{
+    M3Result result = m3Err_none;
+
+    bytes_t wasm = o->wasm;
+
+    u32 depth;
+    IM3CompilationScope scope;
+    const IM3Operation * ops;
+    IM3Operation op;
+    bool isLoop;
+
+    if (wasm >= o->wasmEnd or * wasm++ != c_waOp_branchIf)
+        goto _catch;
+
+    if (ReadLEB_u32 (& depth, & wasm, o->wasmEnd) or GetBlockScope (o, & scope, depth))
+        goto _catch;
+
+    isLoop = (scope->opcode == c_waOp_loop);
+
+    if (isLoop)
+    {
+        if (GetFuncTypeNumParams (scope->type))
+            goto _catch;
+
+        ops = c_fusedContinueLoopIf [i_opcode - c_waOp_i32_eqz];
+    }
+    else
+    {
+        bool isReturn = (scope->depth == 0);
+
+        if (isReturn or GetFuncTypeNumResults (scope->type))
+            goto _catch;
+
+        ops = c_fusedBranchIf [i_opcode - c_waOp_i32_eqz];
+    }
+
+    if (GetOpInfo (i_opcode)->stackOffset == 0)
+        op = IsStackTopInRegister (o) ? ops [0] : ops [1];          // _r, _s
+    else if (IsStackTopInRegister (o))
+        op = ops [0];                                               // _rs
+    else if (IsStackTopMinus1InRegister (o))
+        op = ops [1];                                               // _sr
+    else
+        op = ops [2];                                               // _ss
+                                                                    m3log (compile, d_indent " (fused br_if %d)", get_indention_string (o), depth);
+_   (EmitOp (o, op));
+_   (EmitSlotNumOfStackTopAndPop (o));
+
+    if (ops [2])
+_       (EmitSlotNumOfStackTopAndPop (o));
+
+    if (isLoop)
+        EmitPointer (o, scope->pc);
+    else
+        EmitPatchingBranchPointer (o, scope);
+
+    ChargeFusedOpcodes (o, 1, true);
+
+    o->wasm = wasm;
+    * o_fused = true;
+
+    _catch: return result;
+}
+
+static
+M3Result  FuseOperator  (IM3Compilation o, m3opcode_t i_opcode, bool * o_fused)
+{
+    M3Result result = m3Err_none;
+
+    * o_fused = false;
+
+    if (IsStackPolymorphic (o))
+        return result;
+
+    if (i_opcode >= c_waOp_i32_eqz and i_opcode <= c_waOp_i64_ge_u)
+    {
+        result = FuseCompareBranch (o, i_opcode, o_fused);
+    }
+
+    return result;
+}
+
+#endif // d_m3EnableOpFusion
+
+
 // OPTZ: currently all stack slot indices take up a full word, but
 // dual stack source operands could be packed together
 static
 M3Result  Compile_Operator  (IM3Compilation o, m3opcode_t i_opcode)
 {
     M3Result result;
+    bool isParked = false;
 
     IM3OpInfo opInfo = GetOpInfo (i_opcode);
     _throwif (m3Err_unknownOpcode, not opInfo);
 
+# if d_m3EnableOpFusion
+    bool fused;
+_   (FuseOperator (o, i_opcode, & fused));
+
+    if (fused)
+        goto _catch;
+# endif
+
     IM3Operation op;
 
     // This preserve is for for FP compare operations.
@@ -2104,7 +2694,7 @@ M3Result  Compile_Operator  (IM3Compilation o, m3opcode_t i_opcode)
     // and be idle & wasted for a moment.
     if (IsFpType (GetStackTopType (o)) and IsIntType (opInfo->type))
     {
-_       (PreserveRegisterIfOccupied (o, opInfo->type));
+_       (PreserveResultRegister (o, opInfo->type));
     }
 
     if (opInfo->stackOffset == 0)
@@ -2115,7 +2705,7 @@ _       (PreserveRegisterIfOccupied (o, opInfo->type));
         }
         else
         {
-_           (PreserveRegisterIfOccupied (o, opInfo->type));
+_           (PreserveResultRegister (o, opInfo->type));
             op = opInfo->operations [1]; // _r
         }
     }
@@ -2129,6 +2719,13 @@ _           (PreserveRegisterIfOccupied (o, opInfo->type));
             {                                       d_m3Assert (i_opcode == c_waOp_store_f32 or i_opcode == c_waOp_store_f64);
                 op = opInfo->operations [3]; // _rr for fp.store
             }
+#if d_m3UseSecondRegisters
+            else if (ParkRegisterForOperation (o, opInfo))
+            {
+                op = opInfo->operations [3]; // _rr; stack top - 1 parked in the second register
+                isParked = true;
+            }
+#endif
         }
         else if (IsStackTopMinus1InRegister (o))
         {
@@ -2139,7 +2736,7 @@ _           (PreserveRegisterIfOccupied (o, opInfo->type));
         }
         else
         {
-_           (PreserveRegisterIfOccupied (o, opInfo->type));     // _ss
+_           (PreserveResultRegister (o, opInfo->type));         // _ss
             op = opInfo->operations [2];
         }
     }
@@ -2151,7 +2748,12 @@ _       (EmitOp (o, op));
 _       (EmitSlotNumOfStackTopAndPop (o));
 
         if (opInfo->stackOffset < 0)
-_           (EmitSlotNumOfStackTopAndPop (o));
+        {
+            if (isParked)
+_               (Pop (o))
+            else
+_               (EmitSlotNumOfStackTopAndPop (o))
+        }
 
         if (opInfo->type != c_m3Type_none)
 _           (PushRegister (o, opInfo->type));
@@ -2206,7 +2808,12 @@ _   (ReadLEB_u32 (& memoryOffset, & o->wasm, o->wasmEnd));
     _throwif (m3Err_unknownOpcode, not opInfo);
 
     if (IsFpType (opInfo->type))
-_       (PreserveRegisterIfOccupied (o, c_m3Type_f64));
+    {
+        if (opInfo->stackOffset == 0)   // load
+_           (PreserveResultRegister (o, c_m3Type_f64))
+        else
+_           (PreserveRegisterIfOccupied (o, c_m3Type_f64))
+    }
 
 _   (Compile_Operator (o, i_opcode));
 
@@ -2224,14 +2831,16 @@ M3Result  CompileRawFunction  (IM3Module io_module,  IM3Function io_function, co
 
     if (page)
     {
-        io_function->compiled = GetPagePC (page);
+        pc_t pc = GetPagePC (page);
         io_function->module = io_module;
 
-        EmitWord (page, op_CallRawFunction);
+        EmitWord (page, GetOperationCode (op_CallRawFunction));
         EmitWord (page, i_function);
         EmitWord (page, io_function);
         EmitWord (page, i_userdata);
 
+        SetCompiledCode (io_function, pc);
+
         ReleaseCodePage (io_module->runtime, page);
         return m3Err_none;
     }
@@ -2248,9 +2857,16 @@ M3Result  CompileRawFunction  (IM3Module io_module,  IM3Function io_function, co
 
 #define d_emptyOpList                       { NULL,                     NULL,                       NULL,                       NULL }
 #define d_unaryOpList(TYPE, NAME)           { op_##TYPE##_##NAME##_r,   op_##TYPE##_##NAME##_s,     NULL,                       NULL }
-#define d_binOpList(TYPE, NAME)             { op_##TYPE##_##NAME##_rs,  op_##TYPE##_##NAME##_sr,    op_##TYPE##_##NAME##_ss,    NULL }
+#define d_storeOpList(TYPE, NAME)           { op_##TYPE##_##NAME##_rs,  op_##TYPE##_##NAME##_sr,    op_##TYPE##_##NAME##_ss,    NULL }
 #define d_storeFpOpList(TYPE, NAME)         { op_##TYPE##_##NAME##_rs,  op_##TYPE##_##NAME##_sr,    op_##TYPE##_##NAME##_ss,    op_##TYPE##_##NAME##_rr }
+#if d_m3UseSecondRegisters
+// [3]= first operand in the second register, second operand in register
+#define d_binOpList(TYPE, NAME)             { op_##TYPE##_##NAME##_rs,  op_##TYPE##_##NAME##_sr,    op_##TYPE##_##NAME##_ss,    op_##TYPE##_##NAME##_rr }
+#define d_commutativeBinOpList(TYPE, NAME)  { op_##TYPE##_##NAME##_rs,  NULL,                       op_##TYPE##_##NAME##_ss,    op_##TYPE##_##NAME##_rr }
+#else
+#define d_binOpList(TYPE, NAME)             { op_##TYPE##_##NAME##_rs,  op_##TYPE##_##NAME##_sr,    op_##TYPE##_##NAME##_ss,    NULL }
 #define d_commutativeBinOpList(TYPE, NAME)  { op_##TYPE##_##NAME##_rs,  NULL,                       op_##TYPE##_##NAME##_ss,    NULL }
+#endif
 #define d_convertOpList(OP)                 { op_##OP##_r_r,            op_##OP##_r_s,              op_##OP##_s_r,              op_##OP##_s_s }
 
 
@@ -2272,8 +2888,8 @@ const M3OpInfo c_operations [] =
     M3OP( "return",              0, any,    d_logOp (Return),                   Compile_Return ),       // 0x0f
     M3OP( "call",                0, any,    d_logOp (Call),                     Compile_Call ),         // 0x10
     M3OP( "call_indirect",       0, any,    d_logOp (CallIndirect),             Compile_CallIndirect ), // 0x11
-    M3OP( "return_call",         0, any,    d_emptyOpList,                      Compile_Call ),         // 0x12 TODO: Optimize
-    M3OP( "return_call_indirect",0, any,    d_emptyOpList,                      Compile_CallIndirect ), // 0x13
+    M3OP( "return_call",         0, any,    d_logOp (TailCall),                 Compile_Call ),         // 0x12
+    M3OP( "return_call_indirect",0, any,    d_logOp (TailCallIndirect),         Compile_CallIndirect ), // 0x13
 
     M3OP_RESERVED,  M3OP_RESERVED,                                                                      // 0x14...
     M3OP_RESERVED,  M3OP_RESERVED, M3OP_RESERVED, M3OP_RESERVED,                                        // ...0x19
@@ -2308,17 +2924,17 @@ const M3OpInfo c_operations [] =
     M3OP( "i64.load32_s",       0,  i_64,   d_unaryOpList (i64, Load_i32),      Compile_Load_Store ),   // 0x34
     M3OP( "i64.load32_u",       0,  i_64,   d_unaryOpList (i64, Load_u32),      Compile_Load_Store ),   // 0x35
 
-    M3OP( "i32.store",          -2, none,   d_binOpList (i32, Store_i32),       Compile_Load_Store ),   // 0x36
-    M3OP( "i64.store",          -2, none,   d_binOpList (i64, Store_i64),       Compile_Load_Store ),   // 0x37
+    M3OP( "i32.store",          -2, none,   d_storeOpList (i32, Store_i32),     Compile_Load_Store ),   // 0x36
+    M3OP( "i64.store",          -2, none,   d_storeOpList (i64, Store_i64),     Compile_Load_Store ),   // 0x37
     M3OP_F( "f32.store",        -2, none,   d_storeFpOpList (f32, Store_f32),   Compile_Load_Store ),   // 0x38
     M3OP_F( "f64.store",        -2, none,   d_storeFpOpList (f64, Store_f64),   Compile_Load_Store ),   // 0x39
 
-    M3OP( "i32.store8",         -2, none,   d_binOpList (i32, Store_u8),        Compile_Load_Store ),   // 0x3a
-    M3OP( "i32.store16",        -2, none,   d_binOpList (i32, Store_i16),       Compile_Load_Store ),   // 0x3b
+    M3OP( "i32.store8",         -2, none,   d_storeOpList (i32, Store_u8),      Compile_Load_Store ),   // 0x3a
+    M3OP( "i32.store16",        -2, none,   d_storeOpList (i32, Store_i16),     Compile_Load_Store ),   // 0x3b
 
-    M3OP( "i64.store8",         -2, none,   d_binOpList (i64, Store_u8),        Compile_Load_Store ),   // 0x3c
-    M3OP( "i64.store16",        -2, none,   d_binOpList (i64, Store_i16),       Compile_Load_Store ),   // 0x3d
-    M3OP( "i64.store32",        -2, none,   d_binOpList (i64, Store_i32),       Compile_Load_Store ),   // 0x3e
+    M3OP( "i64.store8",         -2, none,   d_storeOpList (i64, Store_u8),      Compile_Load_Store ),   // 0x3c
+    M3OP( "i64.store16",        -2, none,   d_storeOpList (i64, Store_i16),     Compile_Load_Store ),   // 0x3d
+    M3OP( "i64.store32",        -2, none,   d_storeOpList (i64, Store_i32),     Compile_Load_Store ),   // 0x3e
 
     M3OP( "memory.size",        1,  i_32,   d_logOp (MemSize),                  Compile_Memory_Size ),  // 0x3f
     M3OP( "memory.grow",        1,  i_32,   d_logOp (MemGrow),                  Compile_Memory_Grow ),  // 0x40
@@ -2507,9 +3123,20 @@ const M3OpInfo c_operations [] =
 
     d_m3DebugOp (MemFill),          d_m3DebugOp (MemCopy),
 
+# if d_m3EnableGasMetering
+    d_m3DebugOp (ChargeGas),
+# endif
+
     d_m3DebugTypedOp (SetGlobal),   d_m3DebugOp (SetGlobal_s32),    d_m3DebugOp (SetGlobal_s64),
 
     d_m3DebugTypedOp (SetRegister), d_m3DebugTypedOp (SetSlot),     d_m3DebugTypedOp (PreserveSetSlot),
+
+# if d_m3UseSecondRegisters
+    d_m3DebugOp (ParkRegister_r0),
+#   if d_m3HasFloat
+    d_m3DebugOp (ParkRegister_fp0),
+#   endif
+# endif
 # endif
 
 # if d_m3CascadedOpcodes
@@ -2521,6 +3148,62 @@ const M3OpInfo c_operations [] =
 # endif
 };
 
+# if defined(DEBUG) && d_m3EnableOpFusion
+// for codepage logging. the fused operations don't fit between the debug entries and
+// the extended opcode at the tail of c_operations, so they're kept separately
+const M3OpInfo c_operationsFused [] =
+{
+#   define d_m3DebugFusedCmpOp(TYPE, NAME)  M3OP (#TYPE "_" #NAME "_BranchIf", 0, none, d_fusedCmpOpList (TYPE, NAME, BranchIf)), \
+                                            M3OP (#TYPE "_" #NAME "_ContinueLoopIf", 0, none, d_fusedCmpOpList (TYPE, NAME, ContinueLoopIf))
+#   define d_m3DebugFusedEqzOp(TYPE)        M3OP (#TYPE "_EqualToZero_BranchIf", 0, none, d_fusedEqzOpList (TYPE, BranchIf)), \
+                                            M3OP (#TYPE "_EqualToZero_ContinueLoopIf", 0, none, d_fusedEqzOpList (TYPE, ContinueLoopIf))
+
+    d_m3DebugFusedEqzOp (i32),                      d_m3DebugFusedEqzOp (i64),
+    d_m3DebugFusedCmpOp (i32, Equal),               d_m3DebugFusedCmpOp (i64, Equal),
+    d_m3DebugFusedCmpOp (i32, NotEqual),            d_m3DebugFusedCmpOp (i64, NotEqual),
+    d_m3DebugFusedCmpOp (i32, LessThan),            d_m3DebugFusedCmpOp (i64, LessThan),
+    d_m3DebugFusedCmpOp (u32, LessThan),            d_m3DebugFusedCmpOp (u64, LessThan),
+    d_m3DebugFusedCmpOp (i32, GreaterThan),         d_m3DebugFusedCmpOp (i64, GreaterThan),
+    d_m3DebugFusedCmpOp (u32, GreaterThan),         d_m3DebugFusedCmpOp (u64, GreaterThan),
+    d_m3DebugFusedCmpOp (i32, LessThanOrEqual),     d_m3DebugFusedCmpOp (i64, LessThanOrEqual),
+    d_m3DebugFusedCmpOp (u32, LessThanOrEqual),     d_m3DebugFusedCmpOp (u64, LessThanOrEqual),
+    d_m3DebugFusedCmpOp (i32, GreaterThanOrEqual),  d_m3DebugFusedCmpOp (i64, GreaterThanOrEqual),
+    d_m3DebugFusedCmpOp (u32, GreaterThanOrEqual),  d_m3DebugFusedCmpOp (u64, GreaterThanOrEqual),
+
+    d_m3DebugOp (i32_AddToLocal),
+
+#   define d_m3DebugImmediateOp(TYPE, NAME)     M3OP (#TYPE "_" #NAME "_immediate", 0, none, d_immediateOpList (TYPE, NAME))
+
+    d_m3DebugImmediateOp (i32, Equal),              d_m3DebugImmediateOp (i64, Equal),
+    d_m3DebugImmediateOp (i32, NotEqual),           d_m3DebugImmediateOp (i64, NotEqual),
+    d_m3DebugImmediateOp (i32, LessThan),           d_m3DebugImmediateOp (i64, LessThan),
+    d_m3DebugImmediateOp (u32, LessThan),           d_m3DebugImmediateOp (u64, LessThan),
+    d_m3DebugImmediateOp (i32, GreaterThan),        d_m3DebugImmediateOp (i64, GreaterThan),
+    d_m3DebugImmediateOp (u32, GreaterThan),        d_m3DebugImmediateOp (u64, GreaterThan),
+    d_m3DebugImmediateOp (i32, LessThanOrEqual),    d_m3DebugImmediateOp (i64, LessThanOrEqual),
+    d_m3DebugImmediateOp (u32, LessThanOrEqual),    d_m3DebugImmediateOp (u64, LessThanOrEqual),
+    d_m3DebugImmediateOp (i32, GreaterThanOrEqual), d_m3DebugImmediateOp (i64, GreaterThanOrEqual),
+    d_m3DebugImmediateOp (u32, GreaterThanOrEqual), d_m3DebugImmediateOp (u64, GreaterThanOrEqual),
+    d_m3DebugImmediateOp (i32, Add),                d_m3DebugImmediateOp (i64, Add),
+    d_m3DebugImmediateOp (i32, Subtract),           d_m3DebugImmediateOp (i64, Subtract),
+    d_m3DebugImmediateOp (i32, Multiply),           d_m3DebugImmediateOp (i64, Multiply),
+    d_m3DebugImmediateOp (i32, Divide),             d_m3DebugImmediateOp (i64, Divide),
+    d_m3DebugImmediateOp (u32, Divide),             d_m3DebugImmediateOp (u64, Divide),
+    d_m3DebugImmediateOp (i32, Remainder),          d_m3DebugImmediateOp (i64, Remainder),
+    d_m3DebugImmediateOp (u32, Remainder),          d_m3DebugImmediateOp (u64, Remainder),
+    d_m3DebugImmediateOp (u32, And),                d_m3DebugImmediateOp (u64, And),
+    d_m3DebugImmediateOp (u32, Or),                 d_m3DebugImmediateOp (u64, Or),
+    d_m3DebugImmediateOp (u32, Xor),                d_m3DebugImmediateOp (u64, Xor),
+    d_m3DebugImmediateOp (u32, ShiftLeft),          d_m3DebugImmediateOp (u64, ShiftLeft),
+    d_m3DebugImmediateOp (i32, ShiftRight),         d_m3DebugImmediateOp (i64, ShiftRight),
+    d_m3DebugImmediateOp (u32, ShiftRight),         d_m3DebugImmediateOp (u64, ShiftRight),
+    d_m3DebugImmediateOp (u32, Rotl),               d_m3DebugImmediateOp (u64, Rotl),
+    d_m3DebugImmediateOp (u32, Rotr),               d_m3DebugImmediateOp (u64, Rotr),
+
+    M3OP( "termination", 0, c_m3Type_unknown )
+};
+# endif
+
 const M3OpInfo c_operationsFC [] =
 {
     M3OP_F( "i32.trunc_s:sat/f32",0,  i_32,   d_convertOpList (i32_TruncSat_f32),        Compile_Convert ),  // 0x00
@@ -2543,6 +3226,18 @@ const M3OpInfo c_operationsFC [] =
 # endif
 };
 
+# if d_m3EnableJit
+// generated alongside the stencils, in the same order
+const IM3Operation c_m3JitOperations [] =
+{
+#   define d_m3JitStencil(NAME)     op_##NAME,
+#   include "m3_jit_operations.h"
+#   undef d_m3JitStencil
+};
+
+const u32 c_m3NumJitOperations = M3_COUNT_OF (c_m3JitOperations);
+# endif
+
 
 IM3OpInfo  GetOpInfo  (m3opcode_t opcode)
 {
@@ -2562,11 +3257,34 @@ IM3OpInfo  GetOpInfo  (m3opcode_t opcode)
     return NULL;
 }
 
+# if d_m3EnableGasMetering
+static
+bool  IsGasRunEnd  (m3opcode_t i_opcode)
+{
+    switch (i_opcode)
+    {
+        case c_waOp_unreachable:    case c_waOp_block:          case c_waOp_loop:           case c_waOp_if:
+        case c_waOp_else:           case c_waOp_end:            case c_waOp_branch:         case c_waOp_branchIf:
+        case c_waOp_branchTable:    case c_waOp_return:         case c_waOp_returnCall:     case c_waOp_returnCallIndirect:
+            return true;
+        default:
+            return false;
+    }
+}
+# endif
+
 M3Result  CompileBlockStatements  (IM3Compilation o)
 {
     M3Result result = m3Err_none;
     bool validEnd = false;
 
+# if d_m3EnableGasMetering
+    // the instructions are charged per run that ends at control flow: a ChargeGas heads each, its cost patched in at the end.
+    // blocks nested inside compile their own runs
+    bool meterGas = o->function and o->runtime->meterGas;
+    o->gasRunCost = NULL;
+# endif
+
     while (o->wasm < o->wasmEnd)
     {
 # if d_m3EnableOpTracing
@@ -2582,6 +3300,9 @@ M3Result  CompileBlockStatements  (IM3Compilation o)
 # endif
         m3opcode_t opcode;
         o->lastOpcodeStart = o->wasm;
+# if d_m3UseSecondRegisters
+        o->opcodeCount++;
+# endif
 _       (Read_opcode (& opcode, & o->wasm, o->wasmEnd));                log_opcode (o, opcode);
 
         // Restrict opcodes when evaluating expressions
@@ -2601,6 +3322,23 @@ _       (Read_opcode (& opcode, & o->wasm, o->wasmEnd));                log_opco
         if (opinfo == NULL)
             _throw (ErrorCompile (m3Err_unknownOpcode, o, "opcode '%x' not available", opcode));
 
+# if d_m3EnableGasMetering
+        if (meterGas)
+        {
+            if (not o->gasRunCost)
+            {
+_               (EmitOp (o, op_ChargeGas));
+                o->gasRunCost = (u32 *) GetPC (o);
+                EmitConstant32 (o, 0);
+            }
+
+            ++(* o->gasRunCost);
+
+            if (IsGasRunEnd (opcode))
+                o->gasRunCost = NULL;
+        }
+# endif
+
         if (opinfo->compiler) {
 _           ((* opinfo->compiler) (o, opcode))
         } else {
@@ -2685,6 +3423,15 @@ M3Result  CompileBlock  (IM3Compilation o, IM3FuncType i_blockType, m3opcode_t i
     */
 
 _try {
+# if d_m3EnableJit && d_m3JitTierUpThreshold
+    // the loop's continues come back here, so each iteration is counted
+    if (i_blockOpcode == c_waOp_loop and o->countHotness)
+    {
+_       (EmitOp (o, op_CountLoop));
+        EmitPointer (o, o->function);
+    }
+# endif
+
     // validate and dealloc params ----------------------------
 
     u16 stackIndex = o->stackIndex;
@@ -2836,23 +3583,48 @@ M3Result  ReserveConstants  (IM3Compilation o)
 
 
 M3Result  CompileFunction  (IM3Function io_function)
+{
+    // reached through an op_Compile of the background thread, an import may still not be linked
+    if (not io_function->wasm)
+        return IsImportedFunction (io_function) ? m3Err_functionImportMissing : "function body is missing";
+
+    IM3Runtime runtime = io_function->module->runtime;
+
+# if d_m3EnableParallelCompile
+    if (runtime->background)
+        return CompileFunctionBesideBackground (runtime, io_function);
+# endif
+
+    return CompileFunctionWith (& runtime->compilation, io_function, NULL);
+}
+
+
+M3Result  CompileFunctionWith  (IM3Compilation o, IM3Function io_function, IM3CallStubs io_callStubs)
 {
     if (!io_function->wasm) return "function body is missing";
 
     IM3FuncType funcType = io_function->funcType;                   m3log (compile, "compiling: [%d] %s %s; wasm-size: %d",
                                                                         io_function->index, m3_GetFunctionName (io_function), SPrintFuncTypeSignature (funcType), (u32) (io_function->wasmEnd - io_function->wasm));
     IM3Runtime runtime = io_function->module->runtime;
-
-    IM3Compilation o = & runtime->compilation;                      d_m3Assert (d_m3MaxFunctionSlots >= d_m3MaxFunctionStackHeight * (d_m3Use32BitSlots + 1))  // need twice as many slots in 32-bit mode
+                                                                    d_m3Assert (d_m3MaxFunctionSlots >= d_m3MaxFunctionStackHeight * (d_m3Use32BitSlots + 1))  // need twice as many slots in 32-bit mode
     memset (o, 0x0, sizeof (M3Compilation));
 
     o->runtime  = runtime;
+    o->callStubs = io_callStubs;
     o->module   = io_function->module;
     o->function = io_function;
     o->wasm     = io_function->wasm;
     o->wasmEnd  = io_function->wasmEnd;
     o->block.type = funcType;
 
+# if d_m3EnableJit
+    if (runtime->jit.enabled)
+        runtime->jit.numOps = 0;
+# endif
+# if d_m3EnableJit && d_m3JitTierUpThreshold
+    o->countHotness = runtime->jit.enabled;
+# endif
+
 _try {
     // skip over code size. the end was already calculated during parse phase
     u32 size;
@@ -2860,6 +3632,9 @@ _   (ReadLEB_u32 (& size, & o->wasm, o->wasmEnd));                  d_m3Assert (
 
 _   (AcquireCompilationCodePage (o, & o->page));
 
+    // make room for Entry now, so that it can't be bridged; TailCall jumps over it
+_   (EnsureCodePageNumLines (o, d_m3CodePageFreeLinesThreshold));
+
     pc_t pc = GetPagePC (o->page);
 
     u16 numRetSlots = GetFunctionNumReturns (o->function) * c_ioSlotCount;
@@ -2899,7 +3674,16 @@ _   (ReserveConstants (o));
 
     o->block.blockStackIndex = o->stackFirstDynamicIndex = o->stackIndex;                           m3log (compile, "start stack index: %d",
                                                                                                           (u32) o->stackFirstDynamicIndex);
-_   (EmitOp (o, op_Entry));
+# if d_m3EnableJit && d_m3JitTierUpThreshold
+    if (o->countHotness)
+    {
+_       (EmitOp (o, op_CountedEntry));
+    }
+    else
+# endif
+    {
+_       (EmitOp (o, op_Entry));
+    }
     EmitPointer (o, io_function);
 
 _   (CompileBlockStatements (o));
@@ -2907,9 +3691,14 @@ _   (CompileBlockStatements (o));
     // TODO: validate opcode sequences
     _throwif(m3Err_wasmMalformed, o->previousOpcode != c_waOp_end);
 
-    io_function->compiled = pc;
     io_function->maxStackSlots = o->maxStackSlots;
 
+    if (o->slotZeroedLocalsEnd)
+    {
+        io_function->zeroedLocalsOffset = (o->slotFirstZeroedLocal - o->slotFirstLocalIndex) * sizeof (m3slot_t);
+        io_function->numZeroedLocalBytes = (o->slotZeroedLocalsEnd - o->slotFirstZeroedLocal) * sizeof (m3slot_t);
+    }
+
     u16 numConstantSlots = o->slotMaxConstIndex - o->slotFirstConstIndex;                           m3log (compile, "unique constant slots: %d; unused slots: %d",
                                                                                                            numConstantSlots, o->slotFirstDynamicIndex - o->slotMaxConstIndex);
     io_function->numConstantBytes = numConstantSlots * sizeof (m3slot_t);
@@ -2920,9 +3709,68 @@ _   (CompileBlockStatements (o));
         _throwifnull(io_function->constants);
     }
 
+# if d_m3EnableJit
+    if (runtime->jit.enabled)
+    {
+#   if d_m3JitTierUpThreshold
+        // translated once it's hot, see TierUpFunction
+        io_function->jitOps = m3_CopyMem (runtime->jit.ops, runtime->jit.numOps * sizeof (pc_t));
+        _throwifnull (io_function->jitOps);
+        io_function->numJitOps = runtime->jit.numOps;
+#   else
+        Jit_CompileFunction (& runtime->jit, io_function, runtime->jit.ops, runtime->jit.numOps);
+#   endif
+    }
+# endif
+
+    // last: another thread that sees the code, sees all of the above too
+    SetCompiledCode (io_function, pc);
+
 } _catch:
 
     ReleaseCompilationCodePage (o);
 
     return result;
 }
+
+
+# if d_m3EnableJit && d_m3JitTierUpThreshold
+void  TierUpFunction  (IM3Function io_function)
+{
+    IM3Runtime runtime = io_function->module->runtime;
+
+    for (u32 i = 0; i < io_function->numJitOps; ++i)
+    {
+        code_t * op = (code_t *) io_function->jitOps [i];
+
+        if (* op == GetOperationCode (op_CountedEntry))
+        {
+            * op = GetOperationCode (op_Entry);
+        }
+        else if (* op == GetOperationCode (op_CountLoop))
+        {
+            op [1] = (code_t) (op + 2);
+            op [0] = GetOperationCode (op_Branch);
+        }
+    }
+
+    if (runtime->jit.enabled)
+        Jit_CompileFunction (& runtime->jit, io_function, io_function->jitOps, io_function->numJitOps);
+                                                                        m3log (compile, "tier-up: %s", m3_GetFunctionName (io_function));
+    m3_Free (io_function->jitOps);
+    io_function->numJitOps = 0;
+}
+# endif
+
+
+# if d_m3EnableCodeCache
+code_t  GetAnchorOperationCode  (void)
+{
+    return GetOperationCode (op_Entry);
+}
+
+code_t  GetCallStubOperationCode  (void)
+{
+    return GetOperationCode (op_Compile);
+}
+# endif
@@ -16,6 +16,7 @@ d_m3BeginExternC
 
 enum
 {
+    c_waOp_unreachable          = 0x00,
     c_waOp_block                = 0x02,
     c_waOp_loop                 = 0x03,
     c_waOp_if                   = 0x04,
@@ -24,7 +25,10 @@ enum
     c_waOp_branch               = 0x0c,
     c_waOp_branchTable          = 0x0e,
     c_waOp_branchIf             = 0x0d,
+    c_waOp_return               = 0x0f,
     c_waOp_call                 = 0x10,
+    c_waOp_returnCall           = 0x12,
+    c_waOp_returnCallIndirect   = 0x13,
     c_waOp_getLocal             = 0x20,
     c_waOp_setLocal             = 0x21,
     c_waOp_teeLocal             = 0x22,
@@ -39,6 +43,18 @@ enum
     c_waOp_f32_const            = 0x43,
     c_waOp_f64_const            = 0x44,
 
+    c_waOp_i32_eqz              = 0x45,
+    c_waOp_i32_eq               = 0x46,
+    c_waOp_i32_ge_u             = 0x4f,
+    c_waOp_i64_eq               = 0x51,
+    c_waOp_i64_ge_u             = 0x5a,
+
+    c_waOp_i32_add              = 0x6a,
+    c_waOp_i32_sub              = 0x6b,
+    c_waOp_i32_rotr             = 0x78,
+    c_waOp_i64_add              = 0x7c,
+    c_waOp_i64_rotr             = 0x8a,
+
     c_waOp_extended             = 0xfc,
 
     c_waOp_memoryCopy           = 0xfc0a,
@@ -69,6 +85,26 @@ M3CompilationScope;
 
 typedef M3CompilationScope *        IM3CompilationScope;
 
+// the op_Compile of the calls to Wasm functions, while those are compiled on other threads. see ResolveCallStubs
+typedef struct M3CallStub
+{
+    pc_t                            pc;
+    IM3Function                     function;       // the callee; the stub itself may be patched by the time it's looked at
+}
+M3CallStub;
+
+typedef struct M3CallStubs
+{
+    M3CallStub *                    stubs;
+    u32                             numStubs;
+    u32                             maxStubs;
+
+    bool                            deferImports;   // in the background, imports may be linked meanwhile: see Compile_Call
+}
+M3CallStubs;
+
+typedef M3CallStubs *               IM3CallStubs;
+
 typedef struct
 {
     IM3Runtime          runtime;
@@ -84,6 +120,8 @@ typedef struct
 
     IM3CodePage         page;
 
+    IM3CallStubs        callStubs;                  // when set, a call to a Wasm function is always emitted as an op_Compile & listed
+
 #ifdef DEBUG
     u32                 numEmits;
     u32                 numOpcodes;
@@ -114,6 +152,30 @@ typedef struct
 
     u16                 regStackIndexPlusOne        [2];
 
+    // definite assignment of locals; only the range of locals that can be read before being written is cleared by Entry
+    bool                isLocalAssigned             [d_m3MaxFunctionStackHeight];
+    u16                 slotFirstZeroedLocal;
+    u16                 slotZeroedLocalsEnd;
+
+#if d_m3UseSecondRegisters
+    // the last register preserve of each register class. if the very next opcode is a binary
+    // operation consuming it, the SetSlot is rewritten to park the value in _r1/_fp1 instead
+    pc_t                parkPC                      [2];
+    u16                 parkStackIndex              [2];
+    u16                 parkSlot                    [2];
+    u32                 parkOpcodeCount             [2];
+
+    u32                 opcodeCount;
+#endif
+
+#if d_m3EnableGasMetering
+    u32 *               gasRunCost;                 // the cost operand of the ChargeGas heading the current run; NULL between runs
+#endif
+
+#if d_m3EnableJit && d_m3JitTierUpThreshold
+    bool                countHotness;               // the JIT waits for the function to be hot: Entry & loops are counted
+#endif
+
     m3opcode_t          previousOpcode;
 }
 M3Compilation;
@@ -147,6 +209,10 @@ typedef const M3OpInfo *    IM3OpInfo;
 
 IM3OpInfo  GetOpInfo  (m3opcode_t opcode);
 
+#if defined(DEBUG) && d_m3EnableOpFusion
+extern const M3OpInfo c_operationsFused [];
+#endif
+
 // TODO: This helper should be removed, when MultiValue is implemented
 static inline
 u8 GetSingleRetType(IM3FuncType ftype) {
@@ -199,8 +265,22 @@ M3Result    CompileBlock                (IM3Compilation io, IM3FuncType i_blockT
 M3Result    CompileBlockStatements      (IM3Compilation io);
 M3Result    CompileFunction             (IM3Function io_function);
 
+// compiles with a compilation of the caller's own; that & a list of call stubs per thread let functions be compiled in parallel
+M3Result    CompileFunctionWith         (IM3Compilation o, IM3Function io_function, IM3CallStubs io_callStubs);
+
+M3Result    AddCallStub                 (IM3CallStubs io_callStubs, pc_t i_pc, IM3Function i_function);
+
+// once all functions are compiled, turns each op_Compile listed into a direct op_Call
+void        ResolveCallStubs            (IM3CallStubs i_callStubs);
+
 M3Result    CompileRawFunction          (IM3Module io_module, IM3Function io_function, const void * i_function, const void * i_userdata);
 
+#if d_m3EnableJit && d_m3JitTierUpThreshold
+// translates the code of a function that's become hot, in place. the counting operations are rewritten, whether or not
+// the JIT manages; execution continues by dispatching the op word the caller was at once more
+void        TierUpFunction              (IM3Function io_function);
+#endif
+
 d_m3EndExternC
 
 #endif // m3_compile_h
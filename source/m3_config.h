@@ -40,6 +40,14 @@
 #   define d_m3CascadedOpcodes                  1       // Adds ~3Kb to operations table in m3_compile.c
 # endif
 
+# ifndef d_m3EnableOpFusion                             // Fuse common opcode sequences (compare + br_if, local increments)
+#   define d_m3EnableOpFusion                   1       // into single operations. Adds ~15Kb of operations
+# endif
+
+# ifndef d_m3UseSecondRegisters                         // Adds _r1 & _fp1 to the operation signature. A register preserve that's directly
+#   define d_m3UseSecondRegisters               0       // consumed by a binary operation is then parked in the second register, instead of a slot
+# endif
+
 # ifndef d_m3VerboseErrorMessages
 #   define d_m3VerboseErrorMessages             1
 # endif
@@ -143,6 +151,32 @@
 #   define d_m3NoFloatDynamic                   1       // if no floats, do not fail until flops are actually executed
 #endif
 
+# ifndef d_m3UseComputedGoto                           // build the operations as blocks of a single function, dispatched by computed goto
+#   define d_m3UseComputedGoto                  0       // (GCC/Clang labels-as-values), for compilers that won't do tail calls
+# endif
+
+#if d_m3UseComputedGoto && !defined(__GNUC__)
+#   error "d_m3UseComputedGoto requires labels-as-values (GCC or Clang)"
+#endif
+
+#if d_m3UseComputedGoto && (d_m3EnableOpProfiling || d_m3EnableOpTracing)
+#   error "d_m3UseComputedGoto doesn't support op profiling or tracing"
+#endif
+
+# ifndef d_m3TailCallLoops                             // loop continues tail-jump to the loop header instead of unwinding to the Loop operation.
+#   if (d_m3UseComputedGoto || (M3_HAS_TAIL_CALL && (defined(__OPTIMIZE__) || M3_COMPILER_HAS_ATTRIBUTE(musttail)))) && d_m3EnableStrace < 3
+#     define d_m3TailCallLoops                  1       // requires guaranteed tail calls; otherwise every iteration grows the native stack
+#   else
+#     define d_m3TailCallLoops                  0
+#   endif
+# endif
+
+# ifndef d_m3ReuseTailCallFrames                      // return_call reuses the caller's frame & jumps into the callee. otherwise, it's compiled
+#   define d_m3ReuseTailCallFrames              d_m3TailCallLoops   // as a call followed by a return. this also requires guaranteed tail calls:
+# endif                                                 // tail calls only run in constant stack in optimized, musttail or computed goto builds.
+                                                        // elsewhere (debug builds, MSVC) each return_call still takes a frame, & deep recursion
+                                                        // overflows the stack as plain calls would
+
 # ifndef d_m3SkipStackCheck
 #   define d_m3SkipStackCheck                   0       // skip stack overrun checks
 # endif
@@ -151,6 +185,124 @@
 #   define d_m3SkipMemoryBoundsCheck            0       // skip memory bounds checks
 # endif
 
+# ifndef d_m3UseGuardPages
+#   define d_m3UseGuardPages                    0       // reserve 8GiB of address space per linear memory and trap out-of-bounds
+# endif                                                 // accesses with a SIGSEGV handler, instead of bounds checks (64-bit Linux only)
+
+#if d_m3UseGuardPages && !(defined(__linux__) && M3_SIZEOF_PTR == 8)
+#   error "d_m3UseGuardPages requires a 64-bit Linux host"
+#endif
+
+# ifndef d_m3UseReservedMemory                         // reserve the address space of a linear memory's maximum up front, & commit its pages
+#   if defined(__linux__) && M3_SIZEOF_PTR == 8        // as it grows: no copies, & it stays where m3_GetMemory said
+#     define d_m3UseReservedMemory              1
+#   else
+#     define d_m3UseReservedMemory              0
+#   endif
+# endif
+
+#if d_m3UseGuardPages                                   // its reservation is simply larger
+#   undef d_m3UseReservedMemory
+#   define d_m3UseReservedMemory                1
+#endif
+
+#if d_m3UseReservedMemory && !(defined(__linux__) && M3_SIZEOF_PTR == 8)
+#   error "d_m3UseReservedMemory requires a 64-bit Linux host"
+#endif
+
+# ifndef d_m3UseHugePages                             // back linear memory & code with transparent huge pages: the memory is reserved 2MiB
+#   define d_m3UseHugePages                     0       // aligned & advised MADV_HUGEPAGE, & the code pages are carved out of 2MiB arenas
+# endif
+
+#if d_m3UseHugePages && !d_m3UseReservedMemory
+#   error "d_m3UseHugePages requires d_m3UseReservedMemory"
+#endif
+
+# ifndef d_m3EnableMemoryImages                       // the data segments of a module are written once to a memfd, that's then mapped
+#   define d_m3EnableMemoryImages               d_m3UseReservedMemory   // copy-on-write into the linear memory of each runtime
+# endif                                                 // it's loaded into. needs the memory to be mapped, see d_m3UseReservedMemory
+
+# ifndef d_m3MemoryImageMinSize                        // data segments smaller than this, in all, are simply copied
+#   define d_m3MemoryImageMinSize               (64*1024)
+# endif
+
+#if d_m3EnableMemoryImages && !d_m3UseReservedMemory
+#   error "d_m3EnableMemoryImages requires d_m3UseReservedMemory"
+#endif
+
+# ifndef d_m3EnableJit                                 // copy-and-patch baseline JIT (m3_jit.c): a runtime can have its functions stitched together
+#   define d_m3EnableJit                        0       // from the machine code of the operations. needs the generated stencils, see BUILD_JIT
+# endif
+
+# ifndef d_m3JitTierUpThreshold                        // with the JIT on, a function stays interpreted until it's been entered or has looped
+#   define d_m3JitTierUpThreshold               1000    // this many times; its code is then translated in place. 0 translates every function
+# endif                                                 // as soon as it's compiled
+
+# ifndef d_m3EnableGasMetering                         // a runtime can have the functions it compiles charge gas, a unit per Wasm instruction,
+#   define d_m3EnableGasMetering                1       // block by block against its budget (m3_EnableGasMetering). off, nothing is emitted
+# endif
+
+# ifndef d_m3EnableInterrupts                          // function entries & loop back-edges poll a flag of the runtime, so that it can be
+#   define d_m3EnableInterrupts                 1       // interrupted at any time (m3_Interrupt)
+# endif
+
+# ifndef d_m3EnableYield                              // the same places call m3_Yield too, as every call did before m3_Interrupt: for hosts
+#   define d_m3EnableYield                      0       // that override it. it costs a call at each function entry & loop back-edge
+# endif
+
+# ifndef d_m3EnableSuspend                             // calls run on a native stack of the runtime's own (ucontext), so that an interrupt
+#   define d_m3EnableSuspend                    0       // can suspend one, to be continued by m3_Resume (glibc Linux only)
+# endif
+
+# ifndef d_m3SuspendStackSize                           // the address space reserved for that native stack; pages are only committed as used
+#   define d_m3SuspendStackSize                 (8*1024*1024)
+# endif
+
+# ifndef d_m3EnableCodeCache                           // m3_CompileModuleCached keeps the compiled code of a module in a file, relocatable,
+#   if defined(__linux__) && !defined(__ANDROID__)      // for the same build of wasm3 (by its GNU build ID) to load instead of compiling again
+#     define d_m3EnableCodeCache                1
+#   else
+#     define d_m3EnableCodeCache                0
+#   endif
+# endif
+
+# ifndef d_m3EnableParallelCompile                    // m3_CompileModule can spread the functions of a module over threads of its own,
+#   if defined(__linux__) || defined(__APPLE__)         // & m3_LoadModule start one (pthreads): see m3_SetCompileThreads &
+                                                        // m3_EnableBackgroundCompile. not with d_m3FixedHeap
+#     define d_m3EnableParallelCompile          1
+#   else
+#     define d_m3EnableParallelCompile          0
+#   endif
+# endif
+
+# ifndef d_m3EnableSnapshots                          // m3_SnapshotRuntime writes the state of a runtime (memory, globals, tables) to a
+#   if defined(__linux__) || defined(__APPLE__)         // file that m3_RestoreRuntime maps into another, once its modules are loaded
+#     define d_m3EnableSnapshots                1
+#   else
+#     define d_m3EnableSnapshots                0
+#   endif
+# endif
+
+#if d_m3EnableCodeCache && !defined(__linux__)
+#   error "d_m3EnableCodeCache requires Linux"
+#endif
+
+#if d_m3EnableSuspend && !(defined(__linux__) && !defined(__ANDROID__))
+#   error "d_m3EnableSuspend requires ucontext (glibc Linux)"
+#endif
+
+#if d_m3EnableSuspend && (d_m3UseGuardPages || !d_m3EnableInterrupts)
+#   error "d_m3EnableSuspend requires d_m3EnableInterrupts & doesn't work with d_m3UseGuardPages"
+#endif
+
+#if d_m3EnableJit && !(defined(__x86_64__) && defined(__linux__) && defined(__GNUC__))
+#   error "d_m3EnableJit requires an x86-64 Linux host & GCC or Clang"
+#endif
+
+#if d_m3EnableJit && (d_m3UseComputedGoto || d_m3EnableOpProfiling || d_m3EnableOpTracing || !d_m3TailCallLoops)
+#   error "d_m3EnableJit requires the tail-call engine (without op profiling or tracing) & guaranteed tail calls"
+#endif
+
 #define d_m3EnableCodePageRefCounting           0       // not supported currently
 
 #endif // m3_config_h
@@ -82,6 +82,15 @@
 #  endif
 # endif
 
+// a u32 that another thread or a signal handler stores to, with no ordering of anything else: see m3_Interrupt
+# if defined(M3_COMPILER_MSVC)
+#  define M3_LOAD_RELAXED(P)        (* (volatile u32 *) (P))
+#  define M3_STORE_RELAXED(P, V)    (* (volatile u32 *) (P) = (V))
+# else
+#  define M3_LOAD_RELAXED(P)        __atomic_load_n ((P), __ATOMIC_RELAXED)
+#  define M3_STORE_RELAXED(P, V)    __atomic_store_n ((P), (V), __ATOMIC_RELAXED)
+# endif
+
 # if !defined(M3_HAS_TAIL_CALL)
 #  if defined(__EMSCRIPTEN__)
 #   define M3_HAS_TAIL_CALL 0
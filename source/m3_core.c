@@ -520,6 +520,11 @@ M3Result  Read_utf8  (cstr_t * o_utf8, bytes_t * io_bytes, cbytes_t i_end)
 #if d_m3RecordBacktraces
 u32  FindModuleOffset  (IM3Runtime i_runtime, pc_t i_pc)
 {
+# if d_m3EnableParallelCompile
+    // the page could be out of its list, being compiled onto
+    WaitForBackgroundCompile (i_runtime);
+# endif
+
     // walk the code pages
     IM3CodePage curr = i_runtime->pagesOpen;
     bool pageFound = false;
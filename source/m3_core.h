@@ -133,6 +133,7 @@ typedef struct M3MemoryHeader
 {
     IM3Runtime      runtime;
     void *          maxStack;
+    u64 *           globals;        // the runtime's, see M3Runtime
     size_t          length;
 }
 M3MemoryHeader;
@@ -155,7 +156,7 @@ typedef struct M3CodePageHeader
 M3CodePageHeader;
 
 
-#define d_m3CodePageFreeLinesThreshold      4+2       // max is: select _sss & CallIndirect + 2 for bridge
+#define d_m3CodePageFreeLinesThreshold      7+2       // max is: CallIndirect w/ its inline cache (on 32-bit) + 2 for bridge
 
 #define d_m3MemPageSize                     65536
 
@@ -172,6 +173,7 @@ M3CodePageHeader;
 #define d_m3MaxSaneTableSize                10000000
 #define d_m3MaxSaneUtf8Length               10000
 #define d_m3MaxSaneFunctionArgRetCount      1000    // still insane, but whatever
+#define d_m3MaxSaneSectionSize              0x40000000  // streamed in, a section is allocated as its length is read
 
 #define d_externalKind_function             0
 #define d_externalKind_table                1
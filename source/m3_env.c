@@ -5,6 +5,10 @@
 //  Copyright © 2019 Steven Massey. All rights reserved.
 //
 
+#if defined(__linux__)
+#define _GNU_SOURCE         // mmap flags & sigjmp_buf, for d_m3UseReservedMemory & d_m3UseGuardPages; memfd_create
+#endif
+
 #include <stdarg.h>
 #include <limits.h>
 
@@ -13,11 +17,56 @@
 #include "m3_exception.h"
 #include "m3_info.h"
 
+#if d_m3UseGuardPages
+#   include <setjmp.h>
+#   include <signal.h>
+#endif
+
+#if d_m3UseReservedMemory
+#   include <sys/mman.h>
+#   include <unistd.h>
+#endif
+
+#if d_m3EnableMemoryImages
+#   include <fcntl.h>
+#endif
+
+#if d_m3EnableSuspend
+#   include <sys/mman.h>
+#   include <unistd.h>
+#endif
+
+#if d_m3EnableParallelCompile
+#   include <unistd.h>
+#endif
+
+
+static inline
+void  LockCompilation  (IM3Runtime i_runtime)
+{
+#if d_m3EnableParallelCompile
+    if (i_runtime->compileLock)
+        pthread_mutex_lock (i_runtime->compileLock);
+#endif
+}
+
+static inline
+void  UnlockCompilation  (IM3Runtime i_runtime)
+{
+#if d_m3EnableParallelCompile
+    if (i_runtime->compileLock)
+        pthread_mutex_unlock (i_runtime->compileLock);
+#endif
+}
+
 
 IM3Environment  m3_NewEnvironment  ()
 {
     IM3Environment env = m3_AllocStruct (M3Environment);
 
+    // before there's any compiling, on threads of the runtimes or not
+    InitOperationCodes ();
+
     if (env)
     {
         _try
@@ -64,6 +113,9 @@ void  Environment_Release  (IM3Environment i_environment)
 
     m3log (runtime, "freeing %d pages from environment", CountCodePages (i_environment->pagesReleased));
     FreeCodePages (& i_environment->pagesReleased);
+#if d_m3UseHugePages
+    FreeCodeArenas (& i_environment->codeArenas);
+#endif
 }
 
 
@@ -194,6 +246,109 @@ IM3Runtime  m3_NewRuntime  (IM3Environment i_environment, u32 i_stackSizeInBytes
     return runtime;
 }
 
+M3Result  m3_EnableJit  (IM3Runtime io_runtime, bool i_enable)
+{
+#if d_m3EnableJit
+    io_runtime->jit.enabled = i_enable;
+    return m3Err_none;
+#else
+    return i_enable ? m3Err_jitUnavailable : m3Err_none;
+#endif
+}
+
+M3Result  m3_SetCompileThreads  (IM3Runtime io_runtime, uint32_t i_numThreads)
+{
+#if d_m3EnableParallelCompile
+    if (i_numThreads == 0)
+    {
+        long numCores = sysconf (_SC_NPROCESSORS_ONLN);
+        i_numThreads = (numCores > 0) ? (u32) numCores : 1;
+    }
+
+    io_runtime->numCompileThreads = i_numThreads;
+    return m3Err_none;
+#else
+    return (i_numThreads == 1) ? m3Err_none : m3Err_parallelCompileUnavailable;
+#endif
+}
+
+M3Result  m3_EnableGasMetering  (IM3Runtime io_runtime, bool i_enable)
+{
+#if d_m3EnableGasMetering
+    io_runtime->meterGas = i_enable;
+    return m3Err_none;
+#else
+    return i_enable ? m3Err_gasMeteringUnavailable : m3Err_none;
+#endif
+}
+
+void  m3_SetGas  (IM3Runtime io_runtime, uint64_t i_gas)
+{
+#if d_m3EnableGasMetering
+    io_runtime->gas = i_gas;
+#endif
+}
+
+uint64_t  m3_GetGas  (IM3Runtime i_runtime)
+{
+#if d_m3EnableGasMetering
+    return i_runtime->gas;
+#else
+    return 0;
+#endif
+}
+
+void  m3_AddGas  (IM3Runtime io_runtime, uint64_t i_gas)
+{
+#if d_m3EnableGasMetering
+    u64 gas = io_runtime->gas + i_gas;
+    io_runtime->gas = (gas < i_gas) ? UINT64_MAX : gas;
+#endif
+}
+
+void  m3_Interrupt  (IM3Runtime io_runtime)
+{
+#if d_m3EnableInterrupts
+    M3_STORE_RELAXED (& io_runtime->interrupted, 1);
+#endif
+}
+
+void  m3_SetInterruptHandler  (IM3Runtime io_runtime, M3InterruptHandler i_handler, void * i_userdata)
+{
+#if d_m3EnableInterrupts
+    io_runtime->interruptHandler = i_handler;
+    io_runtime->interruptUserdata = i_userdata;
+#endif
+}
+
+#if d_m3EnableInterrupts
+M3Result  Runtime_Interrupted  (IM3Runtime io_runtime)
+{
+    // cleared first: an interrupt that comes in meanwhile isn't lost
+    M3_STORE_RELAXED (& io_runtime->interrupted, 0);
+
+    M3Result result = m3Err_trapInterrupted;
+
+    if (io_runtime->interruptHandler)
+        result = io_runtime->interruptHandler (io_runtime, io_runtime->interruptUserdata);
+
+# if d_m3EnableSuspend
+    M3Fiber * fiber = & io_runtime->fiber;
+
+    if (result == m3Err_suspended and fiber->active)     // the call is already on its fiber
+    {
+        // back to the caller. m3_Resume switches here again
+        fiber->suspended = true;
+        swapcontext (& fiber->context, & fiber->caller);
+
+        result = m3Err_none;
+    }
+# endif
+
+    return result;
+}
+#endif
+
 void *  m3_GetUserData  (IM3Runtime i_runtime)
 {
     return i_runtime ? i_runtime->userdata : NULL;
@@ -227,311 +382,1357 @@ void *  _FreeModule  (IM3Module i_module, void * i_info)
 }
 
 
-void  Runtime_Release  (IM3Runtime i_runtime)
+#if d_m3UseReservedMemory
+
+static size_t                       s_hostPageSize              = 0;
+
+
+static
+size_t  GetHostPageSize  ()
 {
-    ForEachModule (i_runtime, _FreeModule, NULL);                   d_m3Assert (i_runtime->numActiveCodePages == 0);
+    if (not s_hostPageSize)
+        s_hostPageSize = (size_t) sysconf (_SC_PAGESIZE);
 
-    Environment_ReleaseCodePages (i_runtime->environment, i_runtime->pagesOpen);
-    Environment_ReleaseCodePages (i_runtime->environment, i_runtime->pagesFull);
+    return s_hostPageSize;
+}
 
-    m3_Free (i_runtime->originStack);
-    m3_Free (i_runtime->memory.mallocated);
+
+// the reservation is: [header page][linear memory ...][trailing page]. the M3MemoryHeader sits at the end of the first
+// page, so that linear memory itself is page aligned. its pages are committed as it grows, in place: it never moves
+static
+u8 *  GetMappedMemoryBase  (M3MemoryHeader * i_memory)
+{
+    return m3MemData (i_memory) - GetHostPageSize ();
 }
 
+#endif // d_m3UseReservedMemory
 
-void  m3_FreeRuntime  (IM3Runtime i_runtime)
+
+#if d_m3UseGuardPages
+
+// a wasm effective address is a u32 operand plus a u32 offset, so no access can reach past 8GiB (+ the access size)
+// from the start of linear memory. with that much address space reserved behind it, only the committed pages are
+// accessible and any out-of-bounds load/store faults into the reservation
+static const size_t         c_m3GuardedMemoryReserve        = 8ull * 1024 * 1024 * 1024;
+
+typedef struct M3GuardContext
 {
-    if (i_runtime)
+    struct M3GuardContext *     previous;       // an import can call back into another runtime
+    IM3Runtime                  runtime;
+    sigjmp_buf                  trap;
+}
+M3GuardContext;
+
+static __thread M3GuardContext *    s_guardContext              = NULL;
+
+static struct sigaction             s_previousSegvAction;
+static struct sigaction             s_previousBusAction;
+static int                          s_guardHandlerInstalled     = 0;
+
+
+static
+void  GuardPageFaultHandler  (int i_signal, siginfo_t * i_info, void * i_context)
+{
+    M3GuardContext * context = s_guardContext;
+
+    if (context and context->runtime->memory.mallocated)
     {
-        m3_PrintProfilerInfo ();
+        u8 * fault = (u8 *) i_info->si_addr;
+        u8 * base = GetMappedMemoryBase (context->runtime->memory.mallocated);
 
-        Runtime_Release (i_runtime);
-        m3_Free (i_runtime);
+        if (fault >= base and fault < base + context->runtime->memory.reserved)
+            siglongjmp (context->trap, 1);
     }
+
+    // not a linear memory access; pass the fault on
+    struct sigaction * previous = (i_signal == SIGBUS) ? & s_previousBusAction : & s_previousSegvAction;
+
+    if (previous->sa_flags & SA_SIGINFO)
+        previous->sa_sigaction (i_signal, i_info, i_context);
+    else if (previous->sa_handler == SIG_DFL or previous->sa_handler == SIG_IGN)
+        sigaction (i_signal, previous, NULL);           // the faulting instruction re-executes with the default action
+    else
+        previous->sa_handler (i_signal);
 }
 
-M3Result  EvaluateExpression  (IM3Module i_module, void * o_expressed, u8 i_type, bytes_t * io_bytes, cbytes_t i_end)
+
+static
+void  InstallGuardPageHandler  ()
 {
-    M3Result result = m3Err_none;
+    if (__atomic_exchange_n (& s_guardHandlerInstalled, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        struct sigaction action;
+        memset (& action, 0, sizeof (action));
 
-    // OPTZ: use a simplified interpreter for expressions
+        action.sa_sigaction = GuardPageFaultHandler;
+        action.sa_flags = SA_SIGINFO | SA_NODEFER;      // SA_NODEFER: the handler siglongjmp's out, leaving the signal unblocked
+        sigemptyset (& action.sa_mask);
 
-    // create a temporary runtime context
-#if defined(d_m3PreferStaticAlloc)
-    static M3Runtime runtime;
-#else
-    M3Runtime runtime;
-#endif
-    M3_INIT (runtime);
+        sigaction (SIGSEGV, & action, & s_previousSegvAction);
+        sigaction (SIGBUS, & action, & s_previousBusAction);
+    }
+}
 
-    runtime.environment = i_module->runtime->environment;
-    runtime.numStackSlots = i_module->runtime->numStackSlots;
-    runtime.stack = i_module->runtime->stack;
+#endif // d_m3UseGuardPages
 
-    m3stack_t stack = (m3stack_t)runtime.stack;
 
-    IM3Runtime savedRuntime = i_module->runtime;
-    i_module->runtime = & runtime;
+#if d_m3UseReservedMemory
 
-    IM3Compilation o = & runtime.compilation;
-    o->runtime = & runtime;
-    o->module =  i_module;
-    o->wasm =    * io_bytes;
-    o->wasmEnd = i_end;
-    o->lastOpcodeStart = o->wasm;
+# if d_m3UseHugePages
+static const size_t         c_m3HugePageSize            = 2 * 1024 * 1024;
+# endif
 
-    o->block.depth = -1;  // so that root compilation depth = 0
+static
+size_t  GetMemoryReserveSize  (M3Memory * i_memory)
+{
+# if d_m3UseGuardPages
+    size_t numBytes = c_m3GuardedMemoryReserve;
+# else
+    // as much as it may grow to; it's only address space until committed
+    size_t numBytes = (size_t) i_memory->maxPages * d_m3MemPageSize;
+# endif
 
-    //  OPTZ: this code page could be erased after use.  maybe have 'empty' list in addition to full and open?
-    o->page = AcquireCodePage (& runtime);  // AcquireUnusedCodePage (...)
+    return GetHostPageSize () + numBytes + GetHostPageSize ();
+}
 
-    if (o->page)
-    {
-        IM3FuncType ftype = runtime.environment->retFuncTypes[i_type];
 
-        pc_t m3code = GetPagePC (o->page);
-        result = CompileBlock (o, ftype, c_waOp_block);
+static
+M3Result  ResizeMappedMemory  (M3Memory * io_memory, size_t i_numPageBytes)
+{
+    M3Result result = m3Err_none;
 
-        if (not result && o->maxStackSlots >= runtime.numStackSlots) {
-            result = m3Err_trapStackOverflow;
-        }
+    size_t previousNumBytes = 0;
+    u8 * data;
 
-        if (not result)
+    if (not io_memory->mallocated)
+    {
+# if d_m3UseGuardPages
+        InstallGuardPageHandler ();
+# endif
+
+        size_t reserved = GetMemoryReserveSize (io_memory);
+
+# if d_m3UseHugePages
+        // the data starts on a huge page, so the kernel can back it with them as it's touched
+        u8 * base;
         {
-# if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
-            m3ret_t r = RunCode (m3code, stack, NULL, d_m3OpDefaultArgs, d_m3BaseCstr);
+            u8 * over = (u8 *) mmap (NULL, reserved + c_m3HugePageSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            _throwif (m3Err_mallocFailed, over == MAP_FAILED);
+
+            u8 * start = (u8 *) (((uintptr_t) over + GetHostPageSize () + c_m3HugePageSize - 1) & ~(uintptr_t) (c_m3HugePageSize - 1));
+            base = start - GetHostPageSize ();
+
+            if (base > over)
+                munmap (over, base - over);
+            if (over + c_m3HugePageSize > base)
+                munmap (base + reserved, over + c_m3HugePageSize - base);
+
+            madvise (start, reserved - 2 * GetHostPageSize (), MADV_HUGEPAGE);
+        }
 # else
-            m3ret_t r = RunCode (m3code, stack, NULL, d_m3OpDefaultArgs);
+        u8 * base = (u8 *) mmap (NULL, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        _throwif (m3Err_mallocFailed, base == MAP_FAILED);
 # endif
-            
-            if (r == 0)
-            {                                                                               m3log (runtime, "expression result: %s", SPrintValue (stack, i_type));
-                if (SizeOfType (i_type) == sizeof (u32))
-                {
-                    * (u32 *) o_expressed = * ((u32 *) stack);
-                }
-                else
-                {
-                    * (u64 *) o_expressed = * ((u64 *) stack);
-                }
-            }
+
+        if (mprotect (base, GetHostPageSize (), PROT_READ | PROT_WRITE))
+        {
+            munmap (base, reserved);
+            _throw (m3Err_mallocFailed);
         }
 
-        // TODO: EraseCodePage (...) see OPTZ above
-        ReleaseCodePage (& runtime, o->page);
+        io_memory->mallocated = (M3MemoryHeader *) (base + GetHostPageSize () - sizeof (M3MemoryHeader));
+        io_memory->reserved = reserved;
     }
-    else result = m3Err_mallocFailedCodePage;
+    else previousNumBytes = io_memory->mallocated->length;
 
-    runtime.originStack = NULL;        // prevent free(stack) in ReleaseRuntime
-    Runtime_Release (& runtime);
-    i_module->runtime = savedRuntime;
+    // a module loaded later may declare a larger maximum than the one reserved for
+    _throwif (m3Err_wasmMemoryOverflow, i_numPageBytes > io_memory->reserved - 2 * GetHostPageSize ());
 
-    * io_bytes = o->wasm;
+    data = m3MemData (io_memory->mallocated);
 
-    return result;
+    if (i_numPageBytes > previousNumBytes)
+    {
+        _throwif (m3Err_mallocFailed, mprotect (data + previousNumBytes, i_numPageBytes - previousNumBytes, PROT_READ | PROT_WRITE));
+    }
+    else if (i_numPageBytes < previousNumBytes)
+    {
+        // fresh pages, so they come back zero-filled if the memory grows again; even where a snapshot was mapped
+        mmap (data + i_numPageBytes, previousNumBytes - i_numPageBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+# if d_m3UseHugePages
+        madvise (data + i_numPageBytes, previousNumBytes - i_numPageBytes, MADV_HUGEPAGE);
+# endif
+    }
+
+    _catch: return result;
 }
 
 
-M3Result  InitMemory  (IM3Runtime io_runtime, IM3Module i_module)
+static
+void  FreeMappedMemory  (M3Memory * i_memory)
 {
-    M3Result result = m3Err_none;                                     //d_m3Assert (not io_runtime->memory.wasmPages);
+    if (i_memory->mallocated)
+        munmap (GetMappedMemoryBase (i_memory->mallocated), i_memory->reserved);
+}
 
-    if (not i_module->memoryImported)
-    {
-        u32 maxPages = i_module->memoryInfo.maxPages;
-        io_runtime->memory.maxPages = maxPages ? maxPages : 65536;
+#endif // d_m3UseReservedMemory
 
-        result = ResizeMemory (io_runtime, i_module->memoryInfo.initPages);
-    }
 
-    return result;
+#if d_m3EnableMemoryImages
+
+typedef struct M3MemoryImage
+{
+    int                     fd;             // a sealed memfd
+    size_t                  length;         // whole host pages, up to the end of the last segment
+    u32                     numSegments;
+    i32                     offsets [];     // of the segments, as they were placed; they can depend on imported globals
 }
+M3MemoryImage;
 
 
-M3Result  ResizeMemory  (IM3Runtime io_runtime, u32 i_numPages)
+void  FreeMemoryImage  (M3MemoryImage * i_image)
 {
-    M3Result result = m3Err_none;
+    if (i_image)
+    {
+        close (i_image->fd);
+        m3_Free (i_image);
+    }
+}
 
-    u32 numPagesToAlloc = i_numPages;
 
-    M3Memory * memory = & io_runtime->memory;
+static
+M3MemoryImage *  NewMemoryImage  (IM3Module i_module, const i32 * i_offsets)
+{
+    M3MemoryImage * image = NULL;
 
-#if 0 // Temporary fix for memory allocation
-    if (memory->mallocated) {
-        memory->numPages = i_numPages;
-        memory->mallocated->end = memory->wasmPages + (memory->numPages * c_m3MemPageSize);
-        return result;
+    size_t end = 0, numBytes = 0;
+    bool written = true;
+
+    for (u32 i = 0; i < i_module->numDataSegments; ++i)
+    {
+        end = M3_MAX (end, (size_t) i_offsets [i] + i_module->dataSegments [i].size);
+        numBytes += i_module->dataSegments [i].size;
     }
 
-    i_numPagesToAlloc = 256;
-#endif
+    // a small one is copied faster than it's mapped
+    if (numBytes < d_m3MemoryImageMinSize)
+        return NULL;
 
-    if (numPagesToAlloc <= memory->maxPages)
-    {
-        size_t numPageBytes = numPagesToAlloc * d_m3MemPageSize;
+    int fd = memfd_create ("wasm3 memory image", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0)
+        return NULL;
 
-#if d_m3MaxLinearMemoryPages > 0
-        _throwif("linear memory limitation exceeded", numPagesToAlloc > d_m3MaxLinearMemoryPages);
-#endif
+    size_t length = (end + GetHostPageSize () - 1) & ~(GetHostPageSize () - 1);
+    written = ftruncate (fd, (off_t) length) == 0;
 
-        // Limit the amount of memory that gets actually allocated
-        if (io_runtime->memoryLimit) {
-            numPageBytes = M3_MIN (numPageBytes, io_runtime->memoryLimit);
+    // in order, so that where segments overlap, the later one wins as it would have
+    for (u32 i = 0; written and i < i_module->numDataSegments; ++i)
+    {
+        M3DataSegment * segment = & i_module->dataSegments [i];
+
+        for (size_t done = 0; written and done < segment->size; )
+        {
+            ssize_t numWritten = pwrite (fd, segment->data + done, segment->size - done, (off_t) i_offsets [i] + (off_t) done);
+            written = numWritten > 0;
+            done += written ? (size_t) numWritten : 0;
         }
+    }
+
+    // mapped privately only from then on; nothing can change it under the runtimes
+    written = written and fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == 0;
+
+    if (written)
+        image = (M3MemoryImage *) m3_Malloc ("M3MemoryImage", sizeof (M3MemoryImage) + i_module->numDataSegments * sizeof (i32));
+
+    if (image)
+    {
+        image->fd = fd;
+        image->length = length;
+        image->numSegments = i_module->numDataSegments;
+        memcpy (image->offsets, i_offsets, i_module->numDataSegments * sizeof (i32));
+    }
+    else close (fd);
+
+    return image;
+}
+
+
+// in place of copying the segments, which takes as long as they're large, the pages of the image are mapped over those of
+// the fresh memory; each runtime gets a copy of one only as it writes to it
+static
+bool  MapMemoryImage  (M3Memory * io_memory, IM3Module i_module, const i32 * i_offsets)
+{
+    // the memory must be as InitMemory left it: the module's own, & no other module's yet to have written to it
+    IM3Runtime runtime = i_module->runtime;
+
+    if (i_module->memoryImported)
+        return false;
+
+    for (IM3Module module = runtime->modules; module; module = module->next)
+    {
+        if (module != i_module)
+            return false;
+    }
+
+    // made once, for the module of the template runtime & its instances alike
+    IM3Module owner = i_module->template ? i_module->template : i_module;
+
+    if (not owner->memoryImage)
+    {
+        owner->memoryImage = NewMemoryImage (owner, i_offsets);
+        i_module->memoryImage = owner->memoryImage;
+    }
+
+    M3MemoryImage * image = owner->memoryImage;
+
+    if (not image or memcmp (image->offsets, i_offsets, image->numSegments * sizeof (i32)))
+        return false;
+
+    if (image->length > io_memory->mallocated->length)
+        return false;
+
+    void * mapped = mmap (m3MemData (io_memory->mallocated), image->length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, image->fd, 0);
+
+    return mapped != MAP_FAILED;
+}
+
+#endif // d_m3EnableMemoryImages
+
+
+#if d_m3EnableSuspend
+
+static
+M3Result  RunFunctionCode  (IM3Runtime i_runtime, IM3Function i_function);
+
+static __thread IM3Runtime          s_fiberRuntime              = NULL;     // the one starting up on its fiber
+
+
+static
+void  FiberMain  ()
+{
+    IM3Runtime runtime = s_fiberRuntime;
+    M3Fiber * fiber = & runtime->fiber;
+
+    fiber->result = RunFunctionCode (runtime, fiber->function);
+    fiber->active = false;
+
+    // on to uc_link: the caller of the latest switch
+}
+
+
+static
+M3Result  SwitchToFiber  (IM3Runtime io_runtime)
+{
+    M3Fiber * fiber = & io_runtime->fiber;
+
+    fiber->suspended = false;
+    swapcontext (& fiber->caller, & fiber->context);
+
+    if (fiber->suspended)
+        return fiber->pendingSlots ? m3Err_pending : m3Err_suspended;
+    else
+        return fiber->result;
+}
+
+
+static
+M3Result  CallOnFiber  (IM3Runtime io_runtime, IM3Function i_function)
+{
+    M3Fiber * fiber = & io_runtime->fiber;
+
+    if (not fiber->stack)
+    {
+        void * stack = mmap (NULL, d_m3SuspendStackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (stack == MAP_FAILED)
+            return m3Err_mallocFailed;
+
+        mprotect (stack, (size_t) sysconf (_SC_PAGESIZE), PROT_NONE);      // overflowing it faults
+        fiber->stack = (u8 *) stack;
+    }
+
+    getcontext (& fiber->context);
+    fiber->context.uc_stack.ss_sp = fiber->stack;
+    fiber->context.uc_stack.ss_size = d_m3SuspendStackSize;
+    fiber->context.uc_link = & fiber->caller;
+    makecontext (& fiber->context, FiberMain, 0);
+
+    fiber->function = i_function;
+    fiber->active = true;
+    fiber->callerStack = io_runtime->stack;
+    s_fiberRuntime = io_runtime;
+
+    return SwitchToFiber (io_runtime);
+}
+
+static
+M3Result  ResumeFiber  (IM3Runtime io_runtime)
+{
+    M3Result result = SwitchToFiber (io_runtime);
+
+    if (result != m3Err_suspended and result != m3Err_pending)
+        io_runtime->lastCalled = result ? NULL : io_runtime->fiber.function;
+
+    return result;
+}
+
+
+#endif // d_m3EnableSuspend
+
+
+M3Result  Runtime_AwaitImport  (IM3Runtime io_runtime, u64 * i_slots)
+{
+#if d_m3EnableSuspend
+    M3Fiber * fiber = & io_runtime->fiber;
+
+    if (fiber->active)
+    {
+        fiber->pendingSlots = i_slots;
+        fiber->suspended = true;
+        swapcontext (& fiber->context, & fiber->caller);
+
+        fiber->pendingSlots = NULL;
+
+        return fiber->importResult;
+    }
+#endif
+    return m3Err_pendingUnsupported;
+}
+
+
+M3Result  m3_Resume  (IM3Runtime io_runtime)
+{
+#if d_m3EnableSuspend
+    M3Fiber * fiber = & io_runtime->fiber;
+
+    if (not fiber->suspended)
+        return m3Err_noSuspendedCall;
+
+    if (fiber->pendingSlots)
+        return m3Err_pending;
+
+    return ResumeFiber (io_runtime);
+#else
+    return m3Err_noSuspendedCall;
+#endif
+}
+
+
+uint64_t *  m3_GetPendingImportSlots  (IM3Runtime i_runtime)
+{
+#if d_m3EnableSuspend
+    return i_runtime->fiber.pendingSlots;
+#else
+    return NULL;
+#endif
+}
+
+
+M3Result  m3_CompleteImport  (IM3Runtime io_runtime, M3Result i_result)
+{
+#if d_m3EnableSuspend
+    M3Fiber * fiber = & io_runtime->fiber;
+
+    if (not fiber->pendingSlots)
+        return m3Err_noSuspendedCall;
+
+    fiber->importResult = i_result;
+
+    return ResumeFiber (io_runtime);
+#else
+    return m3Err_noSuspendedCall;
+#endif
+}
+
+
+void  m3_DiscardSuspended  (IM3Runtime io_runtime)
+{
+#if d_m3EnableSuspend
+    M3Fiber * fiber = & io_runtime->fiber;
+
+    if (not fiber->suspended)                               // not from an import of the running call
+        return;
+
+    // nothing on the fiber is owned by it; it's simply left to be overwritten. what the execution left
+    // behind is put back as the call found it: a suspend inside a nested call leaves runtime->stack on
+    // the frame of the import that made it
+    io_runtime->stack = fiber->callerStack;
+    io_runtime->lastCalled = NULL;
+
+    fiber->active = false;
+    fiber->suspended = false;
+    fiber->pendingSlots = NULL;
+#endif
+}
+
+
+static
+M3Result  CheckCallable  (IM3Runtime i_runtime)
+{
+#if d_m3EnableSuspend
+    if (i_runtime->fiber.suspended)
+        return m3Err_callSuspended;
+#endif
+    return m3Err_none;
+}
+
+
+static
+M3Result  RunFunctionCode  (IM3Runtime i_runtime, IM3Function i_function)
+{
+    M3Result result;
+
+# if d_m3EnableSuspend
+    // the outermost call switches to the fiber. calls from imports run on it as they are
+    if (not i_runtime->fiber.active)
+        return CallOnFiber (i_runtime, i_function);
+# endif
+
+# if d_m3UseGuardPages
+    M3GuardContext context;
+    context.previous = s_guardContext;
+    context.runtime = i_runtime;
+
+    // an out-of-bounds access faults into the reservation & GuardPageFaultHandler unwinds back here
+    if (sigsetjmp (context.trap, 0))
+    {
+        s_guardContext = context.previous;
+        return m3Err_trapOutOfBoundsMemoryAccess;
+    }
+
+    s_guardContext = & context;
+# endif
+
+# if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
+    result = (M3Result) RunCode (i_function->compiled, (m3stack_t) i_runtime->stack, i_runtime->memory.mallocated, d_m3OpDefaultArgs, d_m3BaseCstr);
+# else
+    result = (M3Result) RunCode (i_function->compiled, (m3stack_t) i_runtime->stack, i_runtime->memory.mallocated, d_m3OpDefaultArgs);
+# endif
+
+# if d_m3UseGuardPages
+    s_guardContext = context.previous;
+# endif
+
+    return result;
+}
+
+
+M3Result  Runtime_CallFunction  (IM3Runtime io_runtime, IM3Function i_function, u64 * io_stack)
+{
+    M3Result result = m3Err_none;
+
+    if (not GetCompiledCode (i_function))
+        result = CompileFunction (i_function);
+
+    if (not result)
+    {
+# if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
+        result = (M3Result) RunCode (i_function->compiled, (m3stack_t) io_stack, io_runtime->memory.mallocated, d_m3OpDefaultArgs, d_m3BaseCstr);
+# else
+        result = (M3Result) RunCode (i_function->compiled, (m3stack_t) io_stack, io_runtime->memory.mallocated, d_m3OpDefaultArgs);
+# endif
+    }
+
+    return result;
+}
+
+
+#if d_m3EnableParallelCompile
+static void  StopBackgroundCompile  (IM3Runtime io_runtime);
+#endif
+
+void  Runtime_Release  (IM3Runtime i_runtime)
+{
+#if d_m3EnableParallelCompile
+    StopBackgroundCompile (i_runtime);
+#endif
+
+    ForEachModule (i_runtime, _FreeModule, NULL);                   d_m3Assert (i_runtime->numActiveCodePages == 0);
+
+    Environment_ReleaseCodePages (i_runtime->environment, i_runtime->pagesOpen);
+    Environment_ReleaseCodePages (i_runtime->environment, i_runtime->pagesFull);
+
+    m3_Free (i_runtime->originStack);
+    m3_Free (i_runtime->globals);
+    FreeCheckpoint (i_runtime->checkpoint);
+#if d_m3RecordBacktraces
+    ClearBacktrace (i_runtime);
+#endif
+#if d_m3EnableSuspend
+    if (i_runtime->fiber.stack)
+        munmap (i_runtime->fiber.stack, d_m3SuspendStackSize);
+#endif
+#if d_m3EnableJit
+    Jit_Release (& i_runtime->jit);
+#endif
+#if d_m3UseReservedMemory
+    FreeMappedMemory (& i_runtime->memory);
+#else
+    m3_Free (i_runtime->memory.mallocated);
+#endif
+}
+
+
+void  m3_FreeRuntime  (IM3Runtime i_runtime)
+{
+    if (i_runtime)
+    {
+        m3_PrintProfilerInfo ();
+
+        Runtime_Release (i_runtime);
+        m3_Free (i_runtime);
+    }
+}
+
+M3Result  EvaluateExpression  (IM3Module i_module, void * o_expressed, u8 i_type, bytes_t * io_bytes, cbytes_t i_end)
+{
+    M3Result result = m3Err_none;
+
+    // OPTZ: use a simplified interpreter for expressions
+
+    // create a temporary runtime context
+#if defined(d_m3PreferStaticAlloc)
+    static M3Runtime runtime;
+#else
+    M3Runtime runtime;
+#endif
+    M3_INIT (runtime);
+
+    runtime.environment = i_module->runtime->environment;
+    runtime.numStackSlots = i_module->runtime->numStackSlots;
+    runtime.stack = i_module->runtime->stack;
+
+    m3stack_t stack = (m3stack_t)runtime.stack;
+
+    IM3Runtime savedRuntime = i_module->runtime;
+    i_module->runtime = & runtime;
+
+    // an expression can read imported globals
+    M3MemoryHeader header;
+    M3_INIT (header);
+    header.runtime = & runtime;
+    header.globals = savedRuntime->globals;
+
+    IM3Compilation o = & runtime.compilation;
+    o->runtime = & runtime;
+    o->module =  i_module;
+    o->wasm =    * io_bytes;
+    o->wasmEnd = i_end;
+    o->lastOpcodeStart = o->wasm;
+
+    o->block.depth = -1;  // so that root compilation depth = 0
+
+    //  OPTZ: this code page could be erased after use.  maybe have 'empty' list in addition to full and open?
+    o->page = AcquireCodePage (& runtime);  // AcquireUnusedCodePage (...)
+
+    if (o->page)
+    {
+        IM3FuncType ftype = runtime.environment->retFuncTypes[i_type];
+
+        pc_t m3code = GetPagePC (o->page);
+        result = CompileBlock (o, ftype, c_waOp_block);
+
+        if (not result && o->maxStackSlots >= runtime.numStackSlots) {
+            result = m3Err_trapStackOverflow;
+        }
+
+        if (not result)
+        {
+# if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
+            m3ret_t r = RunCode (m3code, stack, & header, d_m3OpDefaultArgs, d_m3BaseCstr);
+# else
+            m3ret_t r = RunCode (m3code, stack, & header, d_m3OpDefaultArgs);
+# endif
+            
+            if (r == 0)
+            {                                                                               m3log (runtime, "expression result: %s", SPrintValue (stack, i_type));
+                if (SizeOfType (i_type) == sizeof (u32))
+                {
+                    * (u32 *) o_expressed = * ((u32 *) stack);
+                }
+                else
+                {
+                    * (u64 *) o_expressed = * ((u64 *) stack);
+                }
+            }
+        }
+
+        // TODO: EraseCodePage (...) see OPTZ above
+        ReleaseCodePage (& runtime, o->page);
+    }
+    else result = m3Err_mallocFailedCodePage;
+
+    runtime.originStack = NULL;        // prevent free(stack) in ReleaseRuntime
+    Runtime_Release (& runtime);
+    i_module->runtime = savedRuntime;
+
+    * io_bytes = o->wasm;
+
+    return result;
+}
+
+
+M3Result  InitMemory  (IM3Runtime io_runtime, IM3Module i_module)
+{
+    M3Result result = m3Err_none;                                     //d_m3Assert (not io_runtime->memory.wasmPages);
+
+    if (not i_module->memoryImported)
+    {
+        u32 maxPages = i_module->memoryInfo.maxPages;
+        io_runtime->memory.maxPages = maxPages ? maxPages : 65536;
+
+        result = ResizeMemory (io_runtime, i_module->memoryInfo.initPages);
+    }
+
+    return result;
+}
+
+
+M3Result  ResizeMemory  (IM3Runtime io_runtime, u32 i_numPages)
+{
+    M3Result result = m3Err_none;
+
+    u32 numPagesToAlloc = i_numPages;
+
+    M3Memory * memory = & io_runtime->memory;
+
+#if 0 // Temporary fix for memory allocation
+    if (memory->mallocated) {
+        memory->numPages = i_numPages;
+        memory->mallocated->end = memory->wasmPages + (memory->numPages * c_m3MemPageSize);
+        return result;
+    }
+
+    i_numPagesToAlloc = 256;
+#endif
+
+    if (numPagesToAlloc <= memory->maxPages)
+    {
+        size_t numPageBytes = numPagesToAlloc * d_m3MemPageSize;
+
+#if d_m3MaxLinearMemoryPages > 0
+        _throwif("linear memory limitation exceeded", numPagesToAlloc > d_m3MaxLinearMemoryPages);
+#endif
+
+        // Limit the amount of memory that gets actually allocated
+        if (io_runtime->memoryLimit) {
+            numPageBytes = M3_MIN (numPageBytes, io_runtime->memoryLimit);
+        }
+
+#if d_m3UseReservedMemory
+        // only whole host pages can be committed
+        numPageBytes &= ~(GetHostPageSize () - 1);
+
+_       (ResizeMappedMemory (memory, numPageBytes));
+#else
+        size_t numBytes = numPageBytes + sizeof (M3MemoryHeader);
+
+        size_t numPreviousBytes = memory->numPages * d_m3MemPageSize;
+        if (numPreviousBytes)
+            numPreviousBytes += sizeof (M3MemoryHeader);
+
+        void* newMem = m3_Realloc ("Wasm Linear Memory", memory->mallocated, numBytes, numPreviousBytes);
+        _throwifnull(newMem);
+
+        memory->mallocated = (M3MemoryHeader*)newMem;
+#endif
+
+# if d_m3LogRuntime
+        M3MemoryHeader * oldMallocated = memory->mallocated;
+# endif
+
+        memory->numPages = numPagesToAlloc;
+
+        memory->mallocated->length =  numPageBytes;
+        memory->mallocated->runtime = io_runtime;
+        memory->mallocated->globals = io_runtime->globals;
+
+        memory->mallocated->maxStack = (m3slot_t *) io_runtime->stack + io_runtime->numStackSlots;
+
+        m3log (runtime, "resized old: %p; mem: %p; length: %zu; pages: %d", oldMallocated, memory->mallocated, memory->mallocated->length, memory->numPages);
+    }
+    else result = m3Err_wasmMemoryOverflow;
+
+    _catch: return result;
+}
+
+
+static
+u64 *  GetGlobalValue  (IM3Global i_global)
+{
+    IM3Module module = i_global->module;
+
+    return & module->runtime->globals [module->globalsIndex + (u32) (i_global - module->globals)];
+}
+
+
+M3Result  InitGlobals  (IM3Module io_module)
+{
+    M3Result result = m3Err_none;
+
+    IM3Runtime runtime = io_module->runtime;
+    io_module->globalsIndex = runtime->numGlobals;
+
+    if (io_module->numGlobals)
+    {
+        // the globals of all the modules are kept together in the runtime
+        u32 numGlobals = runtime->numGlobals + io_module->numGlobals;
+
+        runtime->globals = m3_ReallocArray (u64, runtime->globals, numGlobals, runtime->numGlobals);
+        _throwifnull (runtime->globals);
+        runtime->numGlobals = numGlobals;
+
+        if (runtime->memory.mallocated)
+            runtime->memory.mallocated->globals = runtime->globals;
+
+        for (u32 i = 0; i < io_module->numGlobals; ++i)
+        {
+            M3Global * g = & io_module->globals [i];                        m3log (runtime, "initializing global: %d", i);
+
+            if (g->initExpr)
+            {
+                bytes_t start = g->initExpr;
+
+_               (EvaluateExpression (io_module, GetGlobalValue (g), g->type, & start, g->initExpr + g->initExprSize));
+            }
+            else
+            {                                                               m3log (runtime, "importing global");
+
+            }
+        }
+    }
+
+    _catch: return result;
+}
+
+
+M3Result  InitDataSegments  (M3Memory * io_memory, IM3Module io_module)
+{
+    M3Result result = m3Err_none;
+
+    i32 * offsets = NULL;
+    u32 numPlaced = 0;
+    bool mapped = false;
+
+    _throwif ("unallocated linear memory", !(io_memory->mallocated));
+
+    offsets = m3_AllocArray (i32, io_module->numDataSegments);
+    _throwif (m3Err_mallocFailed, io_module->numDataSegments and not offsets);
+
+    // all placed before any is written, so that they can be mapped instead
+    for (; numPlaced < io_module->numDataSegments; ++numPlaced)
+    {
+        M3DataSegment * segment = & io_module->dataSegments [numPlaced];
+
+        i32 segmentOffset;
+        bytes_t start = segment->initExpr;
+_       (EvaluateExpression (io_module, & segmentOffset, c_m3Type_i32, & start, segment->initExpr + segment->initExprSize));
+
+        m3log (runtime, "loading data segment: %d; size: %d; offset: %d", numPlaced, segment->size, segmentOffset);
+
+        if (segmentOffset >= 0 && (size_t)(segmentOffset) + segment->size <= io_memory->mallocated->length)
+        {
+            offsets [numPlaced] = segmentOffset;
+        } else {
+            _throw ("data segment out of bounds");
+        }
+    }
+
+#if d_m3EnableMemoryImages
+    mapped = io_module->numDataSegments and MapMemoryImage (io_memory, io_module, offsets);
+#endif
+
+    _catch:
+
+    // when one fails, those before it are still written, as they always were
+    if (not mapped)
+    {
+        for (u32 i = 0; i < numPlaced; ++i)
+        {
+            M3DataSegment * segment = & io_module->dataSegments [i];
+
+            u8 * dest = m3MemData (io_memory->mallocated) + offsets [i];
+            memcpy (dest, segment->data, segment->size);
+        }
+    }
+
+    m3_Free (offsets);
+
+    return result;
+}
+
+
+M3Result  InitElements  (IM3Module io_module)
+{
+    M3Result result = m3Err_none;
+
+    bytes_t bytes = io_module->elementSection;
+    cbytes_t end = io_module->elementSectionEnd;
+
+    for (u32 i = 0; i < io_module->numElementSegments; ++i)
+    {
+        u32 index;
+_       (ReadLEB_u32 (& index, & bytes, end));
+
+        if (index == 0)
+        {
+            i32 offset;
+_           (EvaluateExpression (io_module, & offset, c_m3Type_i32, & bytes, end));
+            _throwif ("table underflow", offset < 0);
+
+            u32 numElements;
+_           (ReadLEB_u32 (& numElements, & bytes, end));
+
+            size_t endElement = (size_t) numElements + offset;
+            _throwif ("table overflow", endElement > d_m3MaxSaneTableSize);
+
+            // is there any requirement that elements must be in increasing sequence?
+            // make sure the table isn't shrunk.
+            if (endElement > io_module->table0Size)
+            {
+                io_module->table0 = m3_ReallocArray (IM3Function, io_module->table0, endElement, io_module->table0Size);
+                io_module->table0Size = (u32) endElement;
+            }
+            _throwifnull(io_module->table0);
+
+            for (u32 e = 0; e < numElements; ++e)
+            {
+                u32 functionIndex;
+_               (ReadLEB_u32 (& functionIndex, & bytes, end));
+                _throwif ("function index out of range", functionIndex >= io_module->numFunctions);
+                IM3Function function = & io_module->functions [functionIndex];      d_m3Assert (function); //printf ("table: %s\n", m3_GetFunctionName(function));
+                io_module->table0 [e + offset] = function;
+            }
+
+            io_module->table0Generation++;
+        }
+        else _throw ("element table index must be zero for MVP");
+    }
+
+    _catch: return result;
+}
+
+#if d_m3EnableParallelCompile
+
+typedef struct M3CompileJob
+{
+    IM3Function *           functions;      // the biggest first, so that no thread is left with a big one at the end
+    u32                     numFunctions;
+    u32                     next;           // taken atomically
+
+    IM3Function             failed;         // the first one; the others stop then
+}
+M3CompileJob;
+
+typedef struct M3CompileWorker
+{
+    M3CompileJob *          job;
+    M3Compilation           compilation;
+    M3CallStubs             callStubs;
+    pthread_t               thread;
+}
+M3CompileWorker;
+
+
+static
+int  CompareFunctionSizes  (const void * i_a, const void * i_b)
+{
+    IM3Function a = * (const IM3Function *) i_a;
+    IM3Function b = * (const IM3Function *) i_b;
+
+    size_t sizeA = a->wasmEnd - a->wasm;
+    size_t sizeB = b->wasmEnd - b->wasm;
+
+    return (sizeA < sizeB) - (sizeA > sizeB);
+}
+
+
+static
+void *  CompileFunctions  (void * io_worker)
+{
+    M3CompileWorker * worker = (M3CompileWorker *) io_worker;
+    M3CompileJob * job = worker->job;
+
+    while (not __atomic_load_n (& job->failed, __ATOMIC_RELAXED))
+    {
+        u32 i = __atomic_fetch_add (& job->next, 1, __ATOMIC_RELAXED);
+
+        if (i >= job->numFunctions)
+            break;
+
+        IM3Function function = job->functions [i];
+
+        if (CompileFunctionWith (& worker->compilation, function, & worker->callStubs))
+        {
+            IM3Function none = NULL;
+            __atomic_compare_exchange_n (& job->failed, & none, function, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+
+// the functions of the module are taken off a queue by each thread, the caller's included. a call to a function being compiled
+// elsewhere can't know its code yet, so it's emitted as an op_Compile: once all are done, those are turned into direct calls
+static
+M3Result  CompileModuleOnThreads  (IM3Module io_module, u32 i_numThreads)
+{
+    M3Result result = m3Err_none;
+
+    IM3Runtime runtime = io_module->runtime;
+
+    M3CompileJob job;
+    M3_INIT (job);
+
+    M3CompileWorker * workers = NULL;
+    u32 numWorkers = 0, numStarted = 1;
+
+    pthread_mutex_t lock;
+    pthread_mutex_t * backgroundLock;       // the background thread is idle meanwhile
+
+    job.functions = m3_AllocArray (IM3Function, io_module->numFunctions + 1);
+    _throwifnull (job.functions);
+
+    for (u32 i = 0; i < io_module->numFunctions; ++i)
+    {
+        IM3Function function = & io_module->functions [i];
+
+        if (function->wasm and not function->compiled)
+            job.functions [job.numFunctions++] = function;
+    }
+
+    numWorkers = M3_MIN (i_numThreads, job.numFunctions);
+
+    // not worth the threads
+    if (numWorkers < 2)
+        goto _catch;
+
+    qsort (job.functions, job.numFunctions, sizeof (IM3Function), CompareFunctionSizes);
+
+    workers = m3_AllocArray (M3CompileWorker, numWorkers);
+    _throwifnull (workers);
+
+    for (u32 i = 0; i < numWorkers; ++i)
+        workers [i].job = & job;
+
+    _throwif ("can't create a lock", pthread_mutex_init (& lock, NULL));
+    backgroundLock = runtime->compileLock;
+    runtime->compileLock = & lock;
+
+    // threads that can't be had, the others make up for
+    while (numStarted < numWorkers and pthread_create (& workers [numStarted].thread, NULL, CompileFunctions, & workers [numStarted]) == 0)
+        ++numStarted;
+
+    CompileFunctions (& workers [0]);
+
+    for (u32 i = 1; i < numStarted; ++i)
+        pthread_join (workers [i].thread, NULL);
+
+    runtime->compileLock = backgroundLock;
+    pthread_mutex_destroy (& lock);
+                                                                        m3log (compile, "compiled %d functions on %d threads", job.next, numStarted);
+    for (u32 i = 0; i < numWorkers; ++i)
+        ResolveCallStubs (& workers [i].callStubs);
+
+    // compiled once more on this thread, so that the error is reported as usual
+    if (job.failed)
+        result = CompileFunction (job.failed);
+
+    _catch:
+
+    if (workers)
+    {
+        for (u32 i = 0; i < numWorkers; ++i)
+            m3_Free (workers [i].callStubs.stubs);
+    }
+
+    m3_Free (workers);
+    m3_Free (job.functions);
+
+    return result;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// from m3_LoadModule on, a thread of the runtime compiles what the start function & the exports call, breadth first. its
+// code leaves each call to an op_Compile, so that it never patches code that may be running: the caller's thread does, as
+// it gets there & finds the callee compiled
+
+typedef struct M3BackgroundCompile
+{
+    pthread_mutex_t         lock;           // the runtime's compileLock too
+    pthread_cond_t          done;           // as each function is compiled & as the thread goes idle
+    pthread_t               thread;
+    bool                    started;        // & not joined yet
+    bool                    busy;
+    bool                    stop;
+
+    IM3Function *           queue;          // in the order they're reached
+    u32                     numQueued;
+    u32                     maxQueued;
+    u32                     next;
+
+    IM3Function             compiling;      // on the background thread
+    IM3Function             compilingBeside;    // on the caller's
+    M3Compilation           compilation;
+    M3CallStubs             callStubs;
+}
+M3BackgroundCompile;
+
+static __thread bool                s_inBackground              = false;
+
+
+static
+void  EnqueueFunction  (M3BackgroundCompile * io_background, IM3Function i_function)
+{
+    if (i_function->queued or not i_function->wasm)
+        return;
+
+    if (io_background->numQueued == io_background->maxQueued)
+    {
+        u32 maxQueued = io_background->maxQueued * 2 + 64;
+        IM3Function * queue = m3_ReallocArray (IM3Function, io_background->queue, maxQueued, io_background->maxQueued);
+
+        // it's only a warm-up: what isn't queued is compiled when first called
+        if (not queue)
+            return;
+
+        io_background->queue = queue;
+        io_background->maxQueued = maxQueued;
+    }
+
+    i_function->queued = true;
+    io_background->queue [io_background->numQueued++] = i_function;
+}
+
+
+static
+void *  CompileInBackground  (void * io_runtime)
+{
+    IM3Runtime runtime = (IM3Runtime) io_runtime;
+    M3BackgroundCompile * background = runtime->background;
+
+    s_inBackground = true;
+
+    pthread_mutex_lock (& background->lock);
+
+    while (not background->stop and background->next < background->numQueued)
+    {
+        IM3Function function = background->queue [background->next++];
+
+        if (function == background->compilingBeside or GetCompiledCode (function))
+            continue;
+
+        background->compiling = function;
+        background->callStubs.numStubs = 0;
+
+        pthread_mutex_unlock (& background->lock);
+
+        // one that fails is left to be compiled when called, which reports the error
+        M3Result result = CompileFunctionWith (& background->compilation, function, & background->callStubs);
+
+        pthread_mutex_lock (& background->lock);
+
+        background->compiling = NULL;
+        pthread_cond_broadcast (& background->done);
+
+        if (not result)
+        {
+            for (u32 i = 0; i < background->callStubs.numStubs; ++i)
+                EnqueueFunction (background, background->callStubs.stubs [i].function);
+        }
+    }
 
-        size_t numBytes = numPageBytes + sizeof (M3MemoryHeader);
+    background->numQueued = background->next = 0;
+    background->busy = false;
+    pthread_cond_broadcast (& background->done);
 
-        size_t numPreviousBytes = memory->numPages * d_m3MemPageSize;
-        if (numPreviousBytes)
-            numPreviousBytes += sizeof (M3MemoryHeader);
+    pthread_mutex_unlock (& background->lock);
 
-        void* newMem = m3_Realloc ("Wasm Linear Memory", memory->mallocated, numBytes, numPreviousBytes);
-        _throwifnull(newMem);
+    return NULL;
+}
 
-        memory->mallocated = (M3MemoryHeader*)newMem;
 
-# if d_m3LogRuntime
-        M3MemoryHeader * oldMallocated = memory->mallocated;
-# endif
+static
+void  StartBackgroundCompile  (IM3Runtime io_runtime, IM3Module i_module)
+{
+    M3BackgroundCompile * background = io_runtime->background;
 
-        memory->numPages = numPagesToAlloc;
+    pthread_mutex_lock (& background->lock);
 
-        memory->mallocated->length =  numPageBytes;
-        memory->mallocated->runtime = io_runtime;
+    if (i_module->startFunction >= 0)
+        EnqueueFunction (background, & i_module->functions [i_module->startFunction]);
 
-        memory->mallocated->maxStack = (m3slot_t *) io_runtime->stack + io_runtime->numStackSlots;
+    for (u32 i = 0; i < i_module->numFunctions; ++i)
+    {
+        IM3Function function = & i_module->functions [i];
 
-        m3log (runtime, "resized old: %p; mem: %p; length: %zu; pages: %d", oldMallocated, memory->mallocated, memory->mallocated->length, memory->numPages);
+        if (function->export_name)
+            EnqueueFunction (background, function);
     }
-    else result = m3Err_wasmMemoryOverflow;
 
-    _catch: return result;
+    bool start = not background->busy and background->next < background->numQueued;
+    background->busy = background->busy or start;
+
+    pthread_mutex_unlock (& background->lock);
+
+    if (start)
+    {
+        // the last one is idle: it's gone, or about to be
+        if (background->started)
+            pthread_join (background->thread, NULL);
+
+        background->started = (pthread_create (& background->thread, NULL, CompileInBackground, io_runtime) == 0);
+
+        if (not background->started)
+        {
+            pthread_mutex_lock (& background->lock);
+            background->numQueued = background->next = 0;
+            background->busy = false;
+            pthread_mutex_unlock (& background->lock);
+        }
+    }
 }
 
 
-M3Result  InitGlobals  (IM3Module io_module)
+static
+void  StopBackgroundCompile  (IM3Runtime io_runtime)
 {
-    M3Result result = m3Err_none;
+    M3BackgroundCompile * background = io_runtime->background;
 
-    if (io_module->numGlobals)
+    if (background)
     {
-        // placing the globals in their structs isn't good for cache locality, but i don't really know what the global
-        // access patterns typically look like yet.
+        pthread_mutex_lock (& background->lock);
+        background->stop = true;
+        pthread_mutex_unlock (& background->lock);
 
-        //          io_module->globalMemory = m3Alloc (m3reg_t, io_module->numGlobals);
+        if (background->started)
+            pthread_join (background->thread, NULL);
 
-        //          if (io_module->globalMemory)
-        {
-            for (u32 i = 0; i < io_module->numGlobals; ++i)
-            {
-                M3Global * g = & io_module->globals [i];                        m3log (runtime, "initializing global: %d", i);
+        io_runtime->compileLock = NULL;
+        io_runtime->background = NULL;
 
-                if (g->initExpr)
-                {
-                    bytes_t start = g->initExpr;
+        pthread_cond_destroy (& background->done);
+        pthread_mutex_destroy (& background->lock);
 
-                    result = EvaluateExpression (io_module, & g->i64Value, g->type, & start, g->initExpr + g->initExprSize);
+        m3_Free (background->queue);
+        m3_Free (background->callStubs.stubs);
+        m3_Free (background);
+    }
+}
 
-                    if (not result)
-                    {
-                        // io_module->globalMemory [i] = initValue;
-                    }
-                    else break;
-                }
-                else
-                {                                                               m3log (runtime, "importing global");
 
-                }
-            }
-        }
-        //          else result = ErrorModule (m3Err_mallocFailed, io_module, "could allocate globals for module: '%s", io_module->name);
-    }
+void  WaitForBackgroundCompile  (IM3Runtime io_runtime)
+{
+    M3BackgroundCompile * background = io_runtime->background;
 
-    return result;
+    if (background)
+    {
+        pthread_mutex_lock (& background->lock);
+
+        while (background->busy)
+            pthread_cond_wait (& background->done, & background->lock);
+
+        pthread_mutex_unlock (& background->lock);
+    }
 }
 
 
-M3Result  InitDataSegments  (M3Memory * io_memory, IM3Module io_module)
+M3Result  CompileFunctionBesideBackground  (IM3Runtime io_runtime, IM3Function io_function)
 {
     M3Result result = m3Err_none;
 
-    _throwif ("unallocated linear memory", !(io_memory->mallocated));
+    M3BackgroundCompile * background = io_runtime->background;
 
-    for (u32 i = 0; i < io_module->numDataSegments; ++i)
-    {
-        M3DataSegment * segment = & io_module->dataSegments [i];
+    pthread_mutex_lock (& background->lock);
 
-        i32 segmentOffset;
-        bytes_t start = segment->initExpr;
-_       (EvaluateExpression (io_module, & segmentOffset, c_m3Type_i32, & start, segment->initExpr + segment->initExprSize));
+    while (background->compiling == io_function)
+        pthread_cond_wait (& background->done, & background->lock);
 
-        m3log (runtime, "loading data segment: %d; size: %d; offset: %d", i, segment->size, segmentOffset);
+    bool compiled = (GetCompiledCode (io_function) != NULL);
 
-        if (segmentOffset >= 0 && (size_t)(segmentOffset) + segment->size <= io_memory->mallocated->length)
-        {
-            u8 * dest = m3MemData (io_memory->mallocated) + segmentOffset;
-            memcpy (dest, segment->data, segment->size);
-        } else {
-            _throw ("data segment out of bounds");
-        }
+    if (not compiled)
+        background->compilingBeside = io_function;
+
+    pthread_mutex_unlock (& background->lock);
+
+    if (not compiled)
+    {
+        result = CompileFunctionWith (& io_runtime->compilation, io_function, NULL);
+
+        pthread_mutex_lock (& background->lock);
+        background->compilingBeside = NULL;
+        pthread_mutex_unlock (& background->lock);
     }
 
-    _catch: return result;
+    return result;
 }
 
+#endif // d_m3EnableParallelCompile
 
-M3Result  InitElements  (IM3Module io_module)
+
+M3Result  m3_EnableBackgroundCompile  (IM3Runtime io_runtime, bool i_enable)
 {
+#if d_m3EnableParallelCompile
     M3Result result = m3Err_none;
 
-    bytes_t bytes = io_module->elementSection;
-    cbytes_t end = io_module->elementSectionEnd;
+    M3BackgroundCompile * background = NULL;
 
-    for (u32 i = 0; i < io_module->numElementSegments; ++i)
+    if (i_enable and not io_runtime->background)
     {
-        u32 index;
-_       (ReadLEB_u32 (& index, & bytes, end));
-
-        if (index == 0)
-        {
-            i32 offset;
-_           (EvaluateExpression (io_module, & offset, c_m3Type_i32, & bytes, end));
-            _throwif ("table underflow", offset < 0);
+        background = m3_AllocStruct (M3BackgroundCompile);
+        _throwifnull (background);
 
-            u32 numElements;
-_           (ReadLEB_u32 (& numElements, & bytes, end));
+        _throwif ("can't create a lock", pthread_mutex_init (& background->lock, NULL));
 
-            size_t endElement = (size_t) numElements + offset;
-            _throwif ("table overflow", endElement > d_m3MaxSaneTableSize);
+        if (pthread_cond_init (& background->done, NULL))
+        {
+            pthread_mutex_destroy (& background->lock);
+            _throw ("can't create a condition");
+        }
 
-            // is there any requirement that elements must be in increasing sequence?
-            // make sure the table isn't shrunk.
-            if (endElement > io_module->table0Size)
-            {
-                io_module->table0 = m3_ReallocArray (IM3Function, io_module->table0, endElement, io_module->table0Size);
-                io_module->table0Size = (u32) endElement;
-            }
-            _throwifnull(io_module->table0);
+        background->callStubs.deferImports = true;
 
-            for (u32 e = 0; e < numElements; ++e)
-            {
-                u32 functionIndex;
-_               (ReadLEB_u32 (& functionIndex, & bytes, end));
-                _throwif ("function index out of range", functionIndex >= io_module->numFunctions);
-                IM3Function function = & io_module->functions [functionIndex];      d_m3Assert (function); //printf ("table: %s\n", m3_GetFunctionName(function));
-                io_module->table0 [e + offset] = function;
-            }
-        }
-        else _throw ("element table index must be zero for MVP");
+        io_runtime->background = background;
+        io_runtime->compileLock = & background->lock;
+        background = NULL;
     }
+    else if (not i_enable)
+        StopBackgroundCompile (io_runtime);
 
-    _catch: return result;
+    _catch:
+    m3_Free (background);
+
+    return result;
+#else
+    return i_enable ? m3Err_parallelCompileUnavailable : m3Err_none;
+#endif
 }
 
+
 M3Result  m3_CompileModule  (IM3Module io_module)
 {
     M3Result result = m3Err_none;
 
+# if d_m3EnableParallelCompile
+    IM3Runtime runtime = io_module->runtime;
+
+    if (runtime)
+        WaitForBackgroundCompile (runtime);
+
+    bool useThreads = runtime and (runtime->numCompileThreads > 1);
+#   if d_m3EnableJit
+    useThreads = useThreads and not runtime->jit.enabled;
+#   endif
+#   if d_m3EnableCodeCache
+    useThreads = useThreads and not runtime->codeRecording;
+#   endif
+
+    if (useThreads)
+_       (CompileModuleOnThreads (io_module, runtime->numCompileThreads));
+# endif
+
+    // whatever is left: all of it, on one thread
     for (u32 i = 0; i < io_module->numFunctions; ++i)
     {
         IM3Function f = & io_module->functions [i];
@@ -558,7 +1759,7 @@ M3Result  m3_RunStart  (IM3Module io_module)
     {
         IM3Function function = & io_module->functions [io_module->startFunction];
 
-        if (not function->compiled)
+        if (not GetCompiledCode (function))
         {
 _           (CompileFunction (function));
         }
@@ -573,11 +1774,7 @@ _           (CompileFunction (function));
         startFunctionTmp = io_module->startFunction;
         io_module->startFunction = -1;
 
-# if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
-        result = (M3Result) RunCode (function->compiled, (m3stack_t) runtime->stack, runtime->memory.mallocated, d_m3OpDefaultArgs, d_m3BaseCstr);
-# else
-        result = (M3Result) RunCode (function->compiled, (m3stack_t) runtime->stack, runtime->memory.mallocated, d_m3OpDefaultArgs);
-# endif
+        result = RunFunctionCode (runtime, function);
 
         if (result)
         {
@@ -590,21 +1787,24 @@ _           (CompileFunction (function));
     _catch: return result;
 }
 
-// TODO: deal with main + side-modules loading efforcement
-M3Result  m3_LoadModule  (IM3Runtime io_runtime, IM3Module io_module)
+M3Result  BeginLoadingModule  (IM3Runtime io_runtime, IM3Module io_module)
 {
     M3Result result = m3Err_none;
 
-    if (M3_UNLIKELY(io_module->runtime)) {
-        return m3Err_moduleAlreadyLinked;
-    }
-
     io_module->runtime = io_runtime;
-    M3Memory * memory = & io_runtime->memory;
 
 _   (InitMemory (io_runtime, io_module));
 _   (InitGlobals (io_module));
-_   (InitDataSegments (memory, io_module));
+
+    _catch: return result;
+}
+
+
+M3Result  FinishLoadingModule  (IM3Runtime io_runtime, IM3Module io_module)
+{
+    M3Result result = m3Err_none;
+
+_   (InitDataSegments (& io_runtime->memory, io_module));
 _   (InitElements (io_module));
 
     // Start func might use imported functions, which are not liked here yet,
@@ -616,6 +1816,34 @@ _   (InitElements (io_module));
 
     io_module->next = io_runtime->modules;
     io_runtime->modules = io_module;
+
+#if d_m3EnableParallelCompile
+    {
+        bool background = io_runtime->background;
+#   if d_m3EnableJit
+        background = background and not io_runtime->jit.enabled;
+#   endif
+        if (background)
+            StartBackgroundCompile (io_runtime, io_module);
+    }
+#endif
+
+    _catch: return result;
+}
+
+
+// TODO: deal with main + side-modules loading efforcement
+M3Result  m3_LoadModule  (IM3Runtime io_runtime, IM3Module io_module)
+{
+    M3Result result = m3Err_none;
+
+    if (M3_UNLIKELY(io_module->runtime)) {
+        return m3Err_moduleAlreadyLinked;
+    }
+
+_   (BeginLoadingModule (io_runtime, io_module));
+_   (FinishLoadingModule (io_runtime, io_module));
+
     return result; // ok
 
 _catch:
@@ -623,6 +1851,135 @@ _catch:
     return result;
 }
 
+// from the first instance on, the code of a template is complete & left as it is: whatever wasn't compiled yet is, and
+// the functions the JIT was waiting on to get hot are translated. nothing patches it at run time after that
+static
+M3Result  ShareCompiledCode  (IM3Runtime io_template)
+{
+    M3Result result = m3Err_none;
+
+    for (IM3Module module = io_template->modules; module; module = module->next)
+    {
+        if (module->shared)
+            continue;
+
+_       (m3_CompileModule (module));
+
+        // with all of it compiled, no call needs to be left to op_Compile, which would patch it
+        ResolveCallStubs (& module->callStubs);
+
+        m3_Free (module->callStubs.stubs);
+        M3_INIT (module->callStubs);
+
+# if d_m3EnableJit && d_m3JitTierUpThreshold
+        for (u32 i = 0; i < module->numFunctions; ++i)
+        {
+            IM3Function function = & module->functions [i];
+
+            if (function->numJitOps)
+                TierUpFunction (function);
+        }
+# endif
+
+        module->shared = true;
+    }
+
+    _catch: return result;
+}
+
+
+static
+M3Result  InstantiateModule  (IM3Runtime io_runtime, IM3Module i_template)
+{
+    M3Result result = m3Err_none;
+
+    IM3Module module = m3_AllocStruct (M3Module);
+    _throwifnull (module);
+
+    * module = * i_template;
+
+    module->template = i_template;
+    module->runtime = io_runtime;
+    module->functions = NULL;
+    module->globals = NULL;
+    module->allFunctions = i_template->numFunctions;
+    module->startFunction = i_template->declaredStartFunction;
+
+    module->next = io_runtime->modules;
+    io_runtime->modules = module;
+
+    // the functions point to their module, & the globals to where their values are
+    if (module->numFunctions)
+    {
+        module->functions = m3_CopyMem (i_template->functions, module->numFunctions * sizeof (M3Function));
+        _throwifnull (module->functions);
+
+        for (u32 i = 0; i < module->numFunctions; ++i)
+            module->functions [i].module = module;
+    }
+
+    if (module->numGlobals)
+    {
+        module->globals = m3_CopyMem (i_template->globals, module->numGlobals * sizeof (M3Global));
+        _throwifnull (module->globals);
+
+        for (u32 i = 0; i < module->numGlobals; ++i)
+            module->globals [i].module = module;
+    }
+
+    // the table is the template's: nothing changes it once the elements are in
+_   (InitMemory (io_runtime, module));
+_   (InitGlobals (module));
+_   (InitDataSegments (& io_runtime->memory, module));
+
+    _catch: return result;
+}
+
+
+M3Result  m3_NewRuntimeInstance  (IM3Runtime * o_runtime, IM3Runtime io_template, u32 i_stackSizeInBytes, void * i_userdata)
+{
+    M3Result result = m3Err_none;
+
+    IM3Runtime runtime = NULL;
+    u32 numModules = 0;
+
+    _throwif ("no modules loaded", not io_template->modules);
+_   (ShareCompiledCode (io_template));
+
+    runtime = m3_NewRuntime (io_template->environment, i_stackSizeInBytes, i_userdata);
+    _throwifnull (runtime);
+
+    runtime->memoryLimit = io_template->memoryLimit;
+#if d_m3EnableGasMetering
+    runtime->meterGas = io_template->meterGas;
+#endif
+
+    // in the order they were loaded, so that each module's globals start at the same index as in the template
+    for (IM3Module module = io_template->modules; module; module = module->next)
+        ++numModules;
+
+    for (u32 n = numModules; n > 0; --n)
+    {
+        IM3Module module = io_template->modules;
+        for (u32 i = 1; i < n; ++i)
+            module = module->next;
+
+_       (InstantiateModule (runtime, module));
+    }
+
+    _catch:
+    if (result)
+    {
+        m3_FreeRuntime (runtime);
+        runtime = NULL;
+    }
+
+    * o_runtime = runtime;
+
+    return result;
+}
+
+
 IM3Global  m3_FindGlobal  (IM3Module               io_module,
                            const char * const      i_globalName)
 {
@@ -656,13 +2013,16 @@ M3Result  m3_GetGlobal  (IM3Global                 i_global,
                          IM3TaggedValue            o_value)
 {
     if (not i_global) return m3Err_globalLookupFailed;
+    if (not i_global->module->runtime) return m3Err_moduleNotLinked;
+
+    u64 * value = GetGlobalValue (i_global);
 
     switch (i_global->type) {
-    case c_m3Type_i32: o_value->value.i32 = i_global->i32Value; break;
-    case c_m3Type_i64: o_value->value.i64 = i_global->i64Value; break;
+    case c_m3Type_i32: o_value->value.i32 = * (i32 *) value; break;
+    case c_m3Type_i64: o_value->value.i64 = * (i64 *) value; break;
 # if d_m3HasFloat
-    case c_m3Type_f32: o_value->value.f32 = i_global->f32Value; break;
-    case c_m3Type_f64: o_value->value.f64 = i_global->f64Value; break;
+    case c_m3Type_f32: o_value->value.f32 = * (f32 *) value; break;
+    case c_m3Type_f64: o_value->value.f64 = * (f64 *) value; break;
 # endif
     default: return m3Err_invalidTypeId;
     }
@@ -677,13 +2037,16 @@ M3Result  m3_SetGlobal  (IM3Global                 i_global,
     if (not i_global) return m3Err_globalLookupFailed;
     if (not i_global->isMutable) return m3Err_globalNotMutable;
     if (i_global->type != i_value->type) return m3Err_globalTypeMismatch;
+    if (not i_global->module->runtime) return m3Err_moduleNotLinked;
+
+    u64 * value = GetGlobalValue (i_global);
 
     switch (i_value->type) {
-    case c_m3Type_i32: i_global->i32Value = i_value->value.i32; break;
-    case c_m3Type_i64: i_global->i64Value = i_value->value.i64; break;
+    case c_m3Type_i32: * (i32 *) value = i_value->value.i32; break;
+    case c_m3Type_i64: * (i64 *) value = i_value->value.i64; break;
 # if d_m3HasFloat
-    case c_m3Type_f32: i_global->f32Value = i_value->value.f32; break;
-    case c_m3Type_f64: i_global->f64Value = i_value->value.f64; break;
+    case c_m3Type_f32: * (f32 *) value = i_value->value.f32; break;
+    case c_m3Type_f64: * (f64 *) value = i_value->value.f64; break;
 # endif
     default: return m3Err_invalidTypeId;
     }
@@ -743,7 +2106,7 @@ M3Result  m3_FindFunction  (IM3Function * o_function, IM3Runtime i_runtime, cons
 
     if (function)
     {
-        if (not function->compiled)
+        if (not GetCompiledCode (function))
         {
 _           (CompileFunction (function))
         }
@@ -770,9 +2133,13 @@ _try {
 
     IM3Function function = i_module->table0[i_index];
 
+    // an instance shares the table of its template; its own copy of the function is the one that runs in it
+    if (function and i_module->template)
+        function = & i_module->functions [function - i_module->template->functions];
+
     if (function)
     {
-        if (not function->compiled)
+        if (not GetCompiledCode (function))
         {
 _           (CompileFunction (function))
         }
@@ -891,6 +2258,7 @@ M3Result  m3_CallVL  (IM3Function i_function, va_list i_args)
 
     m3StackCheckInit();
 
+_   (CheckCallable (runtime))
 _   (checkStartFunction(i_function->module))
 
     s = GetStackPointerForArgs (i_function);
@@ -908,11 +2276,7 @@ _   (checkStartFunction(i_function->module))
         }
     }
 
-# if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
-    result = (M3Result) RunCode (i_function->compiled, (m3stack_t)(runtime->stack), runtime->memory.mallocated, d_m3OpDefaultArgs, d_m3BaseCstr);
-# else
-    result = (M3Result) RunCode (i_function->compiled, (m3stack_t)(runtime->stack), runtime->memory.mallocated, d_m3OpDefaultArgs);
-# endif
+    result = RunFunctionCode (runtime, i_function);
     ReportNativeStackUsage ();
 
     runtime->lastCalled = result ? NULL : i_function;
@@ -940,6 +2304,7 @@ M3Result  m3_Call  (IM3Function i_function, uint32_t i_argc, const void * i_argp
 
     m3StackCheckInit();
 
+_   (CheckCallable (runtime))
 _   (checkStartFunction(i_function->module))
 
     s = GetStackPointerForArgs (i_function);
@@ -957,11 +2322,7 @@ _   (checkStartFunction(i_function->module))
         }
     }
 
-# if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
-    result = (M3Result) RunCode (i_function->compiled, (m3stack_t)(runtime->stack), runtime->memory.mallocated, d_m3OpDefaultArgs, d_m3BaseCstr);
-# else
-    result = (M3Result) RunCode (i_function->compiled, (m3stack_t)(runtime->stack), runtime->memory.mallocated, d_m3OpDefaultArgs);
-# endif
+    result = RunFunctionCode (runtime, i_function);
 
     ReportNativeStackUsage ();
 
@@ -990,6 +2351,7 @@ M3Result  m3_CallArgv  (IM3Function i_function, uint32_t i_argc, const char * i_
 
     m3StackCheckInit();
 
+_   (CheckCallable (runtime))
 _   (checkStartFunction(i_function->module))
 
     s = GetStackPointerForArgs (i_function);
@@ -1007,11 +2369,7 @@ _   (checkStartFunction(i_function->module))
         }
     }
 
-# if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
-    result = (M3Result) RunCode (i_function->compiled, (m3stack_t)(runtime->stack), runtime->memory.mallocated, d_m3OpDefaultArgs, d_m3BaseCstr);
-# else
-    result = (M3Result) RunCode (i_function->compiled, (m3stack_t)(runtime->stack), runtime->memory.mallocated, d_m3OpDefaultArgs);
-# endif
+    result = RunFunctionCode (runtime, i_function);
     
     ReportNativeStackUsage ();
 
@@ -1110,6 +2468,8 @@ void  ReleaseCodePageNoTrack (IM3Runtime i_runtime, IM3CodePage i_codePage)
 
 IM3CodePage  AcquireCodePageWithCapacity  (IM3Runtime i_runtime, u32 i_minLineCount)
 {
+    LockCompilation (i_runtime);
+
     IM3CodePage page = RemoveCodePageOfCapacity (& i_runtime->pagesOpen, i_minLineCount);
 
     if (not page)
@@ -1126,12 +2486,31 @@ IM3CodePage  AcquireCodePageWithCapacity  (IM3Runtime i_runtime, u32 i_minLineCo
     if (page)
     {                                                            m3log (emit, "acquire page: %d", page->info.sequence);
         i_runtime->numActiveCodePages++;
+
+#if d_m3EnableCodeCache
+        if (i_runtime->codeRecording)
+            CodeCache_RecordPage (i_runtime->codeRecording, page);
+#endif
     }
 
+    UnlockCompilation (i_runtime);
+
     return page;
 }
 
 
+M3Result  Module_AddCallStub  (IM3Module io_module, pc_t i_pc, IM3Function i_function)
+{
+    LockCompilation (io_module->runtime);
+
+    M3Result result = AddCallStub (& io_module->callStubs, i_pc, i_function);
+
+    UnlockCompilation (io_module->runtime);
+
+    return result;
+}
+
+
 IM3CodePage  AcquireCodePage  (IM3Runtime i_runtime)
 {
     return AcquireCodePageWithCapacity (i_runtime, d_m3CodePageFreeLinesThreshold);
@@ -1142,6 +2521,8 @@ void  ReleaseCodePage  (IM3Runtime i_runtime, IM3CodePage i_codePage)
 {
     if (i_codePage)
     {
+        LockCompilation (i_runtime);
+
         ReleaseCodePageNoTrack (i_runtime, i_codePage);
         i_runtime->numActiveCodePages--;
 
@@ -1157,6 +2538,8 @@ void  ReleaseCodePage  (IM3Runtime i_runtime, IM3CodePage i_codePage)
                 dump_code_page (i_codePage, /* startPC: */ NULL);
 #           endif
 #       endif
+
+        UnlockCompilation (i_runtime);
     }
 }
 
@@ -1165,8 +2548,16 @@ void  ReleaseCodePage  (IM3Runtime i_runtime, IM3CodePage i_codePage)
 M3Result  m3Error  (M3Result i_result, IM3Runtime i_runtime, IM3Module i_module, IM3Function i_function,
                     const char * const i_file, u32 i_lineNum, const char * const i_errorMessage, ...)
 {
+#if d_m3EnableParallelCompile
+    // what fails in the background is compiled again when called, & reported then
+    if (s_inBackground)
+        return i_result;
+#endif
+
     if (i_runtime)
     {
+        LockCompilation (i_runtime);
+
         i_runtime->error = (M3ErrorInfo){ .result = i_result, .runtime = i_runtime, .module = i_module,
                                           .function = i_function, .file = i_file, .line = i_lineNum };
         i_runtime->error.message = i_runtime->error_message;
@@ -1175,6 +2566,8 @@ M3Result  m3Error  (M3Result i_result, IM3Runtime i_runtime, IM3Module i_module,
         va_start (args, i_errorMessage);
         vsnprintf (i_runtime->error_message, sizeof(i_runtime->error_message), i_errorMessage, args);
         va_end (args);
+
+        UnlockCompilation (i_runtime);
     }
 
     return i_result;
@@ -11,6 +11,15 @@
 #include "wasm3.h"
 #include "m3_code.h"
 #include "m3_compile.h"
+#include "m3_jit.h"
+#include "m3_cache.h"
+
+#if d_m3EnableSuspend
+#   include <ucontext.h>
+#endif
+#if d_m3EnableParallelCompile
+#   include <pthread.h>
+#endif
 
 d_m3BeginExternC
 
@@ -31,6 +40,9 @@ typedef struct M3Memory
 
     u32                     numPages;
     u32                     maxPages;
+#if d_m3UseReservedMemory
+    size_t                  reserved;       // the address space mallocated is in, committed as it grows
+#endif
 }
 M3Memory;
 
@@ -56,15 +68,7 @@ typedef struct M3Global
 {
     M3ImportInfo            import;
 
-    union
-    {
-        i32 i32Value;
-        i64 i64Value;
-#if d_m3HasFloat
-        f64 f64Value;
-        f32 f32Value;
-#endif
-    };
+    struct M3Module *       module;         // its value is in the runtime of the module, see M3Runtime::globals
 
     cstr_t                  name;
     bytes_t                 initExpr;       // wasm code
@@ -77,13 +81,25 @@ M3Global;
 
 
 //---------------------------------------------------------------------------------------------------------------------------------
+
+// the bytes of a module streamed in, kept a section (or a run of function bodies) at a time; see m3_ParseModuleStreaming
+typedef struct M3ModuleBytes
+{
+    struct M3ModuleBytes *  next;
+    u32                     offset;         // in the module
+    u32                     size;
+    u8                      bytes [];
+}
+M3ModuleBytes;
+
 typedef struct M3Module
 {
     struct M3Runtime *      runtime;
     struct M3Environment *  environment;
 
-    bytes_t                 wasmStart;
+    bytes_t                 wasmStart;              // null when streamed in: the module is in pieces then
     bytes_t                 wasmEnd;
+    M3ModuleBytes *         pieces;
 
     cstr_t                  name;
 
@@ -96,6 +112,7 @@ typedef struct M3Module
     M3Function *            functions;
 
     i32                     startFunction;
+    i32                     declaredStartFunction;  // startFunction is cleared once the start function has run
 
     u32                     numDataSegments;
     M3DataSegment *         dataSegments;
@@ -103,6 +120,7 @@ typedef struct M3Module
     //u32                     importedGlobals;
     u32                     numGlobals;
     M3Global *              globals;
+    u32                     globalsIndex;           // of the first of its globals, in the runtime's
 
     u32                     numElementSegments;
     bytes_t                 elementSection;
@@ -110,6 +128,7 @@ typedef struct M3Module
 
     IM3Function *           table0;
     u32                     table0Size;
+    u32                     table0Generation;       // bumped when table0 changes; invalidates the call_indirect caches
     const char*             table0ExportName;
 
     M3MemoryInfo            memoryInfo;
@@ -117,8 +136,17 @@ typedef struct M3Module
     bool                    memoryImported;
     const char*             memoryExportName;
 
+#if d_m3EnableMemoryImages
+    struct M3MemoryImage *  memoryImage;            // what its data segments make of memory, see InitDataSegments
+#endif
+
     //bool                    hasWasmCodeCopy;
 
+    struct M3Module *       template;               // set in an instance, see m3_NewRuntimeInstance. it shares all but the
+                                                    // functions & globals arrays with this module of the template runtime
+    bool                    shared;                 // the compiled code serves instances, so it's no longer patched at run time
+    M3CallStubs             callStubs;              // the op_Compile in its code, for ShareCompiledCode to resolve
+
     struct M3Module *       next;
 }
 M3Module;
@@ -129,10 +157,22 @@ M3Result                    Module_PreallocFunctions    (IM3Module io_module, u3
 M3Result                    Module_AddFunction          (IM3Module io_module, u32 i_typeIndex, IM3ImportInfo i_importInfo /* can be null */);
 IM3Function                 Module_GetFunction          (IM3Module i_module, u32 i_functionIndex);
 
+// lists a call left to op_Compile in the module's code; it's taken under the compile lock, as threads may be compiling
+M3Result                    Module_AddCallStub          (IM3Module io_module, pc_t i_pc, IM3Function i_function);
+
 void                        Module_GenerateNames        (IM3Module i_module);
 
+// m3_LoadModule, in two: a module streamed in is begun as its code starts, so that its functions can be compiled as they
+// come in, & finished once its data segments are in too
+M3Result                    BeginLoadingModule          (IM3Runtime io_runtime, IM3Module io_module);
+M3Result                    FinishLoadingModule         (IM3Runtime io_runtime, IM3Module io_module);
+
 void                        FreeImportInfo              (M3ImportInfo * i_info);
 
+#if d_m3EnableMemoryImages
+void                        FreeMemoryImage             (struct M3MemoryImage * i_image);
+#endif
+
 //---------------------------------------------------------------------------------------------------------------------------------
 
 typedef struct M3Environment
@@ -144,6 +184,9 @@ typedef struct M3Environment
     IM3FuncType             retFuncTypes [c_m3Type_unknown];    // these 'point' to elements in the linked list above.
                                                                 // the number of elements must match the basic types as per M3ValueType
     M3CodePage *            pagesReleased;
+#if d_m3UseHugePages
+    M3CodeArena *           codeArenas;
+#endif
 
     M3SectionHandler        customSectionHandler;
 }
@@ -156,6 +199,28 @@ void                        Environment_AddFuncType     (IM3Environment i_enviro
 
 //---------------------------------------------------------------------------------------------------------------------------------
 
+#if d_m3EnableSuspend
+// the native stack that calls into a runtime run on, so that they can be set aside & continued
+typedef struct M3Fiber
+{
+    ucontext_t              context;        // of the execution, while it's suspended
+    ucontext_t              caller;         // of m3_Call or m3_Resume, while the execution runs
+
+    u8 *                    stack;
+    IM3Function             function;       // the call in progress
+    M3Result                result;
+    void *                  callerStack;    // runtime->stack when the call started; an import calling back in moves it
+
+    u64 *                   pendingSlots;   // the ret & arg slots of the import it waits on, if that's why it's suspended
+    M3Result                importResult;   // what that import completed with
+
+    bool                    active;         // a call is in progress on the fiber, running or suspended
+    bool                    suspended;
+}
+M3Fiber;
+#endif
+
+
 typedef struct M3Runtime
 {
     M3Compilation           compilation;
@@ -181,6 +246,9 @@ typedef struct M3Runtime
     M3Memory                memory;
     u32                     memoryLimit;
 
+    u64 *                   globals;        // a slot per global of each module, in the order they were loaded. the code
+    u32                     numGlobals;     // addresses them relative to this, so it can serve more than one runtime
+
 #if d_m3EnableStrace >= 2
     u32                     callDepth;
 #endif
@@ -194,7 +262,38 @@ typedef struct M3Runtime
     M3BacktraceInfo         backtrace;
 #endif
 
+#if d_m3EnableJit
+    M3Jit                   jit;
+#endif
+
+#if d_m3EnableCodeCache
+    IM3CodeRecording        codeRecording;  // while m3_CompileModuleCached compiles
+#endif
+
+#if d_m3EnableParallelCompile
+    u32                     numCompileThreads;
+    pthread_mutex_t *       compileLock;    // while m3_CompileModule runs on more than one thread: guards the code pages & error
+    struct M3BackgroundCompile * background;    // see m3_EnableBackgroundCompile
+#endif
+
+#if d_m3EnableGasMetering
+    u64                     gas;            // what's left of the budget; see m3_SetGas
+    bool                    meterGas;
+#endif
+
+#if d_m3EnableInterrupts
+    u32                     interrupted;    // set by m3_Interrupt, from anywhere: only accessed atomically
+    M3InterruptHandler      interruptHandler;
+    void *                  interruptUserdata;
+#endif
+
+#if d_m3EnableSuspend
+    M3Fiber                 fiber;
+#endif
+
 	u32						newCodePageSequence;
+
+    struct M3Checkpoint *   checkpoint;     // see m3_CheckpointRuntime
 }
 M3Runtime;
 
@@ -203,6 +302,25 @@ void                        Runtime_Release             (IM3Runtime io_runtime);
 
 M3Result                    ResizeMemory                (IM3Runtime io_runtime, u32 i_numPages);
 
+void                        FreeCheckpoint              (struct M3Checkpoint * i_checkpoint);
+
+// calls a function from native code (see m3_aot.h); its ret & arg slots are at io_stack, past the caller's own
+M3Result                    Runtime_CallFunction        (IM3Runtime io_runtime, IM3Function i_function, u64 * io_stack);
+
+// the execution noticed the interrupt flag; the handler decides whether it traps
+M3Result                    Runtime_Interrupted         (IM3Runtime io_runtime);
+
+// an import returned m3Err_pending: the execution is suspended until m3_CompleteImport, whose result this returns
+M3Result                    Runtime_AwaitImport         (IM3Runtime io_runtime, u64 * i_slots);
+
+#if d_m3EnableParallelCompile
+// compiles on the caller's thread, unless it's being compiled in the background: then waits for that
+M3Result                    CompileFunctionBesideBackground (IM3Runtime io_runtime, IM3Function io_function);
+
+// until the background thread has nothing left to compile; the code pages are all back in their lists then
+void                        WaitForBackgroundCompile    (IM3Runtime io_runtime);
+#endif
+
 typedef void *              (* ModuleVisitor)           (IM3Module i_module, void * i_info);
 void *                      ForEachModule               (IM3Runtime i_runtime, ModuleVisitor i_visitor, void * i_info);
 
@@ -5,4 +5,158 @@
 //  Copyright © 2019 Steven Massey. All rights reserved.
 //
 
-// EMPTY FOR NOW
+#include "m3_exec_defs.h"
+
+#if d_m3UseComputedGoto
+
+#include <limits.h>
+
+#include "m3_math_utils.h"
+#include "m3_compile.h"
+#include "m3_env.h"
+#include "m3_info.h"
+#include "m3_exception.h"
+
+#if d_m3EnableParallelCompile
+#   include <pthread.h>
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+// computed goto engine
+//
+// the operations of m3_exec.h are compiled a second time, as labeled blocks of ExecuteOperations. elsewhere, the op_
+// functions only serve as identities: the compiler emits GetOperationCode (op), which is the address of the label.
+// traps and returns still leave the function; Call and Entry recurse into it, just like the tail-call engine does
+//---------------------------------------------------------------------------------------------------------------------
+
+# define d_m3OperationCodeTableSize     4096        // power of 2; comfortably more than the number of operations
+
+typedef struct M3OperationCode
+{
+    IM3Operation        operation;
+    code_t              code;
+}
+M3OperationCode;
+
+static M3OperationCode  s_operationCodes    [d_m3OperationCodeTableSize];
+static bool             s_operationCodesRegistered  = false;   // read & written atomically: compile threads look at it
+
+#if d_m3EnableParallelCompile
+static pthread_once_t   s_operationCodesOnce        = PTHREAD_ONCE_INIT;
+#endif
+
+
+static inline
+u32  HashOperation  (IM3Operation i_operation)
+{
+    u64 h = (u64) (uintptr_t) i_operation;
+    h *= 0x9E3779B97F4A7C15ull;
+
+    return (u32) (h >> 32) & (d_m3OperationCodeTableSize - 1);
+}
+
+
+static
+void  RegisterOperationCode  (IM3Operation i_operation, code_t i_code)
+{
+    u32 i = HashOperation (i_operation);
+
+    while (s_operationCodes [i].operation and s_operationCodes [i].operation != i_operation)
+        i = (i + 1) & (d_m3OperationCodeTableSize - 1);
+
+    s_operationCodes [i].operation = i_operation;
+    s_operationCodes [i].code = i_code;
+}
+
+
+static
+void  RegisterOperationCodes  ()
+{
+    // a null pc has ExecuteOperations walk through its operations, registering their labels
+    ExecuteOperations (NULL, NULL, NULL, d_m3OpDefaultArgs);
+
+    __atomic_store_n (& s_operationCodesRegistered, true, __ATOMIC_RELEASE);
+}
+
+
+// m3_NewEnvironment has the table filled in, so that it's only read from then on; once, whatever the thread
+void  InitOperationCodes  ()
+{
+#if d_m3EnableParallelCompile
+    pthread_once (& s_operationCodesOnce, RegisterOperationCodes);
+#else
+    if (not __atomic_load_n (& s_operationCodesRegistered, __ATOMIC_ACQUIRE))
+        RegisterOperationCodes ();
+#endif
+}
+
+
+code_t  GetOperationCode  (IM3Operation i_operation)
+{
+    if (M3_UNLIKELY (not __atomic_load_n (& s_operationCodesRegistered, __ATOMIC_ACQUIRE)))
+        InitOperationCodes ();
+
+    u32 i = HashOperation (i_operation);
+
+    while (s_operationCodes [i].operation)
+    {
+        if (s_operationCodes [i].operation == i_operation)
+            return s_operationCodes [i].code;
+
+        i = (i + 1) & (d_m3OperationCodeTableSize - 1);
+    }
+                                                                        d_m3Assert (false);
+    return NULL;
+}
+
+
+IM3Operation  GetCodeOperation  (code_t i_code)
+{
+    for (u32 i = 0; i < d_m3OperationCodeTableSize; ++i)
+    {
+        if (s_operationCodes [i].operation and s_operationCodes [i].code == i_code)
+            return s_operationCodes [i].operation;
+    }
+
+    return NULL;
+}
+
+
+d_m3RetSig  Call  (d_m3OpSig)
+{
+    return ExecuteOperations (d_m3OpAllArgs);
+}
+
+
+# undef d_m3Op
+# define d_m3Op(NAME)                   extern m3ret_t vectorcall op_##NAME (d_m3OpSig);    \
+                                        RegisterOperationCode (op_##NAME, && label_##NAME); \
+                                        if (0) label_##NAME:
+
+# undef nextOpImpl
+# undef jumpOpImpl
+# define nextOpImpl()                   ExecuteOperations (_pc, d_m3OpArgs)
+# define jumpOpImpl(PC)                 ExecuteOperations ((pc_t) (PC), d_m3OpArgs)
+
+# undef nextOpDirect
+# undef jumpOpDirect
+# define nextOpDirect()                 goto * (* _pc++)
+# define jumpOpDirect(PC)               do { _pc = (pc_t) (PC); goto * (* _pc++); } while (0)
+
+# define M3_COMPILE_OPCODES
+# define d_m3ExecuteOperationsBody
+
+
+m3ret_t vectorcall  ExecuteOperations  (d_m3OpSig)
+{
+    if (_pc)
+        nextOpDirect ();
+
+    // registration walk: every d_m3Op registers its label & skips over its block
+
+#   include "m3_exec.h"
+
+    return m3Err_none;
+}
+
+#endif // d_m3UseComputedGoto
@@ -36,14 +36,19 @@
 
 d_m3BeginExternC
 
-# define rewrite_op(OP)             * ((void **) (_pc-1)) = (void*)(OP)
+# define rewrite_op(OP)             * ((void **) (_pc-1)) = (void*) GetOperationCode (OP)
 
 # define immediate(TYPE)            * ((TYPE *) _pc++)
+# define immediate_lines(TYPE)      ((sizeof (TYPE) + sizeof (code_t) - 1) / sizeof (code_t))
+# define wide_immediate(TYPE)       * ((TYPE *) ((_pc += immediate_lines (TYPE)) - immediate_lines (TYPE)))
 # define skip_immediate(TYPE)       (_pc++)
 
 # define slot(TYPE)                 * (TYPE *) (_sp + immediate (i32))
 # define slot_ptr(TYPE)             (TYPE *) (_sp + immediate (i32))
 
+// the globals are in the runtime; the immediate is the byte offset of the slot, see EmitGlobalOffset
+# define d_m3Global(TYPE)           (TYPE *) ((u8 *) _mem->globals + immediate (uintptr_t))
+
 
 # if d_m3EnableOpProfiling
                                     d_m3RetSig  profileOp   (d_m3OpSig, cstr_t i_operationName);
@@ -57,6 +62,20 @@ d_m3BeginExternC
 
 #define jumpOp(PC)                  jumpOpDirect(PC)
 
+# if defined(d_m3JitStencils)
+// m3_jit_stencils.c compiles the operations once more, as the JIT's stencils. nextOp () becomes a hole that's patched to
+// the native code of the following operation; jumps, calls & the re-dispatch of a rewritten operation still go through the
+// metacode, whose op words the JIT points at native code. operations that rewrite themselves are left to the interpreter
+                                    extern m3ret_t vectorcall   _jit_continue   (d_m3OpSig);
+                                    extern void                 _jit_no_stencil (void);
+#   undef  d_m3Op
+#   define d_m3Op(NAME)             M3_NO_UBSAN m3ret_t vectorcall op_##NAME (d_m3OpSig)
+#   undef  nextOp
+#   define nextOp()                 M3_MUSTTAIL return _jit_continue (_pc + 1, d_m3OpArgs)
+#   undef  rewrite_op
+#   define rewrite_op(OP)           _jit_no_stencil ()
+# endif
+
 #if d_m3RecordBacktraces
     #define pushBacktraceFrame()            (PushBacktraceFrame (_mem->runtime, _pc - 1))
     #define fillBacktraceFrame(FUNCTION)    (FillBacktraceFunctionInfo (_mem->runtime, function))
@@ -72,6 +91,37 @@ d_m3BeginExternC
 #endif
 
 
+#if d_m3EnableYield
+    // for hosts that override m3_Yield: it used to be called on every call
+    #define m3YieldCheck()                                                      \
+    {                                                                           \
+        m3ret_t yield_r = m3_Yield ();                                          \
+        if (M3_UNLIKELY (yield_r))                                              \
+            newTrap (yield_r);                                                  \
+    }
+#else
+    #define m3YieldCheck()
+#endif
+
+#if d_m3EnableInterrupts
+    // polled at function entries & loop back-edges. the handler could have grown the memory
+    #define m3InterruptCheck()                                                  \
+    {                                                                           \
+        m3YieldCheck ();                                                        \
+        IM3Runtime irq_rt = m3MemRuntime (_mem);                                \
+        if (M3_UNLIKELY (M3_LOAD_RELAXED (& irq_rt->interrupted)))              \
+        {                                                                       \
+            m3ret_t irq_r = Runtime_Interrupted (irq_rt);                       \
+            if (irq_r)                                                          \
+                newTrap (irq_r);                                                \
+            _mem = irq_rt->memory.mallocated;                                   \
+        }                                                                       \
+    }
+#else
+    #define m3InterruptCheck()              m3YieldCheck ()
+#endif
+
+
 #if d_m3EnableStrace == 1
     // Flat trace
     #define d_m3TracePrepare
@@ -108,18 +158,55 @@ d_m3BeginExternC
 
 #endif
 
+// the computed goto engine includes this file inside its function body; it has its own Call (see m3_exec.c)
+#if !defined(d_m3ExecuteOperationsBody)
+
 # if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
 d_m3RetSig  Call  (d_m3OpSig, cstr_t i_operationName)
 # else
 d_m3RetSig  Call  (d_m3OpSig)
 # endif
 {
-    m3ret_t possible_trap = m3_Yield ();
-    if (M3_UNLIKELY(possible_trap)) return possible_trap;
-
     nextOpDirect();
 }
 
+#endif
+
+#if d_m3UseSecondRegisters
+
+// a preserved register is parked in the second register of its class, when it's
+// directly consumed by a binary operation. the slot immediate is left unused
+d_m3Op  (ParkRegister_r0)
+{
+    _pc++;
+    _r1 = _r0;
+    nextOp ();
+}
+
+#   if d_m3HasFloat
+d_m3Op  (ParkRegister_fp0)
+{
+    _pc++;
+    _fp1 = _fp0;
+    nextOp ();
+}
+#   endif
+
+#   define d_m3SecondReg__r0                _r1
+#   define d_m3SecondReg__fp0               _fp1
+#   define d_m3SecondReg(REG)               d_m3SecondReg_##REG
+
+// first operand in the second register, second operand in REG
+#   define d_m3SecondRegOpMacro(RES, REG, TYPE, NAME, OP, ...)      \
+d_m3Op(TYPE##_##NAME##_rr)                                          \
+{                                                                   \
+    OP((RES), ((TYPE) d_m3SecondReg (REG)), ((TYPE) REG), ##__VA_ARGS__); \
+    nextOp ();                                                      \
+}
+#else
+#   define d_m3SecondRegOpMacro(RES, REG, TYPE, NAME, OP, ...)
+#endif
+
 // TODO: OK, this needs some explanation here ;0
 
 #define d_m3CommutativeOpMacro(RES, REG, TYPE, NAME, OP, ...) \
@@ -135,7 +222,8 @@ d_m3Op(TYPE##_##NAME##_ss)                              \
     TYPE operand1 = slot (TYPE);                        \
     OP((RES), operand1, operand2, ##__VA_ARGS__);       \
     nextOp ();                                          \
-}
+}                                                       \
+d_m3SecondRegOpMacro(RES, REG, TYPE, NAME, OP, ##__VA_ARGS__)
 
 #define d_m3OpMacro(RES, REG, TYPE, NAME, OP, ...)      \
 d_m3Op(TYPE##_##NAME##_sr)                              \
@@ -146,9 +234,32 @@ d_m3Op(TYPE##_##NAME##_sr)                              \
 }                                                       \
 d_m3CommutativeOpMacro(RES, REG, TYPE,NAME, OP, ##__VA_ARGS__)
 
+#if d_m3EnableOpFusion
+// second operand is a constant immediate (64-bit constants take two lines on 32-bit targets). the compiler folds
+// 'T.const c; op' into these, so c never occupies a slot of the constant table that op_Entry copies into the frame
+#   define d_m3ImmediateOpMacro(RES, REG, TYPE, NAME, OP, ...)      \
+d_m3Op(TYPE##_##NAME##_ri)                                          \
+{                                                                   \
+    TYPE operand = wide_immediate (TYPE);                           \
+    OP((RES), ((TYPE) REG), operand, ##__VA_ARGS__);                \
+    nextOp ();                                                      \
+}                                                                   \
+d_m3Op(TYPE##_##NAME##_si)                                          \
+{                                                                   \
+    TYPE operand1 = slot (TYPE);                                    \
+    TYPE operand2 = wide_immediate (TYPE);                          \
+    OP((RES), operand1, operand2, ##__VA_ARGS__);                   \
+    nextOp ();                                                      \
+}
+#else
+#   define d_m3ImmediateOpMacro(RES, REG, TYPE, NAME, OP, ...)
+#endif
+
 // Accept macros
-#define d_m3CommutativeOpMacro_i(TYPE, NAME, MACRO, ...)    d_m3CommutativeOpMacro  ( _r0,  _r0, TYPE, NAME, MACRO, ##__VA_ARGS__)
-#define d_m3OpMacro_i(TYPE, NAME, MACRO, ...)               d_m3OpMacro             ( _r0,  _r0, TYPE, NAME, MACRO, ##__VA_ARGS__)
+#define d_m3CommutativeOpMacro_i(TYPE, NAME, MACRO, ...)    d_m3CommutativeOpMacro  ( _r0,  _r0, TYPE, NAME, MACRO, ##__VA_ARGS__) \
+                                                            d_m3ImmediateOpMacro    ( _r0,  _r0, TYPE, NAME, MACRO, ##__VA_ARGS__)
+#define d_m3OpMacro_i(TYPE, NAME, MACRO, ...)               d_m3OpMacro             ( _r0,  _r0, TYPE, NAME, MACRO, ##__VA_ARGS__) \
+                                                            d_m3ImmediateOpMacro    ( _r0,  _r0, TYPE, NAME, MACRO, ##__VA_ARGS__)
 #define d_m3CommutativeOpMacro_f(TYPE, NAME, MACRO, ...)    d_m3CommutativeOpMacro  (_fp0, _fp0, TYPE, NAME, MACRO, ##__VA_ARGS__)
 #define d_m3OpMacro_f(TYPE, NAME, MACRO, ...)               d_m3OpMacro             (_fp0, _fp0, TYPE, NAME, MACRO, ##__VA_ARGS__)
 
@@ -505,7 +616,7 @@ d_m3ReinterpretOp (_fp0, f64, _r0, i64)
 
 d_m3Op  (GetGlobal_s32)
 {
-    u32 * global = immediate (u32 *);
+    u32 * global = d_m3Global (u32);
     slot (u32) = * global;                        //  printf ("get global: %p %" PRIi64 "\n", global, *global);
 
     nextOp ();
@@ -514,7 +625,7 @@ d_m3Op  (GetGlobal_s32)
 
 d_m3Op  (GetGlobal_s64)
 {
-    u64 * global = immediate (u64 *);
+    u64 * global = d_m3Global (u64);
     slot (u64) = * global;                        // printf ("get global: %p %" PRIi64 "\n", global, *global);
 
     nextOp ();
@@ -523,7 +634,7 @@ d_m3Op  (GetGlobal_s64)
 
 d_m3Op  (SetGlobal_i32)
 {
-    u32 * global = immediate (u32 *);
+    u32 * global = d_m3Global (u32);
     * global = (u32) _r0;                         //  printf ("set global: %p %" PRIi64 "\n", global, _r0);
 
     nextOp ();
@@ -532,7 +643,7 @@ d_m3Op  (SetGlobal_i32)
 
 d_m3Op  (SetGlobal_i64)
 {
-    u64 * global = immediate (u64 *);
+    u64 * global = d_m3Global (u64);
     * global = (u64) _r0;                         //  printf ("set global: %p %" PRIi64 "\n", global, _r0);
 
     nextOp ();
@@ -565,48 +676,176 @@ d_m3Op  (Call)
 }
 
 
+// each call_indirect site caches its last resolved callee. the cache key combines the table index with the module's
+// table0Generation, so the fast path is a single compare, and any change to table0 invalidates every site at once.
+// the table, type & compile checks only run on a miss; a callee that passed them stays valid for the same key.
+// code shared by runtime instances leaves the cache as it is, & takes the slow path instead.
 d_m3Op  (CallIndirect)
 {
     u32 tableIndex              = slot (u32);
     IM3Module module            = immediate (IM3Module);
     IM3FuncType type            = immediate (IM3FuncType);
     i32 stackOffset             = immediate (i32);
+    u64 * cachedKey             = (u64 *) _pc;      _pc += (M3_SIZEOF_PTR == 4) ? 2 : 1;
+    pc_t * cachedCallee         = & immediate (pc_t);
     IM3Memory memory            = m3MemInfo (_mem);
 
     m3stack_t sp = _sp + stackOffset;
 
     m3ret_t r = m3Err_none;
 
-    if (M3_LIKELY(tableIndex < module->table0Size))
+    u64 key = ((u64) module->table0Generation << 32) | tableIndex;
+    pc_t callee = * cachedCallee;
+
+    if (M3_UNLIKELY(key != * cachedKey))
     {
-        IM3Function function = module->table0 [tableIndex];
+        callee = NULL;
 
-        if (M3_LIKELY(function))
+        if (M3_LIKELY(tableIndex < module->table0Size))
         {
-            if (M3_LIKELY(type == function->funcType))
-            {
-                if (M3_UNLIKELY(not function->compiled))
-                    r = CompileFunction (function);
+            IM3Function function = module->table0 [tableIndex];
 
-                if (M3_LIKELY(not r))
+            if (M3_LIKELY(function))
+            {
+                if (M3_LIKELY(type == function->funcType))
                 {
+                    if (M3_UNLIKELY(not GetCompiledCode (function)))
+                        r = CompileFunction (function);
+
+                    if (M3_LIKELY(not r))
+                    {
+                        callee = GetCompiledCode (function);
+
+                        if (not module->shared)     // other threads could be running this code
+                        {
+                            * cachedKey = key;
+                            * cachedCallee = callee;
+                        }
+                    }
+                }
+                else r = m3Err_trapIndirectCallTypeMismatch;
+            }
+            else r = m3Err_trapTableElementIsNull;
+        }
+        else r = m3Err_trapTableIndexOutOfRange;
+    }
 
+    if (M3_LIKELY(callee))
+    {
 # if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
-                    r = Call (function->compiled, sp, _mem, d_m3OpDefaultArgs, d_m3BaseCstr);
+        r = Call (callee, sp, _mem, d_m3OpDefaultArgs, d_m3BaseCstr);
 # else
-                    r = Call (function->compiled, sp, _mem, d_m3OpDefaultArgs);
+        r = Call (callee, sp, _mem, d_m3OpDefaultArgs);
 # endif
 
-                    _mem = memory->mallocated;
+        _mem = memory->mallocated;
 
-                    if (M3_LIKELY(not r))
-                        nextOpDirect ();
-                    else
-                    {
-                        pushBacktraceFrame ();
-                        forwardTrap (r);
-                    }
-                }
+        if (M3_LIKELY(not r))
+            nextOpDirect ();
+        else
+        {
+            pushBacktraceFrame ();
+            forwardTrap (r);
+        }
+    }
+
+    newTrap (r);
+}
+
+
+// a tail call reuses the current frame: the args are moved down into place and execution continues in the
+// callee's body, without going through Entry, so neither the m3 nor the native stack grows. (an import, or native
+// code, is just called on the frame; its results land where the Return would have left them.) only emitted when
+// d_m3ReuseTailCallFrames is set, since without guaranteed tail calls jumpOp would still grow the native stack.
+#if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
+#   define d_m3TailCallImport(FUNCTION)     Call (GetCompiledCode (FUNCTION), _sp, _mem, d_m3OpDefaultArgs, d_m3BaseCstr)
+#else
+#   define d_m3TailCallImport(FUNCTION)     Call (GetCompiledCode (FUNCTION), _sp, _mem, d_m3OpDefaultArgs)
+#endif
+
+#if d_m3SkipStackCheck
+#   define d_m3TailCallFits(FUNCTION)       true
+#else
+#   define d_m3TailCallFits(FUNCTION)       M3_LIKELY ((void *) (_sp + FUNCTION->maxStackSlots) < _mem->maxStack)
+#endif
+
+#define d_m3TailCall(FUNCTION, STACK_OFFSET)                                                            \
+{                                                                                                       \
+    IM3FuncType ftype = FUNCTION->funcType;                                                             \
+    u32 retBytes = ftype->numRets * sizeof (u64);                                                       \
+                                                                                                        \
+    memmove ((u8 *) _sp + retBytes, (u8 *) (_sp + STACK_OFFSET) + retBytes, ftype->numArgs * sizeof (u64)); \
+                                                                                                        \
+    if (IsImportedFunction (FUNCTION) or FUNCTION->hasNativeCode)                                       \
+    {                                                                                                   \
+        m3ret_t r = d_m3TailCallImport (FUNCTION);                                                      \
+                                                                                                        \
+        if (M3_UNLIKELY(r))                                                                             \
+            pushBacktraceFrame ();                                                                      \
+        forwardTrap (r);                                                                                \
+    }                                                                                                   \
+    else if (d_m3TailCallFits (FUNCTION))                                                               \
+    {                                                                                                   \
+        d_m3ClearRegisters                                                                              \
+                                                                                                        \
+        u8 * stack = (u8 *) ((m3slot_t *) _sp + FUNCTION->numRetAndArgSlots);                           \
+                                                                                                        \
+        if (FUNCTION->numZeroedLocalBytes)                                                              \
+            memset (stack + FUNCTION->zeroedLocalsOffset, 0x0, FUNCTION->numZeroedLocalBytes);          \
+        stack += FUNCTION->numLocalBytes;                                                               \
+                                                                                                        \
+        if (FUNCTION->constants)                                                                        \
+            memcpy (stack, FUNCTION->constants, FUNCTION->numConstantBytes);                            \
+                                                                                                        \
+        jumpOp (GetCompiledCode (FUNCTION) + 2);    /* skip Entry & its function pointer */             \
+    }                                                                                                   \
+    else newTrap (m3Err_trapStackOverflow);                                                             \
+}
+
+
+d_m3Op  (TailCall)
+{
+    IM3Function function        = immediate (IM3Function);
+    i32 stackOffset             = immediate (i32);
+
+    m3InterruptCheck ();        // the callee's Entry is skipped
+
+    m3ret_t r = m3Err_none;
+
+    if (M3_UNLIKELY(not GetCompiledCode (function)))
+        r = CompileFunction (function);
+
+    if (M3_LIKELY(not r))
+        d_m3TailCall (function, stackOffset)
+
+    newTrap (r);
+}
+
+
+d_m3Op  (TailCallIndirect)
+{
+    u32 tableIndex              = slot (u32);
+    IM3Module module            = immediate (IM3Module);
+    IM3FuncType type            = immediate (IM3FuncType);
+    i32 stackOffset             = immediate (i32);
+
+    m3InterruptCheck ();
+
+    m3ret_t r = m3Err_none;
+
+    if (M3_LIKELY(tableIndex < module->table0Size))
+    {
+        IM3Function function = module->table0 [tableIndex];
+
+        if (M3_LIKELY(function))
+        {
+            if (M3_LIKELY(type == function->funcType))
+            {
+                if (M3_UNLIKELY(not GetCompiledCode (function)))
+                    r = CompileFunction (function);
+
+                if (M3_LIKELY(not r))
+                    d_m3TailCall (function, stackOffset)
             }
             else r = m3Err_trapIndirectCallTypeMismatch;
         }
@@ -614,9 +853,7 @@ d_m3Op  (CallIndirect)
     }
     else r = m3Err_trapTableIndexOutOfRange;
 
-    if (M3_UNLIKELY(r))
-        newTrap (r);
-    else forwardTrap (r);
+    newTrap (r);
 }
 
 
@@ -671,6 +908,10 @@ d_m3Op  (CallRawFunction)
     m3ret_t possible_trap = call (runtime, &ctx, sp, m3MemData(_mem));
     runtime->stack = stack_backup;
 
+    // the import completes later; until then the call is suspended
+    if (M3_UNLIKELY(possible_trap == m3Err_pending))
+        possible_trap = Runtime_AwaitImport (runtime, sp);
+
 #if d_m3EnableStrace
     if (M3_UNLIKELY(possible_trap)) {
         d_m3TracePrint("%s -> %s", outbuff, (char*)possible_trap);
@@ -771,19 +1012,44 @@ d_m3Op  (MemFill)
 // do both.
 d_m3Op  (Compile)
 {
-    rewrite_op (op_Call);
-
     IM3Function function        = immediate (IM3Function);
 
     m3ret_t result = m3Err_none;
 
-    if (M3_UNLIKELY(not function->compiled)) // check to see if function was compiled since this operation was emitted.
+    if (M3_UNLIKELY(not GetCompiledCode (function))) // check to see if function was compiled since this operation was emitted.
         result = CompileFunction (function);
 
     if (not result)
     {
+        pc_t compiled = GetCompiledCode (function);
+
+        // code shared by runtime instances is left as it is, since other threads could be running it: the call is made
+        // from here. ShareCompiledCode has already turned the op_Compile it knows of into op_Call
+        if (M3_UNLIKELY(function->module->shared))
+        {
+            i32 stackOffset     = immediate (i32);
+            IM3Memory memory    = m3MemInfo (_mem);
+
+            m3stack_t sp = _sp + stackOffset;
+
+# if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
+            result = Call (compiled, sp, _mem, d_m3OpDefaultArgs, d_m3BaseCstr);
+# else
+            result = Call (compiled, sp, _mem, d_m3OpDefaultArgs);
+# endif
+
+            _mem = memory->mallocated;
+
+            if (M3_LIKELY(not result))
+                nextOp ();
+
+            pushBacktraceFrame ();
+            forwardTrap (result);
+        }
+
         // patch up compiled pc and call rewritten op_Call
-        * ((void**) --_pc) = (void*) (function->compiled);
+        * ((void**) --_pc) = (void*) compiled;
+        rewrite_op (op_Call);
         --_pc;
         nextOpDirect ();
     }
@@ -800,6 +1066,9 @@ d_m3Op  (Entry)
     d_m3TracePrepare
 
     IM3Function function = immediate (IM3Function);
+
+    m3InterruptCheck ();
+
     IM3Memory memory = m3MemInfo (_mem);
 
 #if d_m3SkipStackCheck
@@ -813,7 +1082,8 @@ d_m3Op  (Entry)
 #endif
         u8 * stack = (u8 *) ((m3slot_t *) _sp + function->numRetAndArgSlots);
 
-        memset (stack, 0x0, function->numLocalBytes);
+        if (function->numZeroedLocalBytes)
+            memset (stack + function->zeroedLocalsOffset, 0x0, function->numZeroedLocalBytes);
         stack += function->numLocalBytes;
 
         if (function->constants)
@@ -855,6 +1125,51 @@ d_m3Op  (Entry)
 }
 
 
+#if d_m3EnableJit && d_m3JitTierUpThreshold && !defined(d_m3JitStencils)
+
+// the Entry of a function the JIT hasn't translated yet. once the function is hot, it's translated in place, & this
+// op word, now a plain Entry, is dispatched once more
+d_m3Op  (CountedEntry)
+{
+    IM3Function function = * (IM3Function *) _pc;
+
+    if (M3_UNLIKELY (++function->hotness >= d_m3JitTierUpThreshold))
+    {
+        TierUpFunction (function);
+        jumpOp (_pc - 1);
+    }
+
+    M3_MUSTTAIL return op_Entry (_pc, d_m3OpArgs);
+}
+
+// the header of a loop the JIT hasn't translated yet; a hot loop carries on natively from its next iteration
+d_m3Op  (CountLoop)
+{
+    IM3Function function = immediate (IM3Function);
+
+    if (M3_UNLIKELY (++function->hotness >= d_m3JitTierUpThreshold))
+    {
+        TierUpFunction (function);
+        jumpOp (_pc - 2);
+    }
+
+    nextOp ();
+}
+
+#endif
+
+
+#if d_m3TailCallLoops
+
+// the loop continues jump straight back to the loop header, so the loop body doesn't run in a
+// native frame of its own. _mem stays current without a refresh here: MemGrow & Call update it
+d_m3Op  (Loop)
+{
+    nextOp ();
+}
+
+#else
+
 d_m3Op  (Loop)
 {
     d_m3TracePrepare
@@ -888,6 +1203,8 @@ d_m3Op  (Loop)
     forwardTrap (r);
 }
 
+#endif // d_m3TailCallLoops
+
 
 d_m3Op  (Branch)
 {
@@ -1210,12 +1527,15 @@ d_m3Op  (ContinueLoop)
 {
     m3StackCheck();
 
-    // TODO: this is where execution can "escape" the M3 code and callback to the client / fiber switch
-    // OR it can go in the Loop operation. I think it's best to do here. adding code to the loop operation
-    // has the potential to increase its native-stack usage. (don't forget ContinueLoopIf too.)
+    // the client can have execution stop or switch here (and in ContinueLoopIf); see m3_Interrupt
+    m3InterruptCheck ();
 
     void * loopId = immediate (void *);
+#if d_m3TailCallLoops
+    jumpOp (loopId);
+#else
     return loopId;
+#endif
 }
 
 
@@ -1226,12 +1546,124 @@ d_m3Op  (ContinueLoopIf)
 
     if (condition)
     {
+        m3InterruptCheck ();
+#if d_m3TailCallLoops
+        jumpOp (loopId);
+#else
         return loopId;
+#endif
     }
     else nextOp ();
 }
 
 
+#if d_m3EnableOpFusion
+
+// fused compare + br_if operations. the compare result never touches _r0;
+// the branch target follows the operand slot(s)
+
+#define d_m3CompareBranch(TYPE, NAME, OP, KIND, TAKEN)  \
+d_m3Op  (TYPE##_##NAME##_##KIND##_rs)                   \
+{                                                       \
+    TYPE operand    = slot (TYPE);                      \
+    pc_t target     = immediate (pc_t);                 \
+                                                        \
+    if (operand OP ((TYPE) _r0))                        \
+    {                                                   \
+        TAKEN (target);                                 \
+    }                                                   \
+    else nextOp ();                                     \
+}                                                       \
+d_m3Op  (TYPE##_##NAME##_##KIND##_sr)                   \
+{                                                       \
+    TYPE operand    = slot (TYPE);                      \
+    pc_t target     = immediate (pc_t);                 \
+                                                        \
+    if (((TYPE) _r0) OP operand)                        \
+    {                                                   \
+        TAKEN (target);                                 \
+    }                                                   \
+    else nextOp ();                                     \
+}                                                       \
+d_m3Op  (TYPE##_##NAME##_##KIND##_ss)                   \
+{                                                       \
+    TYPE operand2   = slot (TYPE);                      \
+    TYPE operand1   = slot (TYPE);                      \
+    pc_t target     = immediate (pc_t);                 \
+                                                        \
+    if (operand1 OP operand2)                           \
+    {                                                   \
+        TAKEN (target);                                 \
+    }                                                   \
+    else nextOp ();                                     \
+}
+
+#define d_m3EqzBranch(TYPE, KIND, TAKEN)                \
+d_m3Op  (TYPE##_EqualToZero_##KIND##_r)                 \
+{                                                       \
+    pc_t target     = immediate (pc_t);                 \
+                                                        \
+    if (((TYPE) _r0) == 0)                              \
+    {                                                   \
+        TAKEN (target);                                 \
+    }                                                   \
+    else nextOp ();                                     \
+}                                                       \
+d_m3Op  (TYPE##_EqualToZero_##KIND##_s)                 \
+{                                                       \
+    TYPE operand    = slot (TYPE);                      \
+    pc_t target     = immediate (pc_t);                 \
+                                                        \
+    if (operand == 0)                                   \
+    {                                                   \
+        TAKEN (target);                                 \
+    }                                                   \
+    else nextOp ();                                     \
+}
+
+// forward branch (BranchIf) or loop continue (ContinueLoopIf)
+#define d_m3BranchIfTaken(TARGET)           jumpOp (TARGET)
+#if d_m3TailCallLoops
+#   define d_m3ContinueLoopIfTaken(TARGET)  { m3InterruptCheck (); jumpOp (TARGET); }
+#else
+#   define d_m3ContinueLoopIfTaken(TARGET)  { m3InterruptCheck (); return (TARGET); }
+#endif
+
+#define d_m3CompareBranchOps(TYPE, NAME, OP)                                            \
+        d_m3CompareBranch (TYPE, NAME, OP, BranchIf,        d_m3BranchIfTaken)          \
+        d_m3CompareBranch (TYPE, NAME, OP, ContinueLoopIf,  d_m3ContinueLoopIfTaken)
+
+d_m3EqzBranch (i32, BranchIf, d_m3BranchIfTaken)        d_m3EqzBranch (i32, ContinueLoopIf, d_m3ContinueLoopIfTaken)
+d_m3EqzBranch (i64, BranchIf, d_m3BranchIfTaken)        d_m3EqzBranch (i64, ContinueLoopIf, d_m3ContinueLoopIfTaken)
+
+d_m3CompareBranchOps (i32, Equal,               ==)     d_m3CompareBranchOps (i64, Equal,               ==)
+d_m3CompareBranchOps (i32, NotEqual,            !=)     d_m3CompareBranchOps (i64, NotEqual,            !=)
+
+d_m3CompareBranchOps (i32, LessThan,            < )     d_m3CompareBranchOps (i64, LessThan,            < )
+d_m3CompareBranchOps (i32, GreaterThan,         > )     d_m3CompareBranchOps (i64, GreaterThan,         > )
+d_m3CompareBranchOps (i32, LessThanOrEqual,     <=)     d_m3CompareBranchOps (i64, LessThanOrEqual,     <=)
+d_m3CompareBranchOps (i32, GreaterThanOrEqual,  >=)     d_m3CompareBranchOps (i64, GreaterThanOrEqual,  >=)
+
+d_m3CompareBranchOps (u32, LessThan,            < )     d_m3CompareBranchOps (u64, LessThan,            < )
+d_m3CompareBranchOps (u32, GreaterThan,         > )     d_m3CompareBranchOps (u64, GreaterThan,         > )
+d_m3CompareBranchOps (u32, LessThanOrEqual,     <=)     d_m3CompareBranchOps (u64, LessThanOrEqual,     <=)
+d_m3CompareBranchOps (u32, GreaterThanOrEqual,  >=)     d_m3CompareBranchOps (u64, GreaterThanOrEqual,  >=)
+
+
+// local.get x; i32.const c; i32.add (or i32.sub); local.set x
+d_m3Op  (i32_AddToLocal)
+{
+    u32 * local = slot_ptr (u32);
+    u32 value   = immediate (u32);
+
+    * local += value;
+
+    nextOp ();
+}
+
+#endif // d_m3EnableOpFusion
+
+
 d_m3Op  (Const32)
 {
     u32 value = * (u32 *)_pc++;
@@ -1253,6 +1685,22 @@ d_m3Op  (Unsupported)
     newTrap ("unsupported instruction executed");
 }
 
+#if d_m3EnableGasMetering
+d_m3Op  (ChargeGas)
+{
+    IM3Runtime runtime = m3MemRuntime (_mem);
+    u32 cost = immediate (u32);
+
+    if (M3_UNLIKELY (runtime->gas < cost))
+        newTrap (m3Err_trapOutOfGas);
+
+    runtime->gas -= cost;
+
+    nextOp ();
+}
+#endif
+
+
 d_m3Op  (Unreachable)
 {
     m3StackCheck();
@@ -1269,7 +1717,7 @@ d_m3Op  (End)
 
 d_m3Op  (SetGlobal_s32)
 {
-    u32 * global = immediate (u32 *);
+    u32 * global = d_m3Global (u32);
     * global = slot (u32);
 
     nextOp ();
@@ -1278,7 +1726,7 @@ d_m3Op  (SetGlobal_s32)
 
 d_m3Op  (SetGlobal_s64)
 {
-    u64 * global = immediate (u64 *);
+    u64 * global = d_m3Global (u64);
     * global = slot (u64);
 
     nextOp ();
@@ -1287,7 +1735,7 @@ d_m3Op  (SetGlobal_s64)
 #if d_m3HasFloat
 d_m3Op  (SetGlobal_f32)
 {
-    f32 * global = immediate (f32 *);
+    f32 * global = d_m3Global (f32);
     * global = _fp0;
 
     nextOp ();
@@ -1296,7 +1744,7 @@ d_m3Op  (SetGlobal_f32)
 
 d_m3Op  (SetGlobal_f64)
 {
-    f64 * global = immediate (f64 *);
+    f64 * global = d_m3Global (f64);
     * global = _fp0;
 
     nextOp ();
@@ -1304,7 +1752,7 @@ d_m3Op  (SetGlobal_f64)
 #endif
 
 
-#if d_m3SkipMemoryBoundsCheck
+#if d_m3SkipMemoryBoundsCheck || d_m3UseGuardPages
 #  define m3MemCheck(x) true
 #else
 #  define m3MemCheck(x) M3_LIKELY(x)
@@ -16,11 +16,19 @@ d_m3BeginExternC
 # define m3MemRuntime(mem)              (((M3MemoryHeader*)(mem))->runtime)
 # define m3MemInfo(mem)                 (&(((M3MemoryHeader*)(mem))->runtime->memory))
 
-# define d_m3BaseOpSig                  pc_t _pc, m3stack_t _sp, M3MemoryHeader * _mem, m3reg_t _r0
-# define d_m3BaseOpArgs                 _sp, _mem, _r0
-# define d_m3BaseOpAllArgs              _pc, _sp, _mem, _r0
-# define d_m3BaseOpDefaultArgs          0
-# define d_m3BaseClearRegisters         _r0 = 0;
+# if d_m3UseSecondRegisters
+#   define d_m3BaseOpSig                pc_t _pc, m3stack_t _sp, M3MemoryHeader * _mem, m3reg_t _r0, m3reg_t _r1
+#   define d_m3BaseOpArgs               _sp, _mem, _r0, _r1
+#   define d_m3BaseOpAllArgs            _pc, _sp, _mem, _r0, _r1
+#   define d_m3BaseOpDefaultArgs        0, 0
+#   define d_m3BaseClearRegisters       _r0 = 0; _r1 = 0;
+# else
+#   define d_m3BaseOpSig                pc_t _pc, m3stack_t _sp, M3MemoryHeader * _mem, m3reg_t _r0
+#   define d_m3BaseOpArgs               _sp, _mem, _r0
+#   define d_m3BaseOpAllArgs            _pc, _sp, _mem, _r0
+#   define d_m3BaseOpDefaultArgs        0
+#   define d_m3BaseClearRegisters       _r0 = 0;
+# endif
 # define d_m3BaseCstr                   ""
 
 # define d_m3ExpOpSig(...)              d_m3BaseOpSig, __VA_ARGS__
@@ -29,7 +37,13 @@ d_m3BeginExternC
 # define d_m3ExpOpDefaultArgs(...)      d_m3BaseOpDefaultArgs, __VA_ARGS__
 # define d_m3ExpClearRegisters(...)     d_m3BaseClearRegisters; __VA_ARGS__
 
-# if d_m3HasFloat
+# if d_m3HasFloat && d_m3UseSecondRegisters
+#   define d_m3OpSig                d_m3ExpOpSig            (f64 _fp0, f64 _fp1)
+#   define d_m3OpArgs               d_m3ExpOpArgs           (_fp0, _fp1)
+#   define d_m3OpAllArgs            d_m3ExpOpAllArgs        (_fp0, _fp1)
+#   define d_m3OpDefaultArgs        d_m3ExpOpDefaultArgs    (0., 0.)
+#   define d_m3ClearRegisters       d_m3ExpClearRegisters   (_fp0 = 0.; _fp1 = 0.;)
+# elif d_m3HasFloat
 #   define d_m3OpSig                d_m3ExpOpSig            (f64 _fp0)
 #   define d_m3OpArgs               d_m3ExpOpArgs           (_fp0)
 #   define d_m3OpAllArgs            d_m3ExpOpAllArgs        (_fp0)
@@ -45,7 +59,21 @@ d_m3BeginExternC
 
 
 #define d_m3RetSig                  static inline m3ret_t vectorcall
-# if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
+# if d_m3UseComputedGoto
+    typedef m3ret_t (vectorcall * IM3Operation) (d_m3OpSig);
+    // operations are only identities here; the code pages hold the labels of the ExecuteOperations
+    // function, which m3_exec.c builds from the same m3_exec.h. see GetOperationCode
+#    define d_m3Op(NAME)                M3_NO_UBSAN m3ret_t vectorcall op_##NAME (d_m3OpSig)
+
+#    define nextOpImpl()            ((IM3Operation)(* _pc))(_pc + 1, d_m3OpArgs)
+#    define jumpOpImpl(PC)          ((IM3Operation)(*  PC))( PC + 1, d_m3OpArgs)
+
+    m3ret_t vectorcall              ExecuteOperations       (d_m3OpSig);
+
+    void                            InitOperationCodes      (void);
+    code_t                          GetOperationCode        (IM3Operation i_operation);
+    IM3Operation                    GetCodeOperation        (code_t i_code);
+# elif (d_m3EnableOpProfiling || d_m3EnableOpTracing)
     typedef m3ret_t (vectorcall * IM3Operation) (d_m3OpSig, cstr_t i_operationName);
 #    define d_m3Op(NAME)                M3_NO_UBSAN d_m3RetSig op_##NAME (d_m3OpSig, cstr_t i_operationName)
 
@@ -62,14 +90,25 @@ d_m3BeginExternC
 #define nextOpDirect()              M3_MUSTTAIL return nextOpImpl()
 #define jumpOpDirect(PC)            M3_MUSTTAIL return jumpOpImpl((pc_t)(PC))
 
-# if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
-d_m3RetSig  RunCode  (d_m3OpSig, cstr_t i_operationName)
+# if d_m3UseComputedGoto
+d_m3RetSig  RunCode  (d_m3OpSig)
+{
+    return ExecuteOperations (d_m3OpAllArgs);
+}
 # else
+#   define InitOperationCodes()
+#   define GetOperationCode(OP)     ((code_t) (OP))
+#   define GetCodeOperation(CODE)   ((IM3Operation) (CODE))
+
+#  if (d_m3EnableOpProfiling || d_m3EnableOpTracing)
+d_m3RetSig  RunCode  (d_m3OpSig, cstr_t i_operationName)
+#  else
 d_m3RetSig  RunCode  (d_m3OpSig)
-# endif
+#  endif
 {
     nextOpDirect();
 }
+# endif
 
 d_m3EndExternC
 
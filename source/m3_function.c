@@ -85,6 +85,10 @@ void  Function_Release  (IM3Function i_function)
 {
     m3_Free (i_function->constants);
 
+# if d_m3EnableJit
+    m3_Free (i_function->jitOps);
+# endif
+
     for (int i = 0; i < i_function->numNames; i++)
     {
         // name can be an alias of fieldUtf8
@@ -175,6 +179,12 @@ cstr_t  GetFunctionImportModuleName  (IM3Function i_function)
 }
 
 
+bool  IsImportedFunction  (IM3Function i_function)
+{
+    return i_function->import.moduleUtf8 or i_function->import.fieldUtf8;
+}
+
+
 u16  GetFunctionNumArgs  (IM3Function i_function)
 {
     u16 numArgs = 0;
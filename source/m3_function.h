@@ -46,6 +46,7 @@ typedef struct M3Function
 
     bytes_t                 wasm;
     bytes_t                 wasmEnd;
+    u32                     wasmOffset;                             // of wasm, in the module; for backtraces
 
     cstr_t                  names[d_m3MaxDuplicateFunctionImpl];
     cstr_t                  export_name;                            // should be a part of "names"
@@ -65,6 +66,12 @@ typedef struct M3Function
     u32                     index;
 # endif
 
+# if d_m3EnableJit
+    pc_t *                  jitOps;                                 // the operations of compiled, kept for the JIT until the function is hot
+    u32                     numJitOps;
+    u32                     hotness;                                // entries & loop iterations until then, see d_m3JitTierUpThreshold
+# endif
+
     u16                     maxStackSlots;
 
     u16                     numRetSlots;
@@ -72,8 +79,14 @@ typedef struct M3Function
 
     u16                     numLocals;                              // not including args
     u16                     numLocalBytes;
+    u16                     zeroedLocalsOffset;                     // Entry only clears the locals that may be read before
+    u16                     numZeroedLocalBytes;                    // they're written
 
     bool                    ownsWasmCode;
+    bool                    hasNativeCode;                          // compiled is a raw function call, see m3_LinkNativeFunction
+# if d_m3EnableParallelCompile
+    bool                    queued;                                 // to be compiled in the background, once
+# endif
 
     u16                     numConstantBytes;
     void *                  constants;
@@ -84,6 +97,7 @@ void        Function_Release            (IM3Function i_function);
 void        Function_FreeCompiledCode   (IM3Function i_function);
 
 cstr_t      GetFunctionImportModuleName (IM3Function i_function);
+bool        IsImportedFunction          (IM3Function i_function);
 cstr_t *    GetFunctionNames            (IM3Function i_function, u16 * o_numNames);
 u16         GetFunctionNumArgs          (IM3Function i_function);
 u8          GetFunctionArgType          (IM3Function i_function, u32 i_index);
@@ -95,6 +109,28 @@ u32         GetFunctionNumArgsAndLocals (IM3Function i_function);
 
 cstr_t      SPrintFunctionArgList       (IM3Function i_function, m3stack_t i_sp);
 
+// compiled in the background, the code is published by another thread; see m3_EnableBackgroundCompile
+static inline
+pc_t        GetCompiledCode             (IM3Function i_function)
+{
+# if d_m3EnableParallelCompile
+    return __atomic_load_n (& i_function->compiled, __ATOMIC_ACQUIRE);
+# else
+    return i_function->compiled;
+# endif
+}
+
+static inline
+void        SetCompiledCode             (IM3Function io_function, pc_t i_pc)
+{
+# if d_m3EnableParallelCompile
+    // last: another thread that sees the code, sees all that was set up for it too
+    __atomic_store_n (& io_function->compiled, i_pc, __ATOMIC_RELEASE);
+# else
+    io_function->compiled = i_pc;
+# endif
+}
+
 //---------------------------------------------------------------------------------------------------------------------------------
 
 
@@ -200,6 +200,20 @@ OpInfo find_operation_info  (IM3Operation i_operation)
         else break;
     }
 
+# if d_m3EnableOpFusion
+    for (IM3OpInfo oi = c_operationsFused; not opInfo.info and oi->type != c_m3Type_unknown; ++oi)
+    {
+        for (u32 o = 0; o < 4; ++o)
+        {
+            if (oi->operations [o] == i_operation)
+            {
+                opInfo.info = oi;
+                break;
+            }
+        }
+    }
+# endif
+
     return opInfo;
 }
 
@@ -306,7 +320,7 @@ void  dump_code_page  (IM3CodePage i_codePage, pc_t i_startPC)
         while (pc < end)
         {
             pc_t operationPC = pc;
-            IM3Operation op = (IM3Operation) (* pc++);
+            IM3Operation op = GetCodeOperation (* pc++);
 
                 OpInfo i = find_operation_info (op);
 
@@ -0,0 +1,293 @@
+//
+//  m3_jit.c
+//
+//  Copyright © 2026 Wasm3 contributors.
+//  All rights reserved.
+//
+
+#if defined(__linux__)
+#define _DEFAULT_SOURCE     // mmap flags
+#endif
+
+#include "m3_jit.h"
+
+#if d_m3EnableJit
+
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "m3_env.h"
+#include "m3_compile.h"
+#include "m3_info.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+// a stencil is the machine code of an operation, with holes:
+//   c_jitHole_next         imm64 of a movabs, to be the address of the next operation's code
+//   c_jitHole_jumpNext     'movabs $next, %reg; jmp *%reg', rewritten into a direct jmp to the next operation
+//   c_jitHole_symbol       imm64 = c_jitSymbols [symbol] + addend
+//   c_jitHole_data         imm64 = c_jitData + addend
+// a continuation that ends a stencil has been cut off by extra/jit_stencils.py: the next operation follows directly
+//---------------------------------------------------------------------------------------------------------------------
+
+enum
+{
+    c_jitHole_next,
+    c_jitHole_jumpNext,
+    c_jitHole_symbol,
+    c_jitHole_data
+};
+
+typedef struct M3JitHole
+{
+    u16                     offset;
+    u8                      kind;
+    u16                     symbol;
+    i64                     addend;
+}
+M3JitHole;
+
+typedef struct M3JitStencil
+{
+    u32                     code;           // offset into c_jitCode
+    u16                     size;
+    u16                     firstHole;
+    u16                     numHoles;
+}
+M3JitStencil;
+
+#include "m3_jit_stencils.h"
+
+// what operations without a stencil get: jmp * -8 (%rdi). the op word of the metacode still holds the interpreter's
+// operation & _pc is already past it
+static const u8             c_jitDispatch []            = { 0xff, 0x67, 0xf8 };
+
+
+# define d_m3JitStencilTableSize        2048        // power of 2; comfortably more than the number of stencils
+
+typedef struct M3JitStencilEntry
+{
+    IM3Operation            operation;
+    const M3JitStencil *    stencil;
+}
+M3JitStencilEntry;
+
+static M3JitStencilEntry    s_jitStencils               [d_m3JitStencilTableSize];
+static pthread_once_t       s_jitStencilsOnce           = PTHREAD_ONCE_INIT;    // functions may be compiled on threads at once
+
+
+static inline
+u32  HashJitOperation  (IM3Operation i_operation)
+{
+    u64 h = (u64) (uintptr_t) i_operation;
+    h *= 0x9E3779B97F4A7C15ull;
+
+    return (u32) (h >> 32) & (d_m3JitStencilTableSize - 1);
+}
+
+
+static
+void  RegisterJitStencils  ()
+{
+    d_m3Assert (c_m3NumJitOperations == M3_COUNT_OF (c_jitStencils));
+
+    for (u32 s = 0; s < c_m3NumJitOperations; ++s)
+    {
+        u32 i = HashJitOperation (c_m3JitOperations [s]);
+
+        while (s_jitStencils [i].operation)
+            i = (i + 1) & (d_m3JitStencilTableSize - 1);
+
+        s_jitStencils [i].operation = c_m3JitOperations [s];
+        s_jitStencils [i].stencil = & c_jitStencils [s];
+    }
+}
+
+
+static
+const M3JitStencil *  GetJitStencil  (IM3Operation i_operation)
+{
+    if (i_operation)
+    {
+        u32 i = HashJitOperation (i_operation);
+
+        while (s_jitStencils [i].operation)
+        {
+            if (s_jitStencils [i].operation == i_operation)
+                return s_jitStencils [i].stencil;
+
+            i = (i + 1) & (d_m3JitStencilTableSize - 1);
+        }
+    }
+
+    return NULL;
+}
+
+
+static
+u8 *  EmitStencil  (u8 * o_code, const M3JitStencil * i_stencil)
+{
+    const u8 * code = c_jitCode + i_stencil->code;
+    u8 * next = o_code + i_stencil->size;
+
+    memcpy (o_code, code, i_stencil->size);
+
+    for (u32 h = 0; h < i_stencil->numHoles; ++h)
+    {
+        const M3JitHole * hole = & c_jitHoles [i_stencil->firstHole + h];
+        u8 * at = o_code + hole->offset;
+        u64 value = 0;
+
+        switch (hole->kind)
+        {
+            case c_jitHole_jumpNext:
+            {
+                i32 displacement = (i32) (next - (at + 5));
+                at [0] = 0xe9;
+                memcpy (at + 1, & displacement, sizeof (displacement));
+                continue;
+            }
+            case c_jitHole_next:    value = (u64) (uintptr_t) next; break;
+            case c_jitHole_symbol:  value = (u64) (uintptr_t) c_jitSymbols [hole->symbol] + hole->addend; break;
+            case c_jitHole_data:    value = (u64) (uintptr_t) c_jitData + hole->addend; break;
+        }
+
+        memcpy (at, & value, sizeof (value));
+    }
+
+    return next;
+}
+
+
+static
+int  ComparePCs  (const void * i_a, const void * i_b)
+{
+    uintptr_t a = (uintptr_t) * (const pc_t *) i_a, b = (uintptr_t) * (const pc_t *) i_b;
+    return (a > b) - (a < b);
+}
+
+
+M3Result  Jit_RecordOperation  (IM3Jit io_jit, pc_t i_pc)
+{
+    if (io_jit->numOps == io_jit->maxOps)
+    {
+        u32 maxOps = io_jit->maxOps ? io_jit->maxOps * 2 : 1024;
+
+        pc_t * ops = m3_ReallocArray (pc_t, io_jit->ops, maxOps, io_jit->maxOps);
+
+        if (not ops)
+            return m3Err_mallocFailed;
+
+        io_jit->ops = ops;
+        io_jit->maxOps = maxOps;
+    }
+
+    io_jit->ops [io_jit->numOps++] = i_pc;
+
+    return m3Err_none;
+}
+
+
+void  Jit_CompileFunction  (IM3Jit io_jit, IM3Function io_function, pc_t * io_ops, u32 i_numOps)
+{
+    pthread_once (& s_jitStencilsOnce, RegisterJitStencils);
+
+    // else blocks & such are compiled onto pages of their own, in between. in address order, each operation is directly
+    // followed by the one it continues into; a run of operations on a page always ends in a branch, return or bridge
+    qsort (io_ops, i_numOps, sizeof (pc_t), ComparePCs);
+
+    size_t codeSize = sizeof (c_jitDispatch);   // the last operation continues into a dispatch
+    u32 numStencils = 0;
+
+    for (u32 i = 0; i < i_numOps; ++i)
+    {
+        const M3JitStencil * stencil = GetJitStencil ((IM3Operation) * io_ops [i]);
+
+        if (stencil)
+        {
+            codeSize += stencil->size;
+            ++numStencils;
+        }
+        else codeSize += sizeof (c_jitDispatch);
+    }
+
+    if (not numStencils)
+        return;
+
+    size_t pageSize = (size_t) sysconf (_SC_PAGESIZE);
+    size_t blockSize = (sizeof (M3JitBlock) + codeSize + pageSize - 1) & ~(pageSize - 1);
+
+    M3JitBlock * block = mmap (NULL, blockSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (block == MAP_FAILED)
+        return;
+
+    block->next = io_jit->blocks;
+    block->size = blockSize;
+
+    u8 * code = (u8 *) (block + 1);
+    u8 * native = code;
+
+    for (u32 i = 0; i < i_numOps; ++i)
+    {
+        const M3JitStencil * stencil = GetJitStencil ((IM3Operation) * io_ops [i]);
+
+        if (stencil)
+        {
+            native = EmitStencil (native, stencil);
+        }
+        else
+        {
+            memcpy (native, c_jitDispatch, sizeof (c_jitDispatch));
+            native += sizeof (c_jitDispatch);
+        }
+    }
+
+    memcpy (native, c_jitDispatch, sizeof (c_jitDispatch));
+
+    if (mprotect (block, blockSize, PROT_READ | PROT_EXEC))
+    {
+        munmap (block, blockSize);
+        return;
+    }
+
+    io_jit->blocks = block;
+
+    // only now is the metacode pointed at the native code
+    native = code;
+
+    for (u32 i = 0; i < i_numOps; ++i)
+    {
+        code_t * op = (code_t *) io_ops [i];
+        const M3JitStencil * stencil = GetJitStencil ((IM3Operation) * op);
+
+        if (stencil)
+        {
+            * op = native;
+            native += stencil->size;
+        }
+        else native += sizeof (c_jitDispatch);
+    }
+                                                                        m3log (compile, "jit: %s; %d of %d operations; %d bytes",
+                                                                            m3_GetFunctionName (io_function), numStencils, i_numOps, (u32) codeSize);
+}
+
+
+void  Jit_Release  (IM3Jit io_jit)
+{
+    M3JitBlock * block = io_jit->blocks;
+
+    while (block)
+    {
+        M3JitBlock * next = block->next;
+        munmap (block, block->size);
+        block = next;
+    }
+
+    m3_Free (io_jit->ops);
+}
+
+#endif // d_m3EnableJit
@@ -0,0 +1,61 @@
+//
+//  m3_jit.h
+//
+//  Copyright © 2026 Wasm3 contributors.
+//  All rights reserved.
+//
+
+#ifndef m3_jit_h
+#define m3_jit_h
+
+#include "m3_exec_defs.h"
+
+d_m3BeginExternC
+
+#if d_m3EnableJit
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// copy-and-patch baseline JIT. the compiler records the pc of every operation it emits; once a function is compiled, the
+// stencils of those operations (m3_jit_stencils.c) are copied one after another into executable memory and the op words of
+// the metacode are pointed at them. so, the metacode keeps the immediates & remains the thing that's branched through,
+// while straight-line code falls from one operation into the next. operations without a stencil stay interpreted
+//---------------------------------------------------------------------------------------------------------------------------------
+
+typedef struct M3JitBlock
+{
+    struct M3JitBlock *     next;
+    size_t                  size;           // of the mapping, this header included
+}
+M3JitBlock;
+
+typedef struct M3Jit
+{
+    bool                    enabled;
+
+    pc_t *                  ops;            // the operations emitted for the function being compiled
+    u32                     numOps;
+    u32                     maxOps;
+
+    M3JitBlock *            blocks;         // native code, one mapping per function
+}
+M3Jit;
+
+typedef M3Jit *             IM3Jit;
+
+
+M3Result    Jit_RecordOperation         (IM3Jit io_jit, pc_t i_pc);
+
+// translates the recorded operations of a function; the list is reordered. on any failure, the function simply stays interpreted
+void        Jit_CompileFunction         (IM3Jit io_jit, IM3Function io_function, pc_t * io_ops, u32 i_numOps);
+
+void        Jit_Release                 (IM3Jit io_jit);
+
+// the operations with a stencil; m3_compile.c builds this from the generated list, since it owns the op_ functions
+extern const IM3Operation               c_m3JitOperations [];
+extern const u32                        c_m3NumJitOperations;
+
+#endif // d_m3EnableJit
+
+d_m3EndExternC
+
+#endif // m3_jit_h
@@ -0,0 +1,17 @@
+//
+//  m3_jit_stencils.c
+//
+//  Copyright © 2026 Wasm3 contributors.
+//  All rights reserved.
+//
+
+// this unit is only built for the JIT's stencils (BUILD_JIT defines d_m3JitStencils) & is never linked. the operations are
+// extracted from its object file by extra/jit_stencils.py, into the m3_jit_stencils.h that m3_jit.c includes
+
+#if defined(d_m3JitStencils)
+
+#define M3_COMPILE_OPCODES
+
+#include "m3_exec.h"
+
+#endif // d_m3JitStencils
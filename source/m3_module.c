@@ -26,13 +26,26 @@ void  m3_FreeModule  (IM3Module i_module)
         m3log (module, "freeing module: %s (funcs: %d; segments: %d)",
                i_module->name, i_module->numFunctions, i_module->numDataSegments);
 
+        if (i_module->template)
+        {
+            // everything else belongs to the module of the template runtime
+            m3_Free (i_module->functions);
+            m3_Free (i_module->globals);
+            m3_Free (i_module);
+            return;
+        }
+
         Module_FreeFunctions (i_module);
 
         m3_Free (i_module->functions);
         //m3_Free (i_module->imports);
         m3_Free (i_module->funcTypes);
         m3_Free (i_module->dataSegments);
+#if d_m3EnableMemoryImages
+        FreeMemoryImage (i_module->memoryImage);
+#endif
         m3_Free (i_module->table0);
+        m3_Free (i_module->callStubs.stubs);
 
         for (u32 i = 0; i < i_module->numGlobals; ++i)
         {
@@ -41,6 +54,13 @@ void  m3_FreeModule  (IM3Module i_module)
         }
         m3_Free (i_module->globals);
 
+        while (i_module->pieces)
+        {
+            M3ModuleBytes * next = i_module->pieces->next;
+            m3_Free (i_module->pieces);
+            i_module->pieces = next;
+        }
+
         m3_Free (i_module);
     }
 }
@@ -54,6 +74,7 @@ _try {
     _throwifnull (io_module->globals);
     M3Global * global = & io_module->globals [index];
 
+    global->module = io_module;
     global->type = i_type;
     global->imported = i_isImported;
     global->isMutable = i_mutable;
@@ -289,7 +289,7 @@ _   (ReadLEB_u32 (& startFuncIndex, & i_bytes, i_end));
 
     if (startFuncIndex < io_module->numFunctions)
     {
-        io_module->startFunction = startFuncIndex;
+        io_module->startFunction = io_module->declaredStartFunction = startFuncIndex;
     }
     else result = "start function index out of bounds";
 
@@ -386,6 +386,7 @@ _                   (NormalizeType (& normalType, wasmType));
                 func->module = io_module;
                 func->wasm = start;
                 func->wasmEnd = i_bytes;
+                func->wasmOffset = (u32) (start - io_module->wasmStart);
                 //func->ownsWasmCode = io_module->hasWasmCodeCopy;
 //                func->numLocals = numLocals;
             }
@@ -602,16 +603,47 @@ M3Result  ParseModuleSection  (M3Module * o_module, u8 i_sectionType, bytes_t i_
 }
 
 
+static
+M3Result  CheckSectionOrder  (u8 * io_expectedSection, u8 i_section)
+{
+    M3Result result = m3Err_none;
+
+    static const u8 sectionsOrder[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 12, 10, 11, 0 }; // 0 is a placeholder
+
+    if (i_section != 0) {
+        // Ensure sections appear only once and in order
+        while (sectionsOrder[(* io_expectedSection)++] != i_section) {
+            _throwif(m3Err_misorderedWasmSection, * io_expectedSection >= 12);
+        }
+    }
+
+    _catch: return result;
+}
+
+
+static
+IM3Module  NewModule  (IM3Environment i_environment)
+{
+    IM3Module module = m3_AllocStruct (M3Module);
+
+    if (module)
+    {
+        module->name = ".unnamed";
+        module->startFunction = module->declaredStartFunction = -1;
+        //module->hasWasmCodeCopy = false;
+        module->environment = i_environment;
+    }
+
+    return module;
+}
+
+
 M3Result  m3_ParseModule  (IM3Environment i_environment, IM3Module * o_module, cbytes_t i_bytes, u32 i_numBytes)
 {
     IM3Module module;                                                               m3log (parse, "load module: %d bytes", i_numBytes);
 _try {
-    module = m3_AllocStruct (M3Module);
+    module = NewModule (i_environment);
     _throwifnull (module);
-    module->name = ".unnamed";                                                      m3log (parse, "load module: %d bytes", i_numBytes);
-    module->startFunction = -1;
-    //module->hasWasmCodeCopy = false;
-    module->environment = i_environment;
 
     const u8 * pos = i_bytes;
     const u8 * end = pos + i_numBytes;
@@ -626,20 +658,13 @@ _   (Read_u32 (& version, & pos, end));
     _throwif (m3Err_wasmMalformed, magic != 0x6d736100);
     _throwif (m3Err_incompatibleWasmVersion, version != 1);
 
-    static const u8 sectionsOrder[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 12, 10, 11, 0 }; // 0 is a placeholder
     u8 expectedSection = 0;
 
     while (pos < end)
     {
         u8 section;
 _       (ReadLEB_u7 (& section, & pos, end));
-
-        if (section != 0) {
-            // Ensure sections appear only once and in order
-            while (sectionsOrder[expectedSection++] != section) {
-                _throwif(m3Err_misorderedWasmSection, expectedSection >= 12);
-            }
-        }
+_       (CheckSectionOrder (& expectedSection, section));
 
         u32 sectionLength;
 _       (ReadLEB_u32 (& sectionLength, & pos, end));
@@ -654,10 +679,434 @@ _       (ParseModuleSection (module, section, pos, sectionLength));
 
     if (result)
     {
+        module->runtime = NULL;
+        m3_FreeModule (module);
+        module = NULL;
+    }
+
+    * o_module = module;
+
+    return result;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// streamed in, the bytes pushed are kept until what they're part of is all there. a section is then parsed as above, from a
+// piece of its own that the module keeps; the code section a run of function bodies at a time instead, so that with a runtime,
+// each function can be compiled as soon as its body is in
+
+enum
+{
+    c_streamHeader,
+    c_streamSections,
+    c_streamCode,
+};
+
+typedef struct M3ModuleStream
+{
+    IM3Module               module;
+    IM3Runtime              runtime;
+    M3Result                result;             // the first error; what's pushed after it is ignored
+
+    u8                      state;
+    u8                      expectedSection;
+    u32                     offset;             // in the module, of the first pending byte
+
+    u8 *                    pending;            // what doesn't make up anything complete yet
+    u32                     numPending;
+    u32                     maxPending;
+
+    M3ModuleBytes *         section;            // a section being read straight into its piece
+    u8                      sectionType;
+    u32                     numSectionBytes;
+
+    u32                     codeEnd;            // in the module
+    bool                    hasNumBodies;
+    u32                     numBodies;
+    u32                     nextBody;
+    bool                    compile;
+    M3CallStubs             callStubs;          // the calls to functions whose bodies were yet to come
+}
+M3ModuleStream;
+
+
+M3Result  m3_ParseModuleStreaming  (IM3Environment i_environment, IM3ModuleStream * o_stream, IM3Runtime io_runtime)
+{
+    M3Result result = m3Err_none;
+
+    IM3ModuleStream stream = m3_AllocStruct (M3ModuleStream);
+    _throwifnull (stream);
+
+    stream->module = NewModule (i_environment);
+
+    if (not stream->module)
+    {
+        m3_Free (stream);
+        _throw (m3Err_mallocFailed);
+    }
+
+    stream->runtime = io_runtime;
+    stream->callStubs.deferImports = true;      // not linked until it's all in
+
+    _catch:
+
+    * o_stream = stream;
+
+    return result;
+}
+
+
+static
+M3ModuleBytes *  NewModulePiece  (IM3ModuleStream io_stream, u32 i_size)
+{
+    M3ModuleBytes * piece = (M3ModuleBytes *) m3_Malloc ("M3ModuleBytes", sizeof (M3ModuleBytes) + i_size);
+
+    if (piece)
+    {
+        piece->offset = io_stream->offset;
+        piece->size = i_size;
+
+        piece->next = io_stream->module->pieces;
+        io_stream->module->pieces = piece;
+    }
+
+    return piece;
+}
+
+
+static
+void  ConsumePending  (IM3ModuleStream io_stream, u32 i_numBytes)
+{
+    io_stream->numPending -= i_numBytes;
+    io_stream->offset += i_numBytes;
+
+    memmove (io_stream->pending, io_stream->pending + i_numBytes, io_stream->numPending);
+}
+
+
+static
+M3Result  AppendPending  (IM3ModuleStream io_stream, const u8 * i_bytes, u32 i_numBytes)
+{
+    M3Result result = m3Err_none;
+
+    _throwif (m3Err_wasmOverrun, i_numBytes > UINT32_MAX - io_stream->offset - io_stream->numPending);
+
+    if (io_stream->numPending + i_numBytes > io_stream->maxPending)
+    {
+        u32 maxPending = io_stream->numPending + i_numBytes;
+        u8 * pending = m3_ReallocArray (u8, io_stream->pending, maxPending, io_stream->maxPending);
+        _throwifnull (pending);
+
+        io_stream->pending = pending;
+        io_stream->maxPending = maxPending;
+    }
+
+    memcpy (io_stream->pending + io_stream->numPending, i_bytes, i_numBytes);
+    io_stream->numPending += i_numBytes;
+
+    _catch: return result;
+}
+
+
+static
+M3Result  FillSection  (IM3ModuleStream io_stream, const u8 ** io_bytes, u32 * io_numBytes)
+{
+    M3Result result = m3Err_none;
+
+    M3ModuleBytes * section = io_stream->section;
+    u32 numBytes = M3_MIN (* io_numBytes, section->size - io_stream->numSectionBytes);
+
+    memcpy (section->bytes + io_stream->numSectionBytes, * io_bytes, numBytes);
+    io_stream->numSectionBytes += numBytes;
+    io_stream->offset += numBytes;
+
+    * io_bytes += numBytes;
+    * io_numBytes -= numBytes;
+
+    if (io_stream->numSectionBytes == section->size)
+    {
+        io_stream->section = NULL;
+        result = ParseModuleSection (io_stream->module, io_stream->sectionType, section->bytes, section->size);
+    }
+
+    return result;
+}
+
+
+static
+M3Result  BeginCode  (IM3ModuleStream io_stream, u32 i_numBodies)
+{
+    M3Result result = m3Err_none;
+
+    IM3Module module = io_stream->module;
+    IM3Runtime runtime = io_stream->runtime;
+
+    _throwif ("mismatched function count in code section", i_numBodies != module->numFunctions - module->numFuncImports);
+
+    io_stream->hasNumBodies = true;
+    io_stream->numBodies = i_numBodies;
+
+    // all that the code needs is in: the module can be loaded but for its data segments
+    if (runtime)
+    {
+_       (BeginLoadingModule (runtime, module));
+
+        io_stream->compile = true;
+# if d_m3EnableJit
+        io_stream->compile = not runtime->jit.enabled;
+# endif
+    }
+
+    _catch: return result;
+}
+
+
+static
+M3Result  TakeFunctionBodies  (IM3ModuleStream io_stream)
+{
+    M3Result result = m3Err_none;
+
+    IM3Module module = io_stream->module;
+
+    bytes_t pos = io_stream->pending;
+    bytes_t end = pos + io_stream->numPending;
+    u32 numBodies = 0;
+    M3ModuleBytes * piece = NULL;
+
+    while (io_stream->nextBody + numBodies < io_stream->numBodies)
+    {
+        bytes_t body = pos;
+        u32 size;
+
+        M3Result readResult = ReadLEB_u32 (& size, & body, end);
+        if (readResult == m3Err_wasmUnderrun)
+            break;
+_       (readResult);
+
+        _throwif (m3Err_wasmSectionOverrun, (u64) io_stream->offset + (body - io_stream->pending) + size > io_stream->codeEnd);
+
+        if (size > end - body)
+            break;
+
+        pos = body + size;
+        ++numBodies;
+    }
+
+    if (numBodies)
+    {
+        u32 length = (u32) (pos - io_stream->pending);
+
+        piece = NewModulePiece (io_stream, length);
+        _throwifnull (piece);
+
+        memcpy (piece->bytes, io_stream->pending, length);
+        ConsumePending (io_stream, length);
+
+        pos = piece->bytes;
+        end = pos + length;
+
+        for (u32 i = 0; i < numBodies; ++i)
+        {
+            IM3Function function = Module_GetFunction (module, module->numFuncImports + io_stream->nextBody++);
+
+            bytes_t start = pos;
+            u32 size;
+_           (ReadLEB_u32 (& size, & pos, end));
+            pos += size;
+
+            if (size)
+            {
+                function->module = module;
+                function->wasm = start;
+                function->wasmEnd = pos;
+                function->wasmOffset = piece->offset + (u32) (start - piece->bytes);
+
+                if (io_stream->compile)
+_                   (CompileFunctionWith (& io_stream->runtime->compilation, function, & io_stream->callStubs));
+            }
+        }
+    }
+
+    if (io_stream->nextBody == io_stream->numBodies)
+    {
+        _throwif (m3Err_wasmSectionUnderrun, io_stream->offset != io_stream->codeEnd);
+        io_stream->state = c_streamSections;
+    }
+
+    _catch: return result;
+}
+
+
+static
+M3Result  ReadPending  (IM3ModuleStream io_stream)
+{
+    M3Result result = m3Err_none;
+
+    bool progress = true;
+
+    while (progress and not io_stream->section)
+    {
+        progress = false;
+
+        bytes_t pos = io_stream->pending;
+        cbytes_t end = pos + io_stream->numPending;
+
+        if (io_stream->state == c_streamHeader)
+        {
+            if (io_stream->numPending >= 8)
+            {
+                u32 magic, version;
+_               (Read_u32 (& magic, & pos, end));
+_               (Read_u32 (& version, & pos, end));
+
+                _throwif (m3Err_wasmMalformed, magic != 0x6d736100);
+                _throwif (m3Err_incompatibleWasmVersion, version != 1);
+
+                ConsumePending (io_stream, 8);
+                io_stream->state = c_streamSections;
+                progress = true;
+            }
+        }
+        else if (io_stream->state == c_streamSections)
+        {
+            u8 section;
+            u32 length;
+
+            M3Result readResult = ReadLEB_u7 (& section, & pos, end);
+            if (not readResult)
+                readResult = ReadLEB_u32 (& length, & pos, end);
+
+            if (readResult != m3Err_wasmUnderrun)
+            {
+_               (readResult);
+_               (CheckSectionOrder (& io_stream->expectedSection, section));
+
+                ConsumePending (io_stream, (u32) (pos - io_stream->pending));
+                _throwif (m3Err_wasmOverrun, length > UINT32_MAX - io_stream->offset);
+
+                if (section == 10)
+                {
+                    io_stream->codeEnd = io_stream->offset + length;
+                    io_stream->hasNumBodies = false;
+                    io_stream->state = c_streamCode;
+                }
+                else
+                {
+                    _throwif ("section too large", length > d_m3MaxSaneSectionSize);
+
+                    io_stream->section = NewModulePiece (io_stream, length);
+                    _throwifnull (io_stream->section);
+
+                    io_stream->sectionType = section;
+                    io_stream->numSectionBytes = 0;
+
+                    // what's pending of it already
+                    u32 numBytes = M3_MIN (io_stream->numPending, length);
+                    memcpy (io_stream->section->bytes, io_stream->pending, numBytes);
+                    io_stream->numSectionBytes = numBytes;
+                    ConsumePending (io_stream, numBytes);
+
+                    if (numBytes == length)
+                    {
+                        io_stream->section = NULL;
+_                       (ParseModuleSection (io_stream->module, section, io_stream->module->pieces->bytes, length));
+                    }
+                }
+
+                progress = true;
+            }
+        }
+        else if (not io_stream->hasNumBodies)
+        {
+            u32 numBodies;
+            M3Result readResult = ReadLEB_u32 (& numBodies, & pos, end);
+
+            if (readResult != m3Err_wasmUnderrun)
+            {
+_               (readResult);
+                ConsumePending (io_stream, (u32) (pos - io_stream->pending));
+_               (BeginCode (io_stream, numBodies));
+
+                progress = true;
+            }
+        }
+        else
+        {
+            u32 nextBody = io_stream->nextBody;
+_           (TakeFunctionBodies (io_stream));
+
+            progress = (io_stream->nextBody != nextBody or io_stream->state != c_streamCode);
+        }
+    }
+
+    _catch: return result;
+}
+
+
+M3Result  m3_PushModuleBytes  (IM3ModuleStream io_stream, const uint8_t * const i_bytes, uint32_t i_numBytes)
+{
+    M3Result result = io_stream->result;
+
+    const u8 * bytes = i_bytes;
+    u32 numBytes = i_numBytes;
+
+    while (not result and numBytes)
+    {
+        if (io_stream->section)
+        {
+            result = FillSection (io_stream, & bytes, & numBytes);
+        }
+        else
+        {
+            result = AppendPending (io_stream, bytes, numBytes);
+            numBytes = 0;
+        }
+
+        if (not result)
+            result = ReadPending (io_stream);
+    }
+
+    io_stream->result = result;
+
+    return result;
+}
+
+
+M3Result  m3_FinishModuleStream  (IM3ModuleStream i_stream, IM3Module * o_module)
+{
+    M3Result result = i_stream->result;
+
+    IM3Module module = i_stream->module;
+    IM3Runtime runtime = i_stream->runtime;
+
+    if (not result and (i_stream->state != c_streamSections or i_stream->section or i_stream->numPending))
+        result = m3Err_wasmUnderrun;
+
+    if (not result and runtime)
+    {
+        // without code, it wasn't begun
+        if (not module->runtime)
+            result = BeginLoadingModule (runtime, module);
+
+        if (not result)
+            result = FinishLoadingModule (runtime, module);
+
+        // the calls to functions compiled after their callers
+        if (not result)
+            ResolveCallStubs (& i_stream->callStubs);
+    }
+
+    if (result)
+    {
+        module->runtime = NULL;
         m3_FreeModule (module);
         module = NULL;
     }
 
+    m3_Free (i_stream->pending);
+    m3_Free (i_stream->callStubs.stubs);
+    m3_Free (i_stream);
+
     * o_module = module;
 
     return result;
@@ -0,0 +1,651 @@
+//
+//  m3_snapshot.c
+//
+//  Copyright © 2026 Wasm3 contributors.
+//  All rights reserved.
+//
+
+#if defined(__linux__)
+#define _GNU_SOURCE         // MAP_FIXED; memfd_create
+#endif
+
+#include "m3_env.h"
+#include "m3_exception.h"
+
+#if d_m3EnableSnapshots || d_m3UseReservedMemory
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+
+static
+M3Result  CheckNoCallInProgress  (IM3Runtime i_runtime)
+{
+#if d_m3EnableSuspend
+    if (i_runtime->fiber.active)
+        return m3Err_callSuspended;
+#endif
+    return m3Err_none;
+}
+
+
+#if d_m3EnableSnapshots
+
+//---------------------------------------------------------------------------------------------------------------------
+// a snapshot holds, after the header, each part starting at a multiple of 8 bytes:
+//   M3SnapshotModule       [numModules]        in the order of the runtime's list
+//   u64                    [numGlobals]        the runtime's globals
+//   u32                    [numTableEntries]   table0 of each module, one after another, as indices of its functions
+//   u8                     [memoryLength]      linear memory, at a multiple of the Wasm page size, so that it can be mapped
+// it's only meant for the same build, on the same host: the values are as they are in memory
+//---------------------------------------------------------------------------------------------------------------------
+
+static const char           c_snapshotMagic []          = "wasm3ss";
+
+enum
+{
+    c_snapshotVersion       = 1,
+    c_snapshotNullFunction  = 0xFFFFFFFF,
+};
+
+typedef struct M3SnapshotHeader
+{
+    char                    magic [8];
+    u32                     version;
+    u32                     numModules;
+    u32                     numGlobals;
+    u32                     numTableEntries;
+    u32                     numPages;
+    u32                     unused;
+    u64                     memoryLength;
+}
+M3SnapshotHeader;
+
+typedef struct M3SnapshotModule
+{
+    u32                     numFunctions;
+    u32                     numGlobals;
+    u32                     table0Size;
+    i32                     startFunction;  // -1 once it has run
+}
+M3SnapshotModule;
+
+
+static inline
+size_t  Align  (size_t i_size, size_t i_alignment)
+{
+    return (i_size + i_alignment - 1) & ~(i_alignment - 1);
+}
+
+
+static
+size_t  GetMemoryOffset  (const M3SnapshotHeader * i_header)
+{
+    size_t offset = sizeof (M3SnapshotHeader);
+    offset += Align ((size_t) i_header->numModules * sizeof (M3SnapshotModule), 8);
+    offset += Align ((size_t) i_header->numGlobals * sizeof (u64), 8);
+    offset += Align ((size_t) i_header->numTableEntries * sizeof (u32), 8);
+
+    return Align (offset, d_m3MemPageSize);
+}
+
+
+// functions in the table of an instance are the template's: they're numbered in the module they were set up for
+static
+M3Function *  GetTableFunctions  (IM3Module i_module)
+{
+    return i_module->template ? i_module->template->functions : i_module->functions;
+}
+
+
+static
+M3Result  WritePart  (FILE * i_file, const void * i_bytes, size_t i_size, size_t i_paddedSize)
+{
+    static const u8 c_padding [64] = { 0 };
+
+    if (i_size and fwrite (i_bytes, i_size, 1, i_file) != 1)
+        return "can't write the snapshot";
+
+    for (size_t padding = i_paddedSize - i_size; padding; )
+    {
+        size_t size = M3_MIN (padding, sizeof (c_padding));
+        if (fwrite (c_padding, size, 1, i_file) != 1)
+            return "can't write the snapshot";
+
+        padding -= size;
+    }
+
+    return m3Err_none;
+}
+
+
+M3Result  m3_SnapshotRuntime  (IM3Runtime i_runtime, const char * i_path)
+{
+    M3Result result = m3Err_none;
+
+    M3SnapshotHeader header;
+    M3SnapshotModule * modules = NULL;
+    u32 * table = NULL;
+    FILE * file = NULL;
+    u32 m = 0, e = 0;
+    size_t tableStart;
+    char tempPath [4096];
+
+    M3Memory * memory = & i_runtime->memory;
+
+_   (CheckNoCallInProgress (i_runtime));
+
+    M3_INIT (header);
+    memcpy (header.magic, c_snapshotMagic, sizeof (header.magic));
+    header.version = c_snapshotVersion;
+    header.numGlobals = i_runtime->numGlobals;
+    header.numPages = memory->mallocated ? memory->numPages : 0;
+    header.memoryLength = memory->mallocated ? memory->mallocated->length : 0;
+
+    for (IM3Module module = i_runtime->modules; module; module = module->next)
+    {
+        ++header.numModules;
+        header.numTableEntries += module->table0Size;
+    }
+
+    modules = m3_AllocArray (M3SnapshotModule, header.numModules);
+    table = m3_AllocArray (u32, header.numTableEntries);
+    _throwif (m3Err_mallocFailed, (header.numModules and not modules) or (header.numTableEntries and not table));
+
+    for (IM3Module module = i_runtime->modules; module; module = module->next, ++m)
+    {
+        modules [m].numFunctions = module->numFunctions;
+        modules [m].numGlobals = module->numGlobals;
+        modules [m].table0Size = module->table0Size;
+        modules [m].startFunction = module->startFunction;
+
+        M3Function * functions = GetTableFunctions (module);
+
+        for (u32 i = 0; i < module->table0Size; ++i)
+        {
+            IM3Function function = module->table0 [i];
+
+            // elements only ever refer to functions of their own module
+            table [e++] = function ? (u32) (function - functions) : c_snapshotNullFunction;
+        }
+    }
+
+    // written aside, then moved into place: the file there may be the one the runtime's memory is mapped from
+    _throwif ("snapshot path too long", snprintf (tempPath, sizeof (tempPath), "%s.%d.tmp", i_path, (int) getpid ()) >= (int) sizeof (tempPath));
+
+    file = fopen (tempPath, "wb");
+    _throwif ("can't write the snapshot", not file);
+
+    tableStart = sizeof (M3SnapshotHeader) + Align ((size_t) header.numModules * sizeof (M3SnapshotModule), 8)
+                                           + Align ((size_t) header.numGlobals * sizeof (u64), 8);
+
+_   (WritePart (file, & header, sizeof (header), sizeof (header)));
+_   (WritePart (file, modules, header.numModules * sizeof (M3SnapshotModule), Align (header.numModules * sizeof (M3SnapshotModule), 8)));
+_   (WritePart (file, i_runtime->globals, header.numGlobals * sizeof (u64), header.numGlobals * sizeof (u64)));
+_   (WritePart (file, table, header.numTableEntries * sizeof (u32), GetMemoryOffset (& header) - tableStart));
+
+    if (header.memoryLength)
+_       (WritePart (file, m3MemData (memory->mallocated), (size_t) header.memoryLength, (size_t) header.memoryLength));
+
+    _catch:
+
+    if (file and fclose (file) != 0 and not result)
+        result = "can't write the snapshot";
+
+    if (file and not result and rename (tempPath, i_path) != 0)
+        result = "can't write the snapshot";
+
+    if (result and file)
+        unlink (tempPath);
+
+    m3_Free (modules);
+    m3_Free (table);
+
+    return result;
+}
+
+
+static
+M3Result  CheckSnapshot  (IM3Runtime i_runtime, const u8 * i_bytes, size_t i_size)
+{
+    M3Result result = m3Err_none;
+
+    const M3SnapshotHeader * header = (const M3SnapshotHeader *) i_bytes;
+    const M3SnapshotModule * modules = (const M3SnapshotModule *) (header + 1);
+    const u32 * table;
+    u32 m = 0, e = 0;
+
+    _throwif ("not a snapshot", i_size < sizeof (M3SnapshotHeader)
+                                or memcmp (header->magic, c_snapshotMagic, sizeof (header->magic))
+                                or header->version != c_snapshotVersion);
+
+    _throwif ("corrupt snapshot", GetMemoryOffset (header) + header->memoryLength != i_size);
+
+    table = (const u32 *) (i_bytes + sizeof (M3SnapshotHeader) + Align ((size_t) header->numModules * sizeof (M3SnapshotModule), 8)
+                                                                + Align ((size_t) header->numGlobals * sizeof (u64), 8));
+
+    _throwif (m3Err_snapshotMismatch, header->numGlobals != i_runtime->numGlobals);
+    _throwif (m3Err_snapshotMismatch, header->numPages > i_runtime->memory.maxPages);
+
+    for (IM3Module module = i_runtime->modules; module; module = module->next, ++m)
+    {
+        _throwif (m3Err_snapshotMismatch, m >= header->numModules
+                                          or modules [m].numFunctions != module->numFunctions
+                                          or modules [m].numGlobals != module->numGlobals
+                                          or modules [m].table0Size != module->table0Size
+                                          or modules [m].startFunction >= (i32) module->numFunctions);
+
+        M3Function * functions = GetTableFunctions (module);
+
+        for (u32 i = 0; i < module->table0Size; ++i, ++e)
+        {
+            u32 index = table [e];
+            _throwif ("corrupt snapshot", index != c_snapshotNullFunction and index >= module->numFunctions);
+
+            // the table of a template serves its instances as well: it stays as it is
+            if (module->template or module->shared)
+            {
+                IM3Function function = (index == c_snapshotNullFunction) ? NULL : & functions [index];
+                _throwif (m3Err_snapshotMismatch, module->table0 [i] != function);
+            }
+        }
+    }
+
+    _throwif (m3Err_snapshotMismatch, m != header->numModules);
+
+    _catch: return result;
+}
+
+
+static
+M3Result  RestoreMemory  (IM3Runtime io_runtime, const M3SnapshotHeader * i_header, const u8 * i_bytes, int i_fd)
+{
+    M3Result result = m3Err_none;
+
+    M3Memory * memory = & io_runtime->memory;
+
+    if (i_header->numPages != memory->numPages)
+_       (ResizeMemory (io_runtime, i_header->numPages));
+
+    // a memory limit of the runtime may keep the memory from being as large as it was
+    _throwif (m3Err_snapshotMismatch, (memory->mallocated ? memory->mallocated->length : 0) != i_header->memoryLength);
+
+    if (i_header->memoryLength)
+    {
+        u8 * data = m3MemData (memory->mallocated);
+        size_t length = (size_t) i_header->memoryLength;
+        size_t offset = GetMemoryOffset (i_header);
+
+# if d_m3UseReservedMemory
+        // linear memory is page aligned in its reservation: the pages of the file take the place of its own, copied as written
+        void * mapped = mmap (data, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, i_fd, (off_t) offset);
+        _throwif (m3Err_mallocFailed, mapped == MAP_FAILED);
+# else
+        memcpy (data, i_bytes + offset, length);
+# endif
+    }
+
+    _catch: return result;
+}
+
+
+M3Result  m3_RestoreRuntime  (IM3Runtime io_runtime, const char * i_path)
+{
+    M3Result result = m3Err_none;
+
+    struct stat info;
+    u8 * bytes = (u8 *) MAP_FAILED;
+    size_t size = 0;
+    int fd = -1;
+
+_   (CheckNoCallInProgress (io_runtime));
+
+    fd = open (i_path, O_RDONLY | O_CLOEXEC);
+    _throwif ("can't read the snapshot", fd < 0);
+
+    if (fstat (fd, & info) == 0 and info.st_size > 0)
+    {
+        size = (size_t) info.st_size;
+        bytes = (u8 *) mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    _throwif ("can't read the snapshot", bytes == MAP_FAILED);
+
+    // as much as can be is checked before any of the runtime changes
+_   (CheckSnapshot (io_runtime, bytes, size));
+
+    {
+        const M3SnapshotHeader * header = (const M3SnapshotHeader *) bytes;
+        const M3SnapshotModule * modules = (const M3SnapshotModule *) (header + 1);
+        const u64 * globals = (const u64 *) ((const u8 *) modules + Align ((size_t) header->numModules * sizeof (M3SnapshotModule), 8));
+        const u32 * table = (const u32 *) ((const u8 *) globals + Align ((size_t) header->numGlobals * sizeof (u64), 8));
+
+_       (RestoreMemory (io_runtime, header, bytes, fd));
+
+        if (header->numGlobals)
+            memcpy (io_runtime->globals, globals, header->numGlobals * sizeof (u64));
+
+        u32 m = 0;
+        for (IM3Module module = io_runtime->modules; module; module = module->next, ++m)
+        {
+            module->startFunction = modules [m].startFunction;
+
+            if (not (module->template or module->shared))
+            {
+                for (u32 i = 0; i < module->table0Size; ++i)
+                    module->table0 [i] = (table [i] == c_snapshotNullFunction) ? NULL : & module->functions [table [i]];
+
+                module->table0Generation++;
+            }
+
+            table += module->table0Size;
+        }
+    }
+
+    _catch:
+
+    if (bytes != MAP_FAILED)
+        munmap (bytes, size);
+
+    if (fd >= 0)
+        close (fd);
+
+    return result;
+}
+
+#else // d_m3EnableSnapshots
+
+M3Result  m3_SnapshotRuntime  (IM3Runtime i_runtime, const char * i_path)
+{
+    return m3Err_snapshotsUnavailable;
+}
+
+M3Result  m3_RestoreRuntime  (IM3Runtime io_runtime, const char * i_path)
+{
+    return m3Err_snapshotsUnavailable;
+}
+
+#endif // d_m3EnableSnapshots
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// a checkpoint is a snapshot kept in memory, that a runtime goes back to on each m3_ResetRuntime. with the memory mapped
+// (d_m3UseReservedMemory), its memory is written to a memfd that's then mapped copy on write over the linear memory: the
+// pages a call writes to are the only ones copied, & mapping the memfd again on a reset throws them away. the kernel keeps
+// track of the dirty pages that way, & the cost of a reset is that of the pages touched since, not of the whole memory
+//---------------------------------------------------------------------------------------------------------------------
+
+typedef struct M3Checkpoint
+{
+    u32                     numModules;
+    u32                     numGlobals;
+    u32                     numTableEntries;
+    u32                     numPages;
+    size_t                  memoryLength;
+
+# if d_m3UseReservedMemory
+    int                     memoryFd;
+# else
+    u8 *                    memory;
+# endif
+
+    u64 *                   globals;
+    IM3Function *           table;          // the table0s of the modules that own theirs, one after another
+    i32 *                   startFunctions;
+}
+M3Checkpoint;
+
+
+// as in a snapshot, the table of a template or of an instance is the template's, & stays as it is
+static inline
+bool  OwnsTable  (IM3Module i_module)
+{
+    return not (i_module->template or i_module->shared);
+}
+
+
+void  FreeCheckpoint  (M3Checkpoint * i_checkpoint)
+{
+    if (i_checkpoint)
+    {
+# if d_m3UseReservedMemory
+        if (i_checkpoint->memoryFd >= 0)
+            close (i_checkpoint->memoryFd);
+# else
+        m3_Free (i_checkpoint->memory);
+# endif
+        m3_Free (i_checkpoint->globals);
+        m3_Free (i_checkpoint->table);
+        m3_Free (i_checkpoint->startFunctions);
+        m3_Free (i_checkpoint);
+    }
+}
+
+
+# if d_m3UseReservedMemory
+
+static
+bool  IsZeroPage  (const u8 * i_page, size_t i_size)
+{
+    const u64 * words = (const u64 *) i_page;
+
+    for (size_t i = 0; i < i_size / sizeof (u64); ++i)
+    {
+        if (words [i])
+            return false;
+    }
+
+    return true;
+}
+
+
+// the pages that are all zeros are left as holes in the file
+static
+M3Result  WriteMemoryFile  (int i_fd, const u8 * i_data, size_t i_length)
+{
+    M3Result result = m3Err_none;
+
+    size_t pageSize = (size_t) sysconf (_SC_PAGESIZE);
+    size_t start = 0;
+
+    _throwif (m3Err_mallocFailed, ftruncate (i_fd, (off_t) i_length));
+
+    while (start < i_length)
+    {
+        if (IsZeroPage (i_data + start, pageSize))
+        {
+            start += pageSize;
+            continue;
+        }
+
+        size_t end = start + pageSize;
+        while (end < i_length and not IsZeroPage (i_data + end, pageSize))
+            end += pageSize;
+
+        while (start < end)
+        {
+            ssize_t numWritten = pwrite (i_fd, i_data + start, end - start, (off_t) start);
+            _throwif (m3Err_mallocFailed, numWritten <= 0);
+
+            start += (size_t) numWritten;
+        }
+    }
+
+    _catch: return result;
+}
+
+
+static
+M3Result  MapCheckpointMemory  (IM3Runtime io_runtime, M3Checkpoint * i_checkpoint)
+{
+    M3Result result = m3Err_none;
+
+    if (i_checkpoint->memoryLength)
+    {
+        void * data = m3MemData (io_runtime->memory.mallocated);
+
+        void * mapped = mmap (data, i_checkpoint->memoryLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, i_checkpoint->memoryFd, 0);
+        _throwif (m3Err_mallocFailed, mapped == MAP_FAILED);
+    }
+
+    _catch: return result;
+}
+
+# endif // d_m3UseReservedMemory
+
+
+static
+M3Result  SaveCheckpointMemory  (IM3Runtime i_runtime, M3Checkpoint * io_checkpoint)
+{
+    M3Result result = m3Err_none;
+
+    M3Memory * memory = & i_runtime->memory;
+
+    io_checkpoint->numPages = memory->numPages;
+    io_checkpoint->memoryLength = memory->mallocated ? memory->mallocated->length : 0;
+
+# if d_m3UseReservedMemory
+    io_checkpoint->memoryFd = -1;
+
+    if (io_checkpoint->memoryLength)
+    {
+        io_checkpoint->memoryFd = memfd_create ("wasm3 checkpoint", MFD_CLOEXEC);
+        _throwif (m3Err_mallocFailed, io_checkpoint->memoryFd < 0);
+
+_       (WriteMemoryFile (io_checkpoint->memoryFd, m3MemData (memory->mallocated), io_checkpoint->memoryLength));
+
+        // from now on, the pages the runtime writes to are its own copies of the checkpoint's
+_       (MapCheckpointMemory (i_runtime, io_checkpoint));
+    }
+# else
+    if (io_checkpoint->memoryLength)
+    {
+        io_checkpoint->memory = m3_AllocArray (u8, io_checkpoint->memoryLength);
+        _throwifnull (io_checkpoint->memory);
+
+        memcpy (io_checkpoint->memory, m3MemData (memory->mallocated), io_checkpoint->memoryLength);
+    }
+# endif
+
+    _catch: return result;
+}
+
+
+M3Result  m3_CheckpointRuntime  (IM3Runtime io_runtime)
+{
+    M3Result result = m3Err_none;
+
+    M3Checkpoint * checkpoint = NULL;
+    u32 m = 0, e = 0;
+
+_   (CheckNoCallInProgress (io_runtime));
+
+    checkpoint = m3_AllocStruct (M3Checkpoint);
+    _throwifnull (checkpoint);
+
+# if d_m3UseReservedMemory
+    checkpoint->memoryFd = -1;
+# endif
+    checkpoint->numGlobals = io_runtime->numGlobals;
+
+    for (IM3Module module = io_runtime->modules; module; module = module->next)
+    {
+        ++checkpoint->numModules;
+
+        if (OwnsTable (module))
+            checkpoint->numTableEntries += module->table0Size;
+    }
+
+    checkpoint->globals = m3_AllocArray (u64, checkpoint->numGlobals);
+    checkpoint->table = m3_AllocArray (IM3Function, checkpoint->numTableEntries);
+    checkpoint->startFunctions = m3_AllocArray (i32, checkpoint->numModules);
+    _throwif (m3Err_mallocFailed, (checkpoint->numGlobals and not checkpoint->globals)
+                                  or (checkpoint->numTableEntries and not checkpoint->table)
+                                  or (checkpoint->numModules and not checkpoint->startFunctions));
+
+    if (checkpoint->numGlobals)
+        memcpy (checkpoint->globals, io_runtime->globals, checkpoint->numGlobals * sizeof (u64));
+
+    for (IM3Module module = io_runtime->modules; module; module = module->next, ++m)
+    {
+        checkpoint->startFunctions [m] = module->startFunction;
+
+        if (OwnsTable (module))
+        {
+            if (module->table0Size)
+                memcpy (checkpoint->table + e, module->table0, module->table0Size * sizeof (IM3Function));
+
+            e += module->table0Size;
+        }
+    }
+
+_   (SaveCheckpointMemory (io_runtime, checkpoint));
+
+    FreeCheckpoint (io_runtime->checkpoint);
+    io_runtime->checkpoint = checkpoint;
+    checkpoint = NULL;
+
+    _catch:
+
+    FreeCheckpoint (checkpoint);
+
+    return result;
+}
+
+
+M3Result  m3_ResetRuntime  (IM3Runtime io_runtime)
+{
+    M3Result result = m3Err_none;
+
+    M3Checkpoint * checkpoint = io_runtime->checkpoint;
+    u32 m = 0, e = 0;
+
+    _throwif (m3Err_noCheckpoint, not checkpoint);
+
+_   (CheckNoCallInProgress (io_runtime));
+
+    // a module loaded since would be left as it is
+    for (IM3Module module = io_runtime->modules; module; module = module->next)
+        ++m;
+
+    _throwif (m3Err_snapshotMismatch, m != checkpoint->numModules or io_runtime->numGlobals != checkpoint->numGlobals);
+
+    // memory grown since gives its pages back, & comes back zero-filled if it grows again
+    if (io_runtime->memory.numPages != checkpoint->numPages)
+_       (ResizeMemory (io_runtime, checkpoint->numPages));
+
+# if d_m3UseReservedMemory
+_   (MapCheckpointMemory (io_runtime, checkpoint));
+# else
+    if (checkpoint->memoryLength)
+        memcpy (m3MemData (io_runtime->memory.mallocated), checkpoint->memory, checkpoint->memoryLength);
+# endif
+
+    if (checkpoint->numGlobals)
+        memcpy (io_runtime->globals, checkpoint->globals, checkpoint->numGlobals * sizeof (u64));
+
+    m = 0;
+    for (IM3Module module = io_runtime->modules; module; module = module->next, ++m)
+    {
+        module->startFunction = checkpoint->startFunctions [m];
+
+        if (OwnsTable (module))
+        {
+            if (module->table0Size)
+                memcpy (module->table0, checkpoint->table + e, module->table0Size * sizeof (IM3Function));
+
+            e += module->table0Size;
+            module->table0Generation++;
+        }
+    }
+
+    // nothing of the last call is kept: its results are no longer to be had from the stack, nor its error
+    io_runtime->lastCalled = NULL;
+    m3_ResetErrorInfo (io_runtime);
+
+    _catch: return result;
+}
@@ -17,6 +17,7 @@
 #include <stdint.h>
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stdbool.h>
 
 #include "wasm3_defs.h"
 
@@ -34,6 +35,7 @@ struct M3Runtime;       typedef struct M3Runtime *      IM3Runtime;
 struct M3Module;        typedef struct M3Module *       IM3Module;
 struct M3Function;      typedef struct M3Function *     IM3Function;
 struct M3Global;        typedef struct M3Global *       IM3Global;
+struct M3ModuleStream;  typedef struct M3ModuleStream * IM3ModuleStream;
 
 typedef struct M3ErrorInfo
 {
@@ -170,6 +172,17 @@ d_m3ErrorConst  (argumentTypeMismatch,          "argument type mismatch")
 d_m3ErrorConst  (globalLookupFailed,            "global lookup failed")
 d_m3ErrorConst  (globalTypeMismatch,            "global type mismatch")
 d_m3ErrorConst  (globalNotMutable,              "global is not mutable")
+d_m3ErrorConst  (jitUnavailable,                "the JIT isn't part of this build")
+d_m3ErrorConst  (suspended,                     "execution suspended")
+d_m3ErrorConst  (pending,                       "execution waits on an import")
+d_m3ErrorConst  (pendingUnsupported,            "an import is pending, but this build can't suspend calls")
+d_m3ErrorConst  (callSuspended,                 "the runtime has a suspended call to resume or discard")
+d_m3ErrorConst  (noSuspendedCall,               "there's no suspended call")
+d_m3ErrorConst  (gasMeteringUnavailable,        "gas metering isn't part of this build")
+d_m3ErrorConst  (parallelCompileUnavailable,    "parallel compilation isn't part of this build")
+d_m3ErrorConst  (snapshotsUnavailable,          "runtime snapshots aren't part of this build")
+d_m3ErrorConst  (snapshotMismatch,              "the snapshot is of other modules")
+d_m3ErrorConst  (noCheckpoint,                  "the runtime has no checkpoint to reset to")
 
 // traps
 d_m3ErrorConst  (trapOutOfBoundsMemoryAccess,   "[trap] out of bounds memory access")
@@ -183,6 +196,8 @@ d_m3ErrorConst  (trapExit,                      "[trap] program called exit")
 d_m3ErrorConst  (trapAbort,                     "[trap] program called abort")
 d_m3ErrorConst  (trapUnreachable,               "[trap] unreachable executed")
 d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
+d_m3ErrorConst  (trapOutOfGas,                  "[trap] out of gas")
+d_m3ErrorConst  (trapInterrupted,               "[trap] interrupted")
 
 
 //-------------------------------------------------------------------------------------------------------------------------------
@@ -211,7 +226,34 @@ d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
 
     void                m3_FreeRuntime              (IM3Runtime             i_runtime);
 
+    // a runtime of its own, for the modules loaded into i_template, that runs the code compiled for them there. only memory,
+    // globals & the start function are set up anew. the template must be linked first, since its code is completed (compiled
+    // and, with the JIT, translated) & no longer changes. it has to outlive its instances, which are freed with m3_FreeRuntime
+    M3Result            m3_NewRuntimeInstance       (IM3Runtime *           o_runtime,
+                                                     IM3Runtime             io_template,
+                                                     uint32_t               i_stackSizeInBytes,
+                                                     void *                 i_userdata);
+
+    // Writes the state of the runtime to a file: its memory, the values of its globals, the tables & whether the start
+    // functions have run. m3_RestoreRuntime sets a runtime with the same modules, loaded & linked the same way, to that state,
+    // mapping the memory from the file (copy on write), so that an expensive initialization runs once rather than per instance.
+    // Neither may be called while a call is in progress or suspended
+    M3Result            m3_SnapshotRuntime          (IM3Runtime             i_runtime,
+                                                     const char *           i_path);
+
+    M3Result            m3_RestoreRuntime           (IM3Runtime             io_runtime,
+                                                     const char *           i_path);
+
+    // Keeps the state of the runtime, as m3_SnapshotRuntime would, but in memory: typically once it's instantiated & its start
+    // functions have run. m3_ResetRuntime then sets it back to that state, keeping the compiled code, so that a runtime can
+    // serve one request after another in isolation. With d_m3UseReservedMemory, only the pages of memory written to since are
+    // thrown away; memory grown since is given back. Neither may be called while a call is in progress or suspended
+    M3Result            m3_CheckpointRuntime        (IM3Runtime             io_runtime);
+
+    M3Result            m3_ResetRuntime             (IM3Runtime             io_runtime);
+
     // Wasm currently only supports one memory region. i_memoryIndex should be zero.
+    // With d_m3UseReservedMemory (64-bit Linux), the memory never moves as it grows; otherwise memory.grow may move it
     uint8_t *           m3_GetMemory                (IM3Runtime             i_runtime,
                                                      uint32_t *             o_memorySizeInBytes,
                                                      uint32_t               i_memoryIndex);
@@ -221,6 +263,65 @@ d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
 
     void *              m3_GetUserData              (IM3Runtime             i_runtime);
 
+    // Functions compiled from now on are also translated to native code (x86-64 Linux builds with d_m3EnableJit).
+    // Whatever the JIT can't translate keeps running in the interpreter
+    M3Result            m3_EnableJit                (IM3Runtime             io_runtime,
+                                                     bool                   i_enable);
+
+    // Functions compiled from now on are metered: every Wasm instruction costs a unit of gas, charged up front for each
+    // straight-line run of them. A run the remaining gas can't cover traps with m3Err_trapOutOfGas, leaving the gas as is.
+    // Native code, including functions linked with m3_LinkNativeFunction, isn't metered
+    M3Result            m3_EnableGasMetering        (IM3Runtime             io_runtime,
+                                                     bool                   i_enable);
+
+    // m3_CompileModule compiles the functions of a module on this many threads, the caller's included; 0 is one per core.
+    // By default, and with the JIT on, it's just the caller's. Needs a build with d_m3EnableParallelCompile
+    M3Result            m3_SetCompileThreads        (IM3Runtime             io_runtime,
+                                                     uint32_t               i_numThreads);
+
+    // From then on, m3_LoadModule starts compiling what the start function & the exports call, in the order they call it,
+    // on a thread of the runtime's own; a function called while it's being compiled there is waited for. Not with the JIT on.
+    // Needs a build with d_m3EnableParallelCompile
+    M3Result            m3_EnableBackgroundCompile  (IM3Runtime             io_runtime,
+                                                     bool                   i_enable);
+
+    void                m3_SetGas                   (IM3Runtime             io_runtime,
+                                                     uint64_t               i_gas);
+
+    uint64_t            m3_GetGas                   (IM3Runtime             i_runtime);
+
+    // Refills the budget (saturating)
+    void                m3_AddGas                   (IM3Runtime             io_runtime,
+                                                     uint64_t               i_gas);
+
+    typedef M3Result (* M3InterruptHandler) (IM3Runtime i_runtime, void * i_userdata);
+
+    // Has the execution stop at the next function entry or loop back-edge. It's a single store, so it's fine from another
+    // thread, a timer or a signal handler. There, the interrupt handler is called: a result traps with it (a deadline that
+    // has passed, say) & NULL carries on. Without a handler, the execution traps with m3Err_trapInterrupted
+    void                m3_Interrupt                (IM3Runtime             io_runtime);
+
+    void                m3_SetInterruptHandler      (IM3Runtime             io_runtime,
+                                                     M3InterruptHandler     i_handler,
+                                                     void *                 i_userdata);
+
+    // With d_m3EnableSuspend, an interrupt handler can return m3Err_suspended instead: the call returns it, the execution
+    // set aside as is. Until it's resumed or discarded, the runtime takes no other call (m3Err_callSuspended)
+    // m3_Resume continues it, & returns what the call would have (or m3Err_suspended once more)
+    M3Result            m3_Resume                   (IM3Runtime             io_runtime);
+
+    // Drops the suspended call, nested calls from its imports included; the runtime takes calls again
+    void                m3_DiscardSuspended         (IM3Runtime             io_runtime);
+
+    // Likewise, an import that can't complete right away can return m3Err_pending (m3ApiPending). The call is suspended &
+    // returns m3Err_pending; the embedder gets on with other work. Once the import's results are ready, they're written
+    // to its slots (its _sp, which stays valid meanwhile), & m3_CompleteImport continues the execution as if the import
+    // had just returned i_result. m3_Resume doesn't apply to a call that waits on an import
+    uint64_t *          m3_GetPendingImportSlots    (IM3Runtime             i_runtime);
+
+    M3Result            m3_CompleteImport           (IM3Runtime             io_runtime,
+                                                     M3Result               i_result);
+
 
 //-------------------------------------------------------------------------------------------------------------------------------
 //  modules
@@ -232,6 +333,21 @@ d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
                                                      const uint8_t * const  i_wasmBytes,
                                                      uint32_t               i_numWasmBytes);
 
+    // Parses a module as its bytes come in, any number at a time; they're copied, so needn't persist. Given a runtime, the module
+    // is loaded into it as soon as its code section starts & each function is compiled as its body comes in (but with the JIT).
+    // m3_FinishModuleStream then frees the stream, & its module comes back loaded: data segments & elements are applied last
+    M3Result            m3_ParseModuleStreaming     (IM3Environment         i_environment,
+                                                     IM3ModuleStream *      o_stream,
+                                                     IM3Runtime             io_runtime);    // NULL: parse only
+
+    // once one fails, so does each after
+    M3Result            m3_PushModuleBytes          (IM3ModuleStream        io_stream,
+                                                     const uint8_t * const  i_bytes,
+                                                     uint32_t               i_numBytes);
+
+    M3Result            m3_FinishModuleStream       (IM3ModuleStream        i_stream,
+                                                     IM3Module *            o_module);
+
     // Only modules not loaded into a M3Runtime need to be freed. A module is considered unloaded if
     // a. m3_LoadModule has not yet been called on that module. Or,
     // b. m3_LoadModule returned a result.
@@ -243,6 +359,11 @@ d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
     // Optional, compiles all functions in the module
     M3Result            m3_CompileModule            (IM3Module io_module);
 
+    // Like m3_CompileModule, but takes the compiled code from a file in i_cacheDir when one matches the module & this build
+    // of wasm3, and writes it there otherwise. Link the imports first. The cache is best effort: if it can't be read or written,
+    // the module is compiled as usual
+    M3Result            m3_CompileModuleCached      (IM3Module io_module, const char * i_cacheDir);
+
     // Calling m3_RunStart is optional
     M3Result            m3_RunStart                 (IM3Module i_module);
 
@@ -264,6 +385,14 @@ d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
                                                      M3RawCall              i_function,
                                                      const void *           i_userdata);
 
+    // Replaces the body of a function the module defines with native code, such as what platforms/aot translates it into.
+    // i_functionIndex counts the imported functions too. The function is then called like an import, from anywhere.
+    // Like imports, it uses no gas
+    M3Result            m3_LinkNativeFunction       (IM3Module              io_module,
+                                                     uint32_t               i_functionIndex,
+                                                     const char * const     i_signature,
+                                                     M3RawCall              i_function);
+
     const char*         m3_GetModuleName            (IM3Module i_module);
     void                m3_SetModuleName            (IM3Module i_module, const char* name);
     IM3Runtime          m3_GetModuleRuntime         (IM3Module i_module);
@@ -285,6 +414,9 @@ d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
 //-------------------------------------------------------------------------------------------------------------------------------
 //  functions
 //-------------------------------------------------------------------------------------------------------------------------------
+    // Breaking change: the interpreter used to call this (weak) hook on every Wasm call. It's now only called in builds with
+    // d_m3EnableYield, where the interrupt checks call it: at function entries & loop back-edges. Hosts that override it to
+    // stop or pace execution should use m3_Interrupt & m3_SetInterruptHandler instead, or build with d_m3EnableYield
     M3Result            m3_Yield                    (void);
 
     // o_function is valid during the lifetime of the originating runtime
@@ -347,6 +479,7 @@ d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
 # define m3ApiMultiValueReturn(NAME, VALUE)   { *NAME = (VALUE); }
 # define m3ApiTrap(VALUE)                     { return VALUE; }
 # define m3ApiSuccess()                       { return m3Err_none; }
+# define m3ApiPending()                       { return m3Err_pending; }
 
 # if defined(M3_BIG_ENDIAN)
 #  define m3ApiReadMem8(ptr)         (* (uint8_t *)(ptr))
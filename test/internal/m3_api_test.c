@@ -0,0 +1,798 @@
+//
+//  m3_api_test.c
+//
+//  Copyright © 2026 Wasm3 contributors.
+//  All rights reserved.
+//
+//  Regression tests of the embedding API, & of what's behind it. The modules are assembled by hand; their text is
+//  in the comment above each. ctest runs them all; m3_api_test <name> runs one
+//
+
+#define _POSIX_C_SOURCE 200809L     // mkdtemp
+
+#include <stdio.h>
+#include <string.h>
+
+#include "wasm3.h"
+#include "m3_env.h"
+
+#if d_m3EnableParallelCompile
+#   include <pthread.h>
+#endif
+
+#if d_m3EnableCodeCache || d_m3EnableSnapshots
+#   include <dirent.h>
+#   include <stdlib.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#define Test(NAME)      if (RunTest (argc, argv, #NAME))
+#define expect(TEST)    if (not (TEST)) { printf ("failed: (%s) on line: %d\n", #TEST, __LINE__); ++s_numFailures; }
+
+static int  s_numFailures   = 0;
+
+
+static
+bool  RunTest  (int i_argc, const char * i_argv [], const char * i_name)
+{
+    const char * option = (i_argc == 2) ? i_argv [1] : NULL;
+
+    bool runningTest = option ? strcmp (option, i_name) == 0 : true;
+
+    if (runningTest)
+        printf ("\n    test: %s\n", i_name);
+
+    return runningTest;
+}
+
+
+static
+M3Result  LoadWasm  (IM3Module * o_module, IM3Environment i_environment, IM3Runtime io_runtime, const uint8_t * i_wasm, uint32_t i_size)
+{
+    M3Result result = m3_ParseModule (i_environment, o_module, i_wasm, i_size);
+
+    if (not result)
+    {
+        result = m3_LoadModule (io_runtime, * o_module);
+
+        if (result)
+            m3_FreeModule (* o_module);
+    }
+
+    return result;
+}
+
+
+/*
+    (module
+      (func (export "run") (param i32) (result i32)
+        local.get 0
+        call $fib)
+      (func $fib (param i32) (result i32)
+        local.get 0
+        i32.const 2
+        i32.lt_u
+        if (result i32)
+          local.get 0
+        else
+          local.get 0
+          i32.const 1
+          i32.sub
+          call $fib
+          local.get 0
+          i32.const 2
+          i32.sub
+          call $fib
+          i32.add
+        end))
+*/
+static const uint8_t c_fibWasm [] =
+{
+    0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00, 0x01, 0x06, 0x01, 0x60, 0x01, 0x7f, 0x01, 0x7f,
+    0x03, 0x03, 0x02, 0x00, 0x00, 0x07, 0x07, 0x01, 0x03, 0x72, 0x75, 0x6e, 0x00, 0x00, 0x0a, 0x25,
+    0x02, 0x06, 0x00, 0x20, 0x00, 0x10, 0x01, 0x0b, 0x1c, 0x00, 0x20, 0x00, 0x41, 0x02, 0x49, 0x04,
+    0x7f, 0x20, 0x00, 0x05, 0x20, 0x00, 0x41, 0x01, 0x6b, 0x10, 0x01, 0x20, 0x00, 0x41, 0x02, 0x6b,
+    0x10, 0x01, 0x6a, 0x0b, 0x0b,
+};
+
+
+/*
+    (module
+      (memory 1)
+      (data (i32.const 0) "hi")
+      (data (i32.const 65535) "hi"))
+*/
+static const uint8_t c_dataSegmentsWasm [] =
+{
+    0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00, 0x05, 0x03, 0x01, 0x00, 0x01, 0x0b, 0x11, 0x02,
+    0x00, 0x41, 0x00, 0x0b, 0x02, 0x68, 0x69, 0x00, 0x41, 0xff, 0xff, 0x03, 0x0b, 0x02, 0x68, 0x69,
+};
+
+
+/*
+    (module
+      (type (func))
+      (type (func (result i32)))
+      (table 2 funcref)
+      (memory 2)
+      (global $g (mut i32) (i32.const 5))
+      (func (export "init")
+        i32.const 1
+        memory.grow
+        drop
+        i32.const 42
+        global.set $g
+        i32.const 70000
+        i32.const 1234
+        i32.store)
+      (func (export "get") (result i32)
+        global.get $g
+        i32.const 70000
+        i32.load
+        i32.add)
+      (func $f7 (result i32)
+        i32.const 7)
+      (func $f9 (result i32)
+        i32.const 9)
+      (func (export "ind") (result i32)
+        i32.const 1
+        call_indirect (type 1))
+      (elem (i32.const 0) $f7 $f9)
+      (data (i32.const 16) "hi"))
+*/
+static const uint8_t c_stateWasm [] =
+{
+    0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x02, 0x60, 0x00, 0x00, 0x60, 0x00,
+    0x01, 0x7f, 0x03, 0x06, 0x05, 0x00, 0x01, 0x01, 0x01, 0x01, 0x04, 0x04, 0x01, 0x70, 0x00, 0x02,
+    0x05, 0x03, 0x01, 0x00, 0x02, 0x06, 0x06, 0x01, 0x7f, 0x01, 0x41, 0x05, 0x0b, 0x07, 0x14, 0x03,
+    0x04, 0x69, 0x6e, 0x69, 0x74, 0x00, 0x00, 0x03, 0x67, 0x65, 0x74, 0x00, 0x01, 0x03, 0x69, 0x6e,
+    0x64, 0x00, 0x04, 0x09, 0x08, 0x01, 0x00, 0x41, 0x00, 0x0b, 0x02, 0x02, 0x03, 0x0a, 0x36, 0x05,
+    0x15, 0x00, 0x41, 0x01, 0x40, 0x00, 0x1a, 0x41, 0x2a, 0x24, 0x00, 0x41, 0xf0, 0xa2, 0x04, 0x41,
+    0xd2, 0x09, 0x36, 0x02, 0x00, 0x0b, 0x0c, 0x00, 0x23, 0x00, 0x41, 0xf0, 0xa2, 0x04, 0x28, 0x02,
+    0x00, 0x6a, 0x0b, 0x04, 0x00, 0x41, 0x07, 0x0b, 0x04, 0x00, 0x41, 0x09, 0x0b, 0x07, 0x00, 0x41,
+    0x01, 0x11, 0x01, 0x00, 0x0b, 0x0b, 0x08, 0x01, 0x00, 0x41, 0x10, 0x0b, 0x02, 0x68, 0x69,
+};
+
+
+// calls an export of c_stateWasm: its result, or -1
+static
+int32_t  CallState  (IM3Runtime i_runtime, const char * i_name)
+{
+    IM3Function function = NULL;
+    int32_t value = -1;
+
+    if (m3_FindFunction (& function, i_runtime, i_name) == m3Err_none and m3_CallV (function) == m3Err_none)
+    {
+        if (strcmp (i_name, "init") == 0)
+            value = 0;
+        else
+            m3_GetResultsV (function, & value);
+    }
+
+    return value;
+}
+
+
+// of the code on the pages of a runtime
+static
+uint64_t  HashCode  (IM3Runtime i_runtime)
+{
+    uint64_t hash = 14695981039346656037ull;
+    IM3CodePage lists [2] = { i_runtime->pagesOpen, i_runtime->pagesFull };
+
+    for (int l = 0; l < 2; ++l)
+    {
+        for (IM3CodePage page = lists [l]; page; page = page->info.next)
+        {
+            const uint8_t * code = (const uint8_t *) GetPageStartPC (page);
+            size_t size = page->info.lineIndex * sizeof (code_t);
+
+            for (size_t i = 0; i < size; ++i)
+                hash = (hash ^ code [i]) * 1099511628211ull;
+        }
+    }
+
+    return hash;
+}
+
+
+typedef struct FibInstance
+{
+    IM3Runtime          runtime;
+    M3Result            result;
+    int32_t             value;
+}
+FibInstance;
+
+static
+void *  RunFibInstance  (void * io_instance)
+{
+    FibInstance * instance = (FibInstance *) io_instance;
+    IM3Function run = NULL;
+
+    M3Result result = m3_FindFunction (& run, instance->runtime, "run");
+
+    if (not result)
+        result = m3_CallV (run, 20);
+
+    if (not result)
+        result = m3_GetResultsV (run, & instance->value);
+
+    instance->result = result;
+
+    return NULL;
+}
+
+
+// pushes the module to the stream i_chunkSize bytes at a time, up to i_size
+static
+M3Result  StreamWasm  (IM3Module * o_module, IM3Environment i_environment, IM3Runtime io_runtime, const uint8_t * i_wasm, uint32_t i_size, uint32_t i_chunkSize)
+{
+    IM3ModuleStream stream = NULL;
+
+    M3Result result = m3_ParseModuleStreaming (i_environment, & stream, io_runtime);
+
+    if (not result)
+    {
+        for (uint32_t i = 0; i < i_size and not result; i += i_chunkSize)
+            result = m3_PushModuleBytes (stream, i_wasm + i, (i_size - i < i_chunkSize) ? i_size - i : i_chunkSize);
+
+        M3Result finished = m3_FinishModuleStream (stream, o_module);
+
+        if (not result)
+            result = finished;
+    }
+
+    return result;
+}
+
+
+#if d_m3EnableCodeCache
+
+// of the one file in a directory; 0 if there's none, or more
+static
+ino_t  FindCacheFile  (char * o_path, size_t i_size, const char * i_dir)
+{
+    ino_t inode = 0;
+    int numFiles = 0;
+    DIR * dir = opendir (i_dir);
+
+    if (dir)
+    {
+        struct dirent * entry;
+        struct stat info;
+
+        while ((entry = readdir (dir)))
+        {
+            if (entry->d_name [0] == '.')
+                continue;
+
+            ++numFiles;
+            snprintf (o_path, i_size, "%s/%s", i_dir, entry->d_name);
+
+            if (stat (o_path, & info) == 0)
+                inode = info.st_ino;
+        }
+
+        closedir (dir);
+    }
+
+    return (numFiles == 1) ? inode : 0;
+}
+
+
+static
+M3Result  RunFibCached  (IM3Environment i_environment, const char * i_cacheDir)
+{
+    IM3Runtime runtime = m3_NewRuntime (i_environment, 8192, NULL);
+    IM3Module module = NULL;
+    IM3Function run = NULL;
+    int32_t value = 0;
+
+    M3Result result = LoadWasm (& module, i_environment, runtime, c_fibWasm, sizeof (c_fibWasm));
+
+    if (not result)
+        result = m3_CompileModuleCached (module, i_cacheDir);
+
+    if (not result)
+        result = m3_FindFunction (& run, runtime, "run");
+
+    if (not result)
+        result = m3_CallV (run, 20);
+
+    if (not result)
+        result = m3_GetResultsV (run, & value);
+
+    if (not result and value != 6765)
+        result = "wrong result";
+
+    m3_FreeRuntime (runtime);
+
+    return result;
+}
+
+#endif // d_m3EnableCodeCache
+
+
+#if d_m3EnableInterrupts
+
+static
+M3Result  InterruptWith  (IM3Runtime i_runtime, void * i_userdata)
+{
+    return * (M3Result *) i_userdata;
+}
+
+#endif // d_m3EnableInterrupts
+
+
+#if d_m3EnableSuspend
+
+/*
+    (module
+      (import "env" "host" (func $host (result i32)))
+      (func (export "outer") (result i32)
+        call $host
+        i32.const 1
+        i32.add)
+      (func (export "inner") (result i32) (local i32)
+        loop
+          local.get 0
+          i32.const 1
+          i32.add
+          local.tee 0
+          i32.const 100
+          i32.lt_u
+          br_if 0
+        end
+        local.get 0)
+      (func (export "add") (param i32 i32) (result i32)
+        local.get 0
+        local.get 1
+        i32.add))
+*/
+static const uint8_t c_suspendWasm [] =
+{
+    0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00, 0x01, 0x0b, 0x02, 0x60, 0x00, 0x01, 0x7f, 0x60,
+    0x02, 0x7f, 0x7f, 0x01, 0x7f, 0x02, 0x0c, 0x01, 0x03, 0x65, 0x6e, 0x76, 0x04, 0x68, 0x6f, 0x73,
+    0x74, 0x00, 0x00, 0x03, 0x04, 0x03, 0x00, 0x00, 0x01, 0x07, 0x17, 0x03, 0x05, 0x6f, 0x75, 0x74,
+    0x65, 0x72, 0x00, 0x01, 0x05, 0x69, 0x6e, 0x6e, 0x65, 0x72, 0x00, 0x02, 0x03, 0x61, 0x64, 0x64,
+    0x00, 0x03, 0x0a, 0x28, 0x03, 0x07, 0x00, 0x10, 0x00, 0x41, 0x01, 0x6a, 0x0b, 0x16, 0x01, 0x01,
+    0x7f, 0x03, 0x40, 0x20, 0x00, 0x41, 0x01, 0x6a, 0x22, 0x00, 0x41, 0xe4, 0x00, 0x49, 0x0d, 0x00,
+    0x0b, 0x20, 0x00, 0x0b, 0x07, 0x00, 0x20, 0x00, 0x20, 0x01, 0x6a, 0x0b,
+};
+
+
+// calls back into the module, & has the call interrupted right at the entry of inner
+static
+m3ApiRawFunction (CallInner)
+{
+    m3ApiReturnType (int32_t)
+
+    IM3Function inner = NULL;
+    int32_t value = 0;
+
+    M3Result result = m3_FindFunction (& inner, runtime, "inner");
+
+    if (not result)
+    {
+        m3_Interrupt (runtime);
+        result = m3_CallV (inner);
+    }
+
+    if (not result)
+        result = m3_GetResultsV (inner, & value);
+
+    if (result)
+        m3ApiTrap (result);
+
+    m3ApiReturn (value);
+}
+
+#endif // d_m3EnableSuspend
+
+
+int  main  (int argc, const char * argv [])
+{
+    Test (data_segments)
+    {
+        IM3Environment env = m3_NewEnvironment ();
+        IM3Runtime runtime = m3_NewRuntime (env, 8192, NULL);
+        IM3Module module = NULL;
+        uint32_t size = 0;
+        uint8_t * memory = NULL;
+
+        // the segments are written in order, up to the one that doesn't fit
+        expect (LoadWasm (& module, env, runtime, c_dataSegmentsWasm, sizeof (c_dataSegmentsWasm)) != m3Err_none)
+
+        memory = m3_GetMemory (runtime, & size, 0);
+        expect (memory and size == 65536)
+        expect (memory and memcmp (memory, "hi", 2) == 0)
+        expect (memory and memory [65535] == 0)
+
+        m3_FreeRuntime (runtime);
+        m3_FreeEnvironment (env);
+    }
+
+    Test (instances)
+    {
+        IM3Environment env = m3_NewEnvironment ();
+        IM3Runtime templateRuntime = m3_NewRuntime (env, 65536, NULL);
+        IM3Module module = NULL;
+        FibInstance instances [8];
+        uint64_t hash = 0;
+
+        memset (instances, 0, sizeof (instances));
+
+        // not compiled: the calls to fib, a function further on & itself, are left to op_Compile
+        expect (LoadWasm (& module, env, templateRuntime, c_fibWasm, sizeof (c_fibWasm)) == m3Err_none)
+
+        for (int i = 0; i < 8; ++i)
+            expect (m3_NewRuntimeInstance (& instances [i].runtime, templateRuntime, 65536, NULL) == m3Err_none)
+
+        // the instances run the template's code at once. it's complete by now, & nothing patches it
+        hash = HashCode (templateRuntime);
+
+#if d_m3EnableParallelCompile
+        pthread_t threads [8];
+        int numThreads = 0;
+
+        while (numThreads < 8 and pthread_create (& threads [numThreads], NULL, RunFibInstance, & instances [numThreads]) == 0)
+            ++numThreads;
+
+        expect (numThreads == 8)
+
+        for (int i = 0; i < numThreads; ++i)
+            pthread_join (threads [i], NULL);
+#else
+        for (int i = 0; i < 8; ++i)
+            RunFibInstance (& instances [i]);
+#endif
+
+        for (int i = 0; i < 8; ++i)
+        {
+            expect (instances [i].result == m3Err_none and instances [i].value == 6765)
+            m3_FreeRuntime (instances [i].runtime);
+        }
+
+        expect (HashCode (templateRuntime) == hash)
+
+        m3_FreeRuntime (templateRuntime);
+        m3_FreeEnvironment (env);
+    }
+
+    Test (stream)
+    {
+        IM3Environment env = m3_NewEnvironment ();
+        const uint32_t chunkSizes [] = { 1, 2, 3, 7, sizeof (c_fibWasm) };
+
+        // however the bytes are split up, a section, a function body or a LEB across pushes
+        for (size_t c = 0; c < sizeof (chunkSizes) / sizeof (chunkSizes [0]); ++c)
+        {
+            IM3Runtime runtime = m3_NewRuntime (env, 8192, NULL);
+            IM3Module module = NULL;
+            IM3Function run = NULL;
+            int32_t value = 0;
+
+            expect (StreamWasm (& module, env, runtime, c_fibWasm, sizeof (c_fibWasm), chunkSizes [c]) == m3Err_none)
+            expect (module and m3_FindFunction (& run, runtime, "run") == m3Err_none)
+            expect (run and m3_CallV (run, 20) == m3Err_none)
+            expect (run and m3_GetResultsV (run, & value) == m3Err_none and value == 6765)
+
+            m3_FreeRuntime (runtime);
+        }
+
+        // cut short, in the code section: it's already loaded, & taken back out
+        {
+            IM3Runtime runtime = m3_NewRuntime (env, 8192, NULL);
+            IM3Module module = NULL;
+            IM3Function run = NULL;
+
+            expect (StreamWasm (& module, env, runtime, c_fibWasm, sizeof (c_fibWasm) - 1, 5) == m3Err_wasmUnderrun)
+            expect (module == NULL)
+            expect (m3_FindFunction (& run, runtime, "run") != m3Err_none)
+
+            m3_FreeRuntime (runtime);
+        }
+
+        // parsed only
+        {
+            IM3Module module = NULL;
+
+            expect (StreamWasm (& module, env, NULL, c_fibWasm, sizeof (c_fibWasm), 4) == m3Err_none)
+            expect (module and module->numFunctions == 2 and m3_GetModuleRuntime (module) == NULL)
+
+            m3_FreeModule (module);
+        }
+
+        m3_FreeEnvironment (env);
+    }
+
+    Test (code_cache)
+    {
+#if d_m3EnableCodeCache
+        IM3Environment env = m3_NewEnvironment ();
+        char dir [] = "/tmp/m3_api_test.XXXXXX";
+        char path [4096] = { 0 };
+        ino_t inode = 0;
+        FILE * file = NULL;
+
+        expect (mkdtemp (dir) != NULL)
+
+        // a miss compiles the module & writes the file
+        expect (RunFibCached (env, dir) == m3Err_none)
+        inode = FindCacheFile (path, sizeof (path), dir);
+        expect (inode != 0)
+
+        // a hit leaves it be
+        expect (RunFibCached (env, dir) == m3Err_none)
+        expect (FindCacheFile (path, sizeof (path), dir) == inode)
+
+        // one with a header that doesn't match (its version) is compiled over & replaced
+        file = fopen (path, "r+b");
+        expect (file and fseek (file, 8, SEEK_SET) == 0 and fputc (0xff, file) == 0xff)
+        if (file)
+            fclose (file);
+
+        expect (RunFibCached (env, dir) == m3Err_none)
+        expect (FindCacheFile (path, sizeof (path), dir) != inode)
+
+        inode = FindCacheFile (path, sizeof (path), dir);
+        expect (RunFibCached (env, dir) == m3Err_none)
+        expect (FindCacheFile (path, sizeof (path), dir) == inode)
+
+        unlink (path);
+        rmdir (dir);
+
+        m3_FreeEnvironment (env);
+#else
+        printf ("skipped: not a d_m3EnableCodeCache build\n");
+#endif
+    }
+
+    Test (snapshot)
+    {
+#if d_m3EnableSnapshots
+        IM3Environment env = m3_NewEnvironment ();
+        IM3Runtime runtime = m3_NewRuntime (env, 8192, NULL);
+        IM3Runtime restored = m3_NewRuntime (env, 8192, NULL);
+        IM3Runtime again = m3_NewRuntime (env, 8192, NULL);
+        IM3Module module = NULL;
+        char dir [] = "/tmp/m3_api_test.XXXXXX";
+        char path [4096] = { 0 };
+        uint32_t size = 0;
+        uint8_t * memory = NULL;
+
+        expect (mkdtemp (dir) != NULL)
+        snprintf (path, sizeof (path), "%s/state.snap", dir);
+
+        expect (LoadWasm (& module, env, runtime, c_stateWasm, sizeof (c_stateWasm)) == m3Err_none)
+        expect (CallState (runtime, "get") == 5)
+        expect (CallState (runtime, "init") == 0)
+        expect (CallState (runtime, "get") == 1276)
+        expect (m3_SnapshotRuntime (runtime, path) == m3Err_none)
+
+        // the memory grown, the global set & the table come back
+        expect (LoadWasm (& module, env, restored, c_stateWasm, sizeof (c_stateWasm)) == m3Err_none)
+        expect (CallState (restored, "get") == 5)
+        expect (m3_RestoreRuntime (restored, path) == m3Err_none)
+        expect (CallState (restored, "get") == 1276)
+        expect (CallState (restored, "ind") == 9)
+
+        memory = m3_GetMemory (restored, & size, 0);
+        expect (memory and size == 3 * 65536 and memcmp (memory + 16, "hi", 2) == 0)
+
+        // snapshotted over the file its memory is mapped from, a restored runtime keeps its state
+        expect (m3_SnapshotRuntime (restored, path) == m3Err_none)
+        memory = m3_GetMemory (restored, & size, 0);
+        expect (memory and size == 3 * 65536 and memcmp (memory + 16, "hi", 2) == 0)
+        expect (CallState (restored, "get") == 1276)
+
+        expect (LoadWasm (& module, env, again, c_stateWasm, sizeof (c_stateWasm)) == m3Err_none)
+        expect (m3_RestoreRuntime (again, path) == m3Err_none)
+        expect (CallState (again, "get") == 1276)
+
+        // not a snapshot of this module
+        m3_FreeRuntime (again);
+        again = m3_NewRuntime (env, 8192, NULL);
+        expect (LoadWasm (& module, env, again, c_fibWasm, sizeof (c_fibWasm)) == m3Err_none)
+        expect (m3_RestoreRuntime (again, path) != m3Err_none)
+
+        unlink (path);
+        rmdir (dir);
+
+        m3_FreeRuntime (again);
+        m3_FreeRuntime (restored);
+        m3_FreeRuntime (runtime);
+        m3_FreeEnvironment (env);
+#else
+        printf ("skipped: not a d_m3EnableSnapshots build\n");
+#endif
+    }
+
+    Test (checkpoint)
+    {
+        IM3Environment env = m3_NewEnvironment ();
+        IM3Runtime runtime = m3_NewRuntime (env, 8192, NULL);
+        IM3Module module = NULL;
+        uint32_t size = 0;
+        uint8_t * memory = NULL;
+
+        expect (LoadWasm (& module, env, runtime, c_stateWasm, sizeof (c_stateWasm)) == m3Err_none)
+        expect (m3_ResetRuntime (runtime) == m3Err_noCheckpoint)
+
+        expect (m3_CheckpointRuntime (runtime) == m3Err_none)
+
+        // again & again: the global, the memory written to & the memory grown are set back each time
+        for (int i = 0; i < 3; ++i)
+        {
+            expect (CallState (runtime, "init") == 0)
+            expect (CallState (runtime, "get") == 1276)
+
+            memory = m3_GetMemory (runtime, & size, 0);
+            expect (memory and size == 3 * 65536 and memory [2 * 65536] == 0)
+            if (memory)
+            {
+                memory [16] = 'X';
+                memory [2 * 65536] = 7;
+            }
+
+            expect (m3_ResetRuntime (runtime) == m3Err_none)
+            expect (CallState (runtime, "get") == 5)
+
+            memory = m3_GetMemory (runtime, & size, 0);
+            expect (memory and size == 2 * 65536 and memcmp (memory + 16, "hi", 2) == 0)
+        }
+
+        // a later checkpoint replaces the first
+        expect (CallState (runtime, "init") == 0)
+        expect (m3_CheckpointRuntime (runtime) == m3Err_none)
+
+        memory = m3_GetMemory (runtime, & size, 0);
+        if (memory)
+            memset (memory + 70000, 0, 4);
+        expect (CallState (runtime, "get") == 42)
+
+        expect (m3_ResetRuntime (runtime) == m3Err_none)
+        expect (CallState (runtime, "get") == 1276)
+        expect (CallState (runtime, "ind") == 9)
+
+        m3_FreeRuntime (runtime);
+        m3_FreeEnvironment (env);
+    }
+
+    Test (gas)
+    {
+#if d_m3EnableGasMetering
+        IM3Environment env = m3_NewEnvironment ();
+        IM3Runtime runtime = m3_NewRuntime (env, 8192, NULL);
+        IM3Module module = NULL;
+        IM3Function run = NULL;
+        int32_t value = 0;
+        uint64_t used = 0;
+
+        expect (m3_EnableGasMetering (runtime, true) == m3Err_none)
+        expect (LoadWasm (& module, env, runtime, c_fibWasm, sizeof (c_fibWasm)) == m3Err_none)
+        expect (m3_FindFunction (& run, runtime, "run") == m3Err_none)
+
+        // what fib (20) costs
+        m3_SetGas (runtime, 1000000000);
+        expect (m3_CallV (run, 20) == m3Err_none)
+        expect (m3_GetResultsV (run, & value) == m3Err_none and value == 6765)
+        used = 1000000000 - m3_GetGas (runtime);
+        expect (used > 1000 and used < 1000000000)
+
+        // exhausted, the run that didn't fit is left unpaid
+        m3_SetGas (runtime, 1000);
+        expect (m3_CallV (run, 20) == m3Err_trapOutOfGas)
+        expect (m3_GetGas (runtime) > 0 and m3_GetGas (runtime) < 1000)
+
+        // refuelled, the same call is charged the same again
+        m3_SetGas (runtime, 0);
+        m3_AddGas (runtime, used);
+        expect (m3_CallV (run, 20) == m3Err_none)
+        expect (m3_GetResultsV (run, & value) == m3Err_none and value == 6765)
+        expect (m3_GetGas (runtime) == 0)
+
+        m3_SetGas (runtime, UINT64_MAX - 1);
+        m3_AddGas (runtime, 10);
+        expect (m3_GetGas (runtime) == UINT64_MAX)
+
+        m3_FreeRuntime (runtime);
+        m3_FreeEnvironment (env);
+#else
+        printf ("skipped: not a d_m3EnableGasMetering build\n");
+#endif
+    }
+
+    Test (interrupt)
+    {
+#if d_m3EnableInterrupts
+        IM3Environment env = m3_NewEnvironment ();
+        IM3Runtime runtime = m3_NewRuntime (env, 8192, NULL);
+        IM3Module module = NULL;
+        IM3Function run = NULL;
+        M3Result interruptResult = m3Err_none;
+        int32_t value = 0;
+
+        expect (LoadWasm (& module, env, runtime, c_fibWasm, sizeof (c_fibWasm)) == m3Err_none)
+        expect (m3_FindFunction (& run, runtime, "run") == m3Err_none)
+
+        // without a handler, it traps; the interrupt is taken, & the next call runs through
+        m3_Interrupt (runtime);
+        expect (m3_CallV (run, 20) == m3Err_trapInterrupted)
+        expect (m3_CallV (run, 20) == m3Err_none)
+        expect (m3_GetResultsV (run, & value) == m3Err_none and value == 6765)
+
+        m3_SetInterruptHandler (runtime, InterruptWith, & interruptResult);
+
+        // the handler lets it carry on
+        m3_Interrupt (runtime);
+        expect (m3_CallV (run, 20) == m3Err_none)
+        expect (m3_GetResultsV (run, & value) == m3Err_none and value == 6765)
+
+        // or traps with its own result
+        interruptResult = m3Err_trapExit;
+        m3_Interrupt (runtime);
+        expect (m3_CallV (run, 20) == m3Err_trapExit)
+
+        m3_FreeRuntime (runtime);
+        m3_FreeEnvironment (env);
+#else
+        printf ("skipped: not a d_m3EnableInterrupts build\n");
+#endif
+    }
+
+    Test (suspend_nested)
+    {
+#if d_m3EnableSuspend
+        IM3Environment env = m3_NewEnvironment ();
+        IM3Runtime runtime = m3_NewRuntime (env, 8192, NULL);
+        IM3Module module = NULL;
+        IM3Function outer = NULL, add = NULL;
+        M3Result interruptResult = m3Err_suspended;
+        int32_t value = 0;
+        int numSuspended = 0;
+
+        expect (LoadWasm (& module, env, runtime, c_suspendWasm, sizeof (c_suspendWasm)) == m3Err_none)
+        expect (m3_LinkRawFunction (module, "env", "host", "i()", CallInner) == m3Err_none)
+        expect (m3_FindFunction (& outer, runtime, "outer") == m3Err_none)
+        expect (m3_FindFunction (& add, runtime, "add") == m3Err_none)
+
+        m3_SetInterruptHandler (runtime, InterruptWith, & interruptResult);
+
+        // suspended inside the import's call back in; resumed, both calls complete
+        expect (m3_CallV (outer) == m3Err_suspended)
+        expect (m3_CallV (add, 2, 3) == m3Err_callSuspended)
+        expect (m3_Resume (runtime) == m3Err_none)
+        expect (m3_GetResultsV (outer, & value) == m3Err_none and value == 101)
+
+        // each discarded call left the stack where the import had moved it; they crept up to an overflow
+        for (int i = 0; i < 1000; ++i)
+        {
+            if (m3_CallV (outer) == m3Err_suspended)
+                ++numSuspended;
+
+            m3_DiscardSuspended (runtime);
+        }
+        expect (numSuspended == 1000)
+
+        expect (m3_CallV (add, 2, 3) == m3Err_none)
+        expect (m3_GetResultsV (add, & value) == m3Err_none and value == 5)
+
+        interruptResult = m3Err_none;
+        expect (m3_CallV (outer) == m3Err_none)
+        expect (m3_GetResultsV (outer, & value) == m3Err_none and value == 101)
+
+        m3_FreeRuntime (runtime);
+        m3_FreeEnvironment (env);
+#else
+        printf ("skipped: not a d_m3EnableSuspend build\n");
+#endif
+    }
+
+    if (s_numFailures)
+        printf ("\n%d failed\n", s_numFailures);
+
+    return s_numFailures ? 1 : 0;
+}
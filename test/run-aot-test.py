@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+
+# Copyright © 2026 Wasm3 contributors.
+# Usage:
+#   ./run-aot-test.py --aot ../build/wasm3-aot --exec ../build/wasm3
+#   ./run-aot-test.py --aot ../build/wasm3-aot --exec ../build/wasm3 --cc clang --cflags "-Dd_m3HasWASI -Dd_m3HasTracer"
+#
+# Translates each module with wasm3-aot, builds the C as a shared library & runs it with wasm3 --aot
+
+import argparse
+import os
+import sys
+import shlex
+import subprocess
+import tempfile
+import fnmatch
+
+sys.path.append('../extra')
+
+from testutils import *
+from pprint import pprint
+
+#
+# Args handling
+#
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--aot",     metavar="<translator>",  default="../build/wasm3-aot")
+parser.add_argument("--exec",    metavar="<interpreter>", default="../build/wasm3")
+parser.add_argument("--cc",      metavar="<compiler>",    default="cc")
+parser.add_argument("--cflags",  default="-Dd_m3HasWASI -Dd_m3HasTracer")     # the d_m3* definitions of the wasm3 build
+parser.add_argument("--timeout", type=int,             default=120)
+
+args = parser.parse_args()
+
+stats = dotdict(total_run=0, failed=0, crashed=0, timeout=0)
+
+commands = [
+  {
+    "name":              "fib32",
+    "wasm":              "./lang/fib32.wasm",
+    "opts":              ["--func", "fib"],
+    "args":              ["20"],
+    "expect_translated": "1 of 1 functions",
+    "expect_pattern":    "Result: 6765*"
+  }, {
+    # fib is left to the interpreter: its return_call is to another function. the one to itself, in f_0, is a jump
+    "name":              "Tail calls",
+    "wasm":              "./lang/fib32_tail.wasm",
+    "opts":              ["--func", "fib"],
+    "args":              ["1000000"],
+    "expect_translated": "1 of 2 functions",
+    "expect_pattern":    "Result: 1884755131*"
+  }
+]
+
+def fail(msg):
+    print(f"{ansi.FAIL}FAIL:{ansi.ENDC} {msg}")
+    stats.failed += 1
+
+def run(command):
+    print(' '.join(command))
+    return subprocess.run(command, timeout=args.timeout, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+
+with tempfile.TemporaryDirectory() as tmp:
+    for cmd in commands:
+        name = os.path.splitext(os.path.basename(cmd['wasm']))[0]
+        source = os.path.join(tmp, name + ".c")
+        library = os.path.join(tmp, name + ".so")
+
+        print(f"=== {cmd['name']} ===")
+        stats.total_run += 1
+        try:
+            translated = run([args.aot, cmd['wasm'], source])
+            if translated.returncode != 0:
+                stats.crashed += 1
+                fail(f"wasm3-aot exited with error code {translated.returncode}")
+                continue
+
+            if cmd['expect_translated'] not in translated.stdout.decode("utf-8"):
+                fail(f"Not translated as expected:\n{translated.stdout.decode('utf-8')}")
+                continue
+
+            built = run([args.cc, "-std=c99", "-O2", "-shared", "-fPIC", "-I../source"] + shlex.split(args.cflags) + ["-o", library, source])
+            if built.returncode != 0:
+                stats.crashed += 1
+                fail(f"Can't build the translated code:\n{built.stdout.decode('utf-8')}")
+                continue
+
+            output = run(args.exec.split(' ') + ["--aot", library] + cmd['opts'] + [cmd['wasm']] + cmd['args'])
+        except subprocess.TimeoutExpired:
+            stats.timeout += 1
+            fail("Timeout")
+            continue
+
+        actual = output.stdout.decode("utf-8")
+        if output.returncode != 0:
+            stats.crashed += 1
+            fail(f"Exited with error code {output.returncode}:\n{actual}")
+        elif not fnmatch.fnmatch(actual, cmd['expect_pattern']):
+            fail(f"Output does not match pattern:\n{actual}")
+
+        print()
+
+pprint(stats)
+
+if stats.failed:
+    print(f"{ansi.FAIL}=======================")
+    print(f" FAILED: {stats.failed}/{stats.total_run}")
+    print(f"======================={ansi.ENDC}")
+    sys.exit(1)
+
+else:
+    print(f"{ansi.OKGREEN}=======================")
+    print(f" All {stats.total_run} tests OK")
+    print(f"======================={ansi.ENDC}")
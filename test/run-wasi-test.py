@@ -10,6 +10,7 @@
 #   ./run-wasi-test.py --exec "../build/wasm3 --stack-size 2097152 wasm3.wasm" --fast
 
 import argparse
+import os
 import sys
 import subprocess
 import hashlib
@@ -146,17 +147,71 @@ commands_fast = [
   }
 ]
 
+# these take options of wasm3's own (given before the module), so only run with it
+commands_wasm3 = [
+  {
+    "name":           "Tail calls",
+    "opts":           ["--func", "fib"],
+    "wasm":           "./lang/fib32_tail.wasm",
+    "args":           ["1000"],
+    "expect_pattern": "Result: 1556111435*"
+  }, {
+    # return_call only runs in constant stack in optimized/musttail/computed goto builds (d_m3ReuseTailCallFrames)
+    "name":           "Tail calls (constant stack)",
+    "if_version":     "Tail calls: constant stack",
+    "opts":           ["--func", "fib"],
+    "wasm":           "./lang/fib32_tail.wasm",
+    "args":           ["1000000"],
+    "expect_pattern": "Result: 1884755131*"
+  }, {
+    "name":           "Gas metering",
+    "opts":           ["--gas", "100000000", "--func", "fib"],
+    "wasm":           "./lang/fib32.wasm",
+    "args":           ["20"],
+    "expect_pattern": "Gas used: 218906*Result: 6765*"
+  }, {
+    "name":           "Out of gas",
+    "opts":           ["--gas", "1000", "--func", "fib"],
+    "wasm":           "./lang/fib32.wasm",
+    "args":           ["20"],
+    "can_crash":      True,
+    "expect_pattern": "*out of gas*"
+  }, {
+    "name":           "Streaming",
+    "opts":           ["--stream", "--func", "fib"],
+    "wasm":           "./lang/fib32.wasm",
+    "args":           ["20"],
+    "expect_pattern": "Result: 6765*"
+  }, {
+    "name":           "mandelbrot (streaming, in chunks)",
+    "opts":           ["--stream"],
+    "wasm":           "./wasi/mandelbrot/mandel.wasm",
+    "args":           ["128", "4e5"],
+    "expect_sha1":    "37091e7ce96adeea88f079ad95d239a651308a56"
+  }
+]
+
 def fail(msg):
     print(f"{ansi.FAIL}FAIL:{ansi.ENDC} {msg}")
     stats.failed += 1
 
 commands = commands_fast if args.fast else commands_full
 
+exec_words = args.exec.split(' ')
+if os.path.basename(exec_words[0]).startswith("wasm3") and not any(w.endswith(".wasm") for w in exec_words):
+    commands = commands + commands_wasm3
+    version = subprocess.run(exec_words + ["--version"], stdout=subprocess.PIPE).stdout.decode("utf-8")
+
 for cmd in commands:
     if "skip" in cmd:
         continue
+    if "if_version" in cmd and cmd['if_version'] not in version:
+        print(f"=== {cmd['name']} ===\nskipped: not in this build\n")
+        continue
 
     command = args.exec.split(' ')
+    if "opts" in cmd:
+        command.extend(cmd['opts'])
     command.append(cmd['wasm'])
     if "args" in cmd:
         if args.separate_args:
@@ -175,6 +230,10 @@ for cmd in commands:
         elif "can_crash" in cmd:
             print(f"{' '.join(command)}")
             output = subprocess.run(command, timeout=args.timeout, stdout=subprocess.PIPE, stderr=subprocess.STDOUT).stdout
+        elif "opts" in cmd and "expect_pattern" in cmd:
+            # wasm3 reports results on stderr
+            print(f"{' '.join(command)}")
+            output = subprocess.check_output(command, timeout=args.timeout, stderr=subprocess.STDOUT)
         else:
             print(f"{' '.join(command)}")
             output = subprocess.check_output(command, timeout=args.timeout)